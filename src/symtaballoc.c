@@ -0,0 +1,294 @@
+/* Allocation check for the Symbol table library.
+
+Counts the calls to malloc, calloc and realloc made while the table is
+used, by linking with -Wl,--wrap for each of them, and verifies that:
+
+1) SymTable_get, SymTable_contains and SymTable_put on an existing key do
+not allocate, for keys that are present and keys that are not.
+2) Inserting a key allocates once, plus once for every growth of the bucket
+array, which happens at most once per bucket size a table can have.
+3) The functions that report allocation failures do so, and leave the table
+unchanged, whichever of their allocations fails.
+
+These are the guarantees needed to use a table from a thread where
+allocation is forbidden, after it has been filled elsewhere. Exits with
+status 1 if any check fails. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "symtable.h"
+
+#define NUM_KEYS 100000     /* keys inserted, enough for every bucket size */
+#define KEY_LEN 16          /* characters of each key */
+#define FAIL_KEYS 1000      /* keys of the tables of the failure checks */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+int check(const char *name, unsigned long allocs, unsigned long max_allocs, unsigned long ops);
+int check_failures(char **keys);
+
+static unsigned long allocations = 0UL;
+static unsigned long fail_at = 0UL;     /* allocation that fails, 0 for none */
+
+
+/*  main
+
+Returns: 0 if every check passes, 1 otherwise */
+int main(void) {
+    unsigned long before, max_allocs;
+    unsigned int num_sizes;
+    const unsigned int *sizes;
+    SymTable_T oSymTable;
+    char **keys, *missing, *blob;
+    int i, j, k, failed;
+
+    /* keys are allocated before counting starts. The first characters of
+    a key are its index in base 26. A missing key is a present key whose last
+    character is replaced by one that no key has. */
+    keys = malloc(NUM_KEYS * sizeof(char *));
+    assert(keys);
+    blob = malloc(NUM_KEYS * (KEY_LEN + 1));
+    assert(blob);
+    missing = malloc(KEY_LEN + 1);
+    assert(missing);
+    for (i = 0; i < NUM_KEYS; i++) {
+        keys[i] = blob + i * (KEY_LEN + 1);
+        for (j = 0; j < KEY_LEN; j++) {
+            keys[i][j] = 'a' + (i * 7 + j * 13) % 26;
+        }
+        for (j = 0, k = i; j < 4; j++, k /= 26) {
+            keys[i][j] = 'a' + k % 26;
+        }
+        keys[i][KEY_LEN] = '\0';
+    }
+    num_sizes = SymTable_bucketSizes(&sizes);
+    failed = 0;
+
+    /* copied keys: one allocation per binding and one per growth */
+    oSymTable = SymTable_new();
+    before = allocations;
+    for (i = 0; i < NUM_KEYS; i++) {
+        SymTable_put(oSymTable, keys[i], keys[i]);
+    }
+    max_allocs = NUM_KEYS + num_sizes;
+    failed |= check("insert", allocations - before, max_allocs, NUM_KEYS);
+    assert(SymTable_getLength(oSymTable) == NUM_KEYS);
+
+    before = allocations;
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (SymTable_get(oSymTable, keys[i]) != keys[i]) {
+            failed = 1;
+        }
+    }
+    failed |= check("get present", allocations - before, 0UL, NUM_KEYS);
+
+    before = allocations;
+    for (i = 0; i < NUM_KEYS; i++) {
+        strcpy(missing, keys[i]);
+        missing[KEY_LEN - 1] = 'A';
+        if (SymTable_get(oSymTable, missing)) {
+            failed = 1;
+        }
+    }
+    failed |= check("get missing", allocations - before, 0UL, NUM_KEYS);
+
+    before = allocations;
+    for (i = 0; i < NUM_KEYS; i++) {
+        strcpy(missing, keys[i]);
+        missing[KEY_LEN - 1] = 'A';
+        if (!SymTable_contains(oSymTable, keys[i]) || SymTable_contains(oSymTable, missing)) {
+            failed = 1;
+        }
+    }
+    failed |= check("contains", allocations - before, 0UL, 2 * NUM_KEYS);
+
+    before = allocations;
+    for (i = 0; i < NUM_KEYS; i++) {
+        SymTable_put(oSymTable, keys[i], keys[NUM_KEYS - 1 - i]);
+    }
+    failed |= check("update", allocations - before, 0UL, NUM_KEYS);
+    assert(SymTable_getLength(oSymTable) == NUM_KEYS);
+    SymTable_free(oSymTable);
+
+    /* referenced keys: the binding is the only allocation */
+    oSymTable = SymTable_newBlob(blob, NUM_KEYS * (KEY_LEN + 1));
+    before = allocations;
+    for (i = 0; i < NUM_KEYS; i++) {
+        SymTable_putBlob(oSymTable, i * (KEY_LEN + 1), keys[i]);
+    }
+    failed |= check("insert blob", allocations - before, max_allocs, NUM_KEYS);
+    SymTable_free(oSymTable);
+
+    failed |= check_failures(keys);
+
+    printf("%s\n", failed ? "FAILED" : "OK");
+    free(missing);
+    free(blob);
+    free(keys);
+    return failed;
+}
+
+
+/* check
+
+Prints the allocations made by ops operations.
+
+Parameters:
+name: name of the operations
+allocs: allocations they made
+max_allocs: allocations allowed
+ops: number of operations
+
+Returns: 1 if allocs is more than max_allocs, 0 otherwise */
+int check(const char *name, unsigned long allocs, unsigned long max_allocs, unsigned long ops) {
+    printf("%-12s %8lu ops %8lu allocations (%.4f per op, at most %lu) %s\n", name, ops, allocs,
+        (double) allocs / ops, max_allocs, allocs > max_allocs ? "FAIL" : "ok");
+    return allocs > max_allocs;
+}
+
+
+/* check_failures
+
+Makes each allocation of SymTable_buildParallel, SymTable_snapshot,
+SymTable_tryPut, SymTable_setCache, SymTable_setSampling and SymTable_take
+on a table of referenced keys fail in turn,
+until the call needs no more allocations than the ones that were allowed to
+succeed, and checks that the failure is reported and that the table is
+unchanged.
+
+Parameters:
+keys: the keys, of which the first FAIL_KEYS are used. They are in one
+    block, KEY_LEN + 1 characters apart.
+
+Returns: 1 if any check fails, 0 otherwise */
+int check_failures(char **keys) {
+    SymTable_T oSymTable, oResult;
+    char *pcKey;
+    void *pvValue;
+    size_t bytes;
+    unsigned long n, runs;
+    int i, failed, done;
+
+    failed = 0;
+    runs = 0UL;
+    for (n = 1UL, done = 0; !done; n++, runs++) {
+        fail_at = allocations + n;
+        oResult = SymTable_buildParallel((const char **) keys, (const void **) keys, FAIL_KEYS, 1U);
+        fail_at = 0UL;
+        done = oResult != NULL;
+        if (done && SymTable_getLength(oResult) != FAIL_KEYS) {
+            failed = 1;
+        }
+        SymTable_free(oResult);
+    }
+
+    oSymTable = SymTable_new();
+    for (i = 0; i < FAIL_KEYS; i++) {
+        SymTable_put(oSymTable, keys[i], keys[i]);
+    }
+    bytes = SymTable_getBytes(oSymTable);
+    for (n = 1UL, done = 0; !done; n++, runs++) {
+        fail_at = allocations + n;
+        oResult = SymTable_snapshot(oSymTable);
+        fail_at = 0UL;
+        done = oResult != NULL;
+        if (done && SymTable_getLength(oResult) != FAIL_KEYS) {
+            failed = 1;
+        }
+        SymTable_free(oResult);
+    }
+
+    /* the next insertion grows the bucket array, so it allocates twice */
+    for (i = FAIL_KEYS; SymTable_getLength(oSymTable) < 1020U; i++) {
+        SymTable_put(oSymTable, keys[i], keys[i]);
+    }
+    for (n = 1UL, done = 0; !done; n++, runs++) {
+        bytes = SymTable_getBytes(oSymTable);
+        fail_at = allocations + n;
+        done = SymTable_tryPut(oSymTable, keys[i], keys[i]);
+        fail_at = 0UL;
+        if (!done && (SymTable_contains(oSymTable, keys[i]) || SymTable_getBytes(oSymTable) != bytes)) {
+            failed = 1;
+        }
+    }
+
+    bytes = SymTable_getBytes(oSymTable);
+    fail_at = allocations + 1UL;
+    if (SymTable_setCache(oSymTable, 256U)) {
+        failed = 1;
+    }
+    fail_at = allocations + 1UL;
+    if (SymTable_setSampling(oSymTable, 4U) || SymTable_getBytes(oSymTable) != bytes) {
+        failed = 1;
+    }
+    fail_at = 0UL;
+    if (!SymTable_setCache(oSymTable, 256U) || !SymTable_setSampling(oSymTable, 4U)) {
+        failed = 1;
+    }
+    bytes = SymTable_getBytes(oSymTable);
+    fail_at = allocations + 1UL;
+    if (SymTable_setCache(oSymTable, 1024U) || SymTable_getBytes(oSymTable) != bytes ||
+            SymTable_get(oSymTable, keys[0]) != keys[0]) {
+        failed = 1;
+    }
+    fail_at = 0UL;
+    runs += 3UL;
+    SymTable_free(oSymTable);
+
+    oSymTable = SymTable_newBlob(keys[0], FAIL_KEYS * (KEY_LEN + 1));
+    for (i = 0; i < FAIL_KEYS; i++) {
+        SymTable_putBlob(oSymTable, i * (KEY_LEN + 1), keys[i]);
+    }
+    bytes = SymTable_getBytes(oSymTable);
+    fail_at = allocations + 1UL;
+    pcKey = NULL;
+    if (SymTable_take(oSymTable, keys[1], &pvValue, &pcKey) != -1 || pcKey ||
+            SymTable_get(oSymTable, keys[1]) != keys[1] || SymTable_getBytes(oSymTable) != bytes) {
+        failed = 1;
+    }
+    fail_at = 0UL;
+    if (SymTable_take(oSymTable, keys[1], &pvValue, &pcKey) != 1 || pvValue != keys[1] ||
+            strcmp(pcKey, keys[1]) || SymTable_contains(oSymTable, keys[1])) {
+        failed = 1;
+    }
+    else {
+        free(pcKey);
+    }
+    runs += 2UL;
+    SymTable_free(oSymTable);
+
+    printf("%-12s %8lu runs %s\n", "failures", runs, failed ? "FAIL" : "ok");
+    return failed;
+}
+
+
+/* __wrap_malloc, __wrap_calloc, __wrap_realloc
+
+Count the allocation and call the allocator of the C library, or return
+NULL if it is allocation number fail_at. */
+void *__wrap_malloc(size_t size) {
+    if (++allocations == fail_at) {
+        return NULL;
+    }
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t nmemb, size_t size) {
+    if (++allocations == fail_at) {
+        return NULL;
+    }
+    return __real_calloc(nmemb, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    if (++allocations == fail_at) {
+        return NULL;
+    }
+    return __real_realloc(ptr, size);
+}
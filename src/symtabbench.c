@@ -0,0 +1,794 @@
+/* Benchmark driver for the Symbol table library.
+
+Reads workloads from a specification file and prints one result line per
+workload in CSV or JSON format. Random numbers come from a generator that is
+seeded by the specification, so the same file always performs the same
+operations.
+
+A memory mode builds tables of several sizes and key lengths and reports
+the bytes per binding of each part of the table, the allocator overhead and
+the resident memory.
+
+Results can be compared against a baseline file written by a previous CSV
+run. The program then exits with status 2 if any workload is slower or uses
+more memory than its baseline by more than the tolerance of the workload. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+#include "symtable.h"
+#include "symtabutil.h"
+
+#define MAX_LINE 256        /* maximum length of a line of the specification */
+#define MAX_NAME 64         /* maximum length of a workload name */
+#define MAX_ALPHABET 128    /* maximum length of the alphabet of the keys */
+#define MAX_BASELINES 256   /* maximum number of workloads in a baseline file */
+#define MIN_TIME 0.005      /* baseline times below this are too noisy to compare */
+
+
+/* A workload, as described by a section of the specification file.
+
+name: name of the workload, printed in the results
+num_keys: number of random keys
+min_key_len, max_key_len: key lengths are uniform in this range
+alphabet: characters used for the keys
+zipf: 0 if keys are selected uniformly, 1 if they follow a Zipf distribution
+num_ops: number of operations after the table is filled
+put, get, remove: relative frequency of each operation
+threads: number of threads used to fill the table
+seed: seed of the random number generator
+min_load, max_load, growth, max_bytes: resize policy of the table
+cache: entries of the lookup cache of the table, 0 for no cache
+batch: consecutive gets are done together by SymTable_getBatch, up to this
+many keys per call. 0 uses SymTable_get.
+repeat: number of runs. The median times are reported.
+tolerance: allowed relative increase of the times over the baseline. It is
+raised to twice the relative spread of the runs when that is larger.
+mem_tolerance: allowed relative increase of the bytes over the baseline */
+struct workload {
+    char name[MAX_NAME];
+    int num_keys;
+    int min_key_len;
+    int max_key_len;
+    char alphabet[MAX_ALPHABET];
+    int zipf;
+    int num_ops;
+    int put;
+    int get;
+    int remove;
+    int threads;
+    unsigned long seed;
+    double min_load;
+    double max_load;
+    double growth;
+    unsigned long max_bytes;
+    int cache;
+    int batch;
+    int repeat;
+    double tolerance;
+    double mem_tolerance;
+};
+
+
+/* Results of a run of a workload. noise is the largest relative spread
+(max - min) / median of the fill and operation times of all runs. */
+struct result {
+    double fill_time;
+    double ops_time;
+    unsigned int bindings;
+    size_t bytes;
+    double noise;
+};
+
+
+/* Results of a workload read from a baseline file. */
+struct baseline {
+    char name[MAX_NAME];
+    double fill_time;
+    double ops_time;
+    unsigned long bytes;
+};
+
+void default_workload(struct workload *work);
+int parse_option(struct workload *work, char *line);
+void run_workload(const struct workload *work, struct result *res);
+void summarize_runs(const struct workload *work, struct result *runs, struct result *res);
+void print_result(const struct workload *work, const struct result *res, int json, int first);
+int load_baseline(const char *path, struct baseline *base);
+int check_result(const struct workload *work, const struct result *res, const struct baseline *base, int num_base);
+int compare_double(const void *a, const void *b);
+void memory_benchmark(int json);
+size_t allocated_bytes(void);
+size_t resident_bytes(void);
+
+
+/*  main
+
+Parameters:
+argc: number of command line arguments. Must be 2, 3 or 4.
+argv: command line arguments.
+    1st argument: executable file name
+    2nd argument: workload specification file, or -m for the memory mode
+    3rd argument: output format, csv (default) or json
+    4th argument: baseline file to compare the results with
+
+Returns: 0 on success, 1 on invalid input, 2 if there are regressions */
+int main(int argc, char **argv) {
+    static struct baseline base[MAX_BASELINES];
+    struct workload work, defaults;
+    struct result res, *runs;
+    char line[MAX_LINE], *ptr;
+    FILE *spec;
+    int i, json, first, in_section, line_num, num_base, regressions;
+
+    if (argc < 2 || argc > 4) {
+        printf("Usage: %s {SPEC_FILE} [csv|json] [BASELINE_FILE]\n", argv[0]);
+        printf("       %s -m [csv|json]\n", argv[0]);
+        return 1;
+    }
+    json = argc >= 3 && !strcmp(argv[2], "json");
+    if (argc >= 3 && !json && strcmp(argv[2], "csv")) {
+        printf("Unknown format: %s\n", argv[2]);
+        return 1;
+    }
+    if (!strcmp(argv[1], "-m")) {
+        memory_benchmark(json);
+        return 0;
+    }
+    num_base = 0;
+    if (argc == 4) {
+        num_base = load_baseline(argv[3], base);
+        if (num_base < 0) {
+            printf("Cannot read baseline %s\n", argv[3]);
+            return 1;
+        }
+    }
+    spec = fopen(argv[1], "r");
+    if (!spec) {
+        printf("Cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    /* a workload starts with a [name] line and ends with the next one.
+    Options before the first section apply to every workload. */
+    default_workload(&defaults);
+    first = 1;
+    in_section = 0;
+    line_num = 0;
+    regressions = 0;
+    for (;;) {
+        ptr = fgets(line, MAX_LINE, spec);
+        line_num++;
+        if (!ptr || line[0] == '[') {
+            if (in_section) {
+                runs = malloc(work.repeat * sizeof(struct result));
+                assert(runs);
+                for (i = 0; i < work.repeat; i++) {
+                    run_workload(&work, &runs[i]);
+                }
+                summarize_runs(&work, runs, &res);
+                print_result(&work, &res, json, first);
+                if (argc == 4) {
+                    regressions += check_result(&work, &res, base, num_base);
+                }
+                first = 0;
+                free(runs);
+            }
+            if (!ptr) {
+                break;
+            }
+            ptr = strchr(line, ']');
+            if (!ptr) {
+                printf("Line %d: missing ']'\n", line_num);
+                return 1;
+            }
+            *ptr = '\0';
+            work = defaults;
+            strncpy(work.name, line + 1, MAX_NAME - 1);
+            work.name[MAX_NAME - 1] = '\0';
+            in_section = 1;
+            continue;
+        }
+        if (!parse_option(in_section ? &work : &defaults, line)) {
+            printf("Line %d: invalid option\n", line_num);
+            return 1;
+        }
+    }
+    if (json) {
+        printf(first ? "[]\n" : "\n]\n");
+    }
+    fclose(spec);
+    if (regressions) {
+        fprintf(stderr, "%d regression(s)\n", regressions);
+        return 2;
+    }
+    return 0;
+}
+
+
+/* default_workload
+
+Sets every option of work to its default value.
+
+Parameters:
+work: the workload
+
+Returns: void */
+void default_workload(struct workload *work) {
+    strcpy(work->name, "default");
+    work->num_keys = 10000;
+    work->min_key_len = 1;
+    work->max_key_len = 16;
+    strcpy(work->alphabet, "abcdefghijklmnopqrstuvwxyz");
+    work->zipf = 0;
+    work->num_ops = 100000;
+    work->put = 20;
+    work->get = 70;
+    work->remove = 10;
+    work->threads = 1;
+    work->seed = 1UL;
+    work->min_load = 0.0;
+    work->max_load = 1.0;
+    work->growth = 1.0;
+    work->max_bytes = 0UL;
+    work->cache = 0;
+    work->batch = 0;
+    work->repeat = 1;
+    work->tolerance = 0.10;
+    work->mem_tolerance = 0.01;
+}
+
+
+/* parse_option
+
+Sets an option of work from a line of the specification file. Lines have
+the form 'name = value'. Empty lines and lines starting with '#' are
+ignored.
+
+Parameters:
+work: the workload
+line: a null terminated line of the specification
+
+Returns: 1 if the line is valid, 0 otherwise */
+int parse_option(struct workload *work, char *line) {
+    char *name, *value, *end;
+    size_t len;
+
+    /* remove leading and trailing whitespace */
+    name = line + strspn(line, " \t");
+    len = strlen(name);
+    while (len && strchr(" \t\r\n", name[len - 1])) {
+        name[--len] = '\0';
+    }
+    if (!len || name[0] == '#') {
+        return 1;
+    }
+    value = strchr(name, '=');
+    if (!value) {
+        return 0;
+    }
+    end = value;
+    while (end > name && strchr(" \t", end[-1])) {
+        end--;
+    }
+    *end = '\0';
+    value++;
+    value += strspn(value, " \t");
+
+    if (!strcmp(name, "keys")) {
+        work->num_keys = atoi(value);
+    }
+    else if (!strcmp(name, "key_len")) {
+        if (sscanf(value, "%d-%d", &work->min_key_len, &work->max_key_len) != 2) {
+            work->min_key_len = work->max_key_len = atoi(value);
+        }
+    }
+    else if (!strcmp(name, "alphabet")) {
+        if (strlen(value) >= MAX_ALPHABET) {
+            return 0;
+        }
+        strcpy(work->alphabet, value);
+    }
+    else if (!strcmp(name, "key_dist")) {
+        if (strcmp(value, "uniform") && strcmp(value, "zipf")) {
+            return 0;
+        }
+        work->zipf = !strcmp(value, "zipf");
+    }
+    else if (!strcmp(name, "ops")) {
+        work->num_ops = atoi(value);
+    }
+    else if (!strcmp(name, "mix")) {
+        if (sscanf(value, "%d/%d/%d", &work->put, &work->get, &work->remove) != 3) {
+            return 0;
+        }
+    }
+    else if (!strcmp(name, "threads")) {
+        work->threads = atoi(value);
+    }
+    else if (!strcmp(name, "seed")) {
+        work->seed = strtoul(value, NULL, 10);
+    }
+    else if (!strcmp(name, "min_load")) {
+        work->min_load = atof(value);
+    }
+    else if (!strcmp(name, "max_load")) {
+        work->max_load = atof(value);
+    }
+    else if (!strcmp(name, "growth")) {
+        work->growth = atof(value);
+    }
+    else if (!strcmp(name, "max_bytes")) {
+        work->max_bytes = strtoul(value, NULL, 10);
+    }
+    else if (!strcmp(name, "cache")) {
+        work->cache = atoi(value);
+    }
+    else if (!strcmp(name, "batch")) {
+        work->batch = atoi(value);
+    }
+    else if (!strcmp(name, "repeat")) {
+        work->repeat = atoi(value);
+    }
+    else if (!strcmp(name, "tolerance")) {
+        work->tolerance = atof(value);
+    }
+    else if (!strcmp(name, "mem_tolerance")) {
+        work->mem_tolerance = atof(value);
+    }
+    else {
+        return 0;
+    }
+    return work->num_keys > 0 && work->min_key_len > 0 && work->max_key_len >= work->min_key_len &&
+        work->alphabet[0] && work->num_ops >= 0 && work->put >= 0 && work->get >= 0 &&
+        work->remove >= 0 && work->put + work->get + work->remove > 0 && work->threads > 0 &&
+        work->min_load >= 0.0 && work->min_load < work->max_load && work->growth >= 1.0 &&
+        work->cache >= 0 && work->batch >= 0 && work->repeat > 0 && work->tolerance >= 0.0 && work->mem_tolerance >= 0.0;
+}
+
+
+/* run_workload
+
+Creates the keys of work, fills a table with them and performs the
+operations of work on it.
+
+Parameters:
+work: the workload
+res: the results of the run
+
+Returns: void */
+void run_workload(const struct workload *work, struct result *res) {
+    SymTable_T oSymTable;
+    struct timespec start;
+    unsigned long state;
+    char **keys;
+    const void **value_ptrs;
+    const char **batch_keys;
+    void **batch_values;
+    int *values, *ops_key;
+    double *cdf, sum;
+    int i, j, len, alpha_len, total, low, high, mid, num_batch;
+
+    state = work->seed;
+    alpha_len = strlen(work->alphabet);
+    keys = malloc(work->num_keys * sizeof(char *));
+    values = malloc(work->num_keys * sizeof(int));
+    value_ptrs = malloc((work->num_keys + 1) * sizeof(void *));
+    ops_key = malloc((work->num_ops + 1) * sizeof(int));
+    assert(keys && values && value_ptrs && ops_key);
+    for (i = 0; i < work->num_keys; i++) {
+        len = work->min_key_len + next_random(&state) % (work->max_key_len - work->min_key_len + 1);
+        keys[i] = malloc(len + 1);
+        assert(keys[i]);
+        for (j = 0; j < len; j++) {
+            keys[i][j] = work->alphabet[next_random(&state) % alpha_len];
+        }
+        keys[i][len] = '\0';
+        values[i] = i;
+        value_ptrs[i] = &values[i];
+    }
+
+    /* keys of the operations: key i has weight 1/(i+1) with zipf */
+    cdf = NULL;
+    if (work->zipf) {
+        cdf = malloc(work->num_keys * sizeof(double));
+        assert(cdf);
+        sum = 0.0;
+        for (i = 0; i < work->num_keys; i++) {
+            sum += 1.0 / (i + 1);
+            cdf[i] = sum;
+        }
+    }
+    for (i = 0; i < work->num_ops; i++) {
+        if (!cdf) {
+            ops_key[i] = next_random(&state) % work->num_keys;
+            continue;
+        }
+        sum = cdf[work->num_keys - 1] * (next_random(&state) % 1000000) / 1000000.0;
+        low = 0;
+        high = work->num_keys - 1;
+        while (low < high) {
+            mid = (low + high) / 2;
+            if (cdf[mid] <= sum) {
+                low = mid + 1;
+            }
+            else {
+                high = mid;
+            }
+        }
+        ops_key[i] = low;
+    }
+
+    /* fill the table */
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (work->threads > 1) {
+        oSymTable = SymTable_buildParallel((const char **) keys, value_ptrs,
+            work->num_keys, work->threads);
+        assert(oSymTable);
+    }
+    else {
+        oSymTable = SymTable_new();
+        for (i = 0; i < work->num_keys; i++) {
+            SymTable_put(oSymTable, keys[i], &values[i]);
+        }
+    }
+    res->fill_time = elapsed(&start);
+    SymTable_setPolicy(oSymTable, work->min_load, work->max_load, work->growth, work->max_bytes);
+    if (!SymTable_setCache(oSymTable, work->cache)) {
+        fprintf(stderr, "%s: cannot allocate the cache\n", work->name);
+        exit(1);
+    }
+
+    /* the operations. batched gets are done before the next put or remove */
+    batch_keys = malloc((work->batch + 1) * sizeof(char *));
+    batch_values = malloc((work->batch + 1) * sizeof(void *));
+    assert(batch_keys && batch_values);
+    num_batch = 0;
+    total = work->put + work->get + work->remove;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (i = 0; i < work->num_ops; i++) {
+        j = next_random(&state) % total;
+        if (j >= work->put && j < work->put + work->get) {
+            if (!work->batch) {
+                SymTable_get(oSymTable, keys[ops_key[i]]);
+                continue;
+            }
+            batch_keys[num_batch++] = keys[ops_key[i]];
+            if (num_batch < work->batch) {
+                continue;
+            }
+        }
+        if (num_batch) {
+            SymTable_getBatch(oSymTable, batch_keys, num_batch, batch_values);
+            num_batch = 0;
+        }
+        if (j < work->put) {
+            SymTable_put(oSymTable, keys[ops_key[i]], &values[ops_key[i]]);
+        }
+        else if (j >= work->put + work->get) {
+            SymTable_remove(oSymTable, keys[ops_key[i]]);
+        }
+    }
+    if (num_batch) {
+        SymTable_getBatch(oSymTable, batch_keys, num_batch, batch_values);
+    }
+    res->ops_time = elapsed(&start);
+    res->bindings = SymTable_getLength(oSymTable);
+    res->bytes = SymTable_getBytes(oSymTable);
+
+    SymTable_free(oSymTable);
+    for (i = 0; i < work->num_keys; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    free(values);
+    free(value_ptrs);
+    free(batch_keys);
+    free(batch_values);
+    free(ops_key);
+    free(cdf);
+}
+
+
+/* summarize_runs
+
+Combines the runs of a workload into one result with the median times and
+the spread of the times.
+
+Parameters:
+work: the workload
+runs: the results of the work->repeat runs
+res: the combined result
+
+Returns: void */
+void summarize_runs(const struct workload *work, struct result *runs, struct result *res) {
+    double *times, spread;
+    int i, phase;
+
+    times = malloc(work->repeat * sizeof(double));
+    assert(times);
+    *res = runs[0];
+    res->noise = 0.0;
+    for (phase = 0; phase < 2; phase++) {
+        for (i = 0; i < work->repeat; i++) {
+            times[i] = phase ? runs[i].ops_time : runs[i].fill_time;
+        }
+        qsort(times, work->repeat, sizeof(double), compare_double);
+        if (phase) {
+            res->ops_time = times[work->repeat / 2];
+        }
+        else {
+            res->fill_time = times[work->repeat / 2];
+        }
+        if (times[work->repeat / 2] > 0.0) {
+            spread = (times[work->repeat - 1] - times[0]) / times[work->repeat / 2];
+            if (spread > res->noise) {
+                res->noise = spread;
+            }
+        }
+    }
+    free(times);
+}
+
+
+/* load_baseline
+
+Reads the results of a CSV run of the benchmark.
+
+Parameters:
+path: the baseline file
+base: array of MAX_BASELINES results
+
+Returns: the number of results read or -1 if the file cannot be opened */
+int load_baseline(const char *path, struct baseline *base) {
+    char line[MAX_LINE];
+    double ops_per_sec;
+    int keys, ops, threads, num_base;
+    unsigned int bindings;
+    FILE *file;
+
+    file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+    num_base = 0;
+    while (num_base < MAX_BASELINES && fgets(line, MAX_LINE, file)) {
+        if (sscanf(line, "%63[^,],%d,%d,%d,%lf,%lf,%lf,%u,%lu", base[num_base].name, &keys, &ops,
+                &threads, &base[num_base].fill_time, &base[num_base].ops_time, &ops_per_sec,
+                &bindings, &base[num_base].bytes) == 9) {
+            num_base++;
+        }
+    }
+    fclose(file);
+    return num_base;
+}
+
+
+/* check_result
+
+Compares the result of a workload with its baseline and prints every
+regression to stderr. Times are allowed to grow by the tolerance of the
+workload, or by twice the spread of its runs if that is larger. Times that
+are too short to measure reliably are not compared.
+
+Parameters:
+work: the workload
+res: the result of the workload
+base: array of baseline results
+num_base: number of baseline results
+
+Returns: the number of regressions */
+int check_result(const struct workload *work, const struct result *res, const struct baseline *base, int num_base) {
+    double tolerance;
+    int i, regressions;
+
+    for (i = 0; i < num_base && strcmp(base[i].name, work->name); i++) {
+        ;
+    }
+    if (i == num_base) {
+        fprintf(stderr, "%s: no baseline\n", work->name);
+        return 0;
+    }
+    tolerance = work->tolerance > 2 * res->noise ? work->tolerance : 2 * res->noise;
+
+    regressions = 0;
+    if (base[i].fill_time >= MIN_TIME && res->fill_time > base[i].fill_time * (1 + tolerance)) {
+        fprintf(stderr, "%s: fill time %f > baseline %f (+%.0f%% allowed)\n", work->name,
+            res->fill_time, base[i].fill_time, 100 * tolerance);
+        regressions++;
+    }
+    if (base[i].ops_time >= MIN_TIME && res->ops_time > base[i].ops_time * (1 + tolerance)) {
+        fprintf(stderr, "%s: operations time %f > baseline %f (+%.0f%% allowed)\n", work->name,
+            res->ops_time, base[i].ops_time, 100 * tolerance);
+        regressions++;
+    }
+    if (res->bytes > base[i].bytes * (1 + work->mem_tolerance)) {
+        fprintf(stderr, "%s: bytes %lu > baseline %lu (+%.0f%% allowed)\n", work->name,
+            (unsigned long) res->bytes, base[i].bytes, 100 * work->mem_tolerance);
+        regressions++;
+    }
+    return regressions;
+}
+
+
+/* print_result
+
+Prints the results of a workload. CSV results start with a header line and
+JSON results form an array of objects.
+
+Parameters:
+work: the workload
+res: the results of the workload
+json: 1 for JSON, 0 for CSV
+first: 1 if these are the first results
+
+Returns: void */
+void print_result(const struct workload *work, const struct result *res, int json, int first) {
+    double ops_per_sec;
+
+    ops_per_sec = res->ops_time > 0.0 ? work->num_ops / res->ops_time : 0.0;
+    if (json) {
+        printf("%s\n  {\"name\": \"%s\", \"keys\": %d, \"ops\": %d, \"threads\": %d, "
+            "\"fill_sec\": %f, \"ops_sec\": %f, \"ops_per_sec\": %.0f, "
+            "\"bindings\": %u, \"bytes\": %lu}",
+            first ? "[" : ",", work->name, work->num_keys, work->num_ops, work->threads,
+            res->fill_time, res->ops_time, ops_per_sec, res->bindings, (unsigned long) res->bytes);
+        return;
+    }
+    if (first) {
+        printf("name,keys,ops,threads,fill_sec,ops_sec,ops_per_sec,bindings,bytes\n");
+    }
+    printf("%s,%d,%d,%d,%f,%f,%.0f,%u,%lu\n", work->name, work->num_keys, work->num_ops,
+        work->threads, res->fill_time, res->ops_time, ops_per_sec, res->bindings,
+        (unsigned long) res->bytes);
+}
+
+
+/* compare_double
+
+Comparison function of qsort for doubles. */
+int compare_double(const void *a, const void *b) {
+    double x, y;
+
+    x = *(const double *) a;
+    y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+
+/* memory_benchmark
+
+Builds tables with 10^3 to 10^6 distinct keys of 8 to 64 characters and
+prints per binding:
+1) the bytes of the bucket array, the bindings and the key copies
+2) all bytes requested by the table
+3) the bytes taken from the allocator, when it can report them
+4) the difference of 3) and 2), which is the allocator overhead
+5) the growth of the resident memory of the process
+
+Parameters:
+json: 1 for JSON, 0 for CSV
+
+Returns: void */
+void memory_benchmark(int json) {
+    static const int SIZES[] = {1000, 10000, 100000, 1000000};
+    static const int KEY_LENS[] = {8, 16, 32, 64};
+    struct SymTable_memory mem;
+    SymTable_T oSymTable;
+    unsigned long state;
+    size_t alloc_before, rss_before;
+    double n, requested, allocated, resident;
+    char **keys;
+    int s, l, i, j, num_keys, len, first;
+
+    first = 1;
+    if (!json) {
+        printf("keys,key_len,buckets_per_binding,bindings_per_binding,keys_per_binding,"
+            "requested_per_binding,allocated_per_binding,overhead_per_binding,resident_per_binding\n");
+    }
+    for (s = 0; s < (int) (sizeof(SIZES) / sizeof(SIZES[0])); s++) {
+        for (l = 0; l < (int) (sizeof(KEY_LENS) / sizeof(KEY_LENS[0])); l++) {
+            num_keys = SIZES[s];
+            len = KEY_LENS[l];
+
+            /* distinct keys: the index in base 26 followed by random characters */
+            state = 1UL;
+            keys = malloc(num_keys * sizeof(char *));
+            assert(keys);
+            for (i = 0; i < num_keys; i++) {
+                keys[i] = malloc(len + 1);
+                assert(keys[i]);
+                for (j = 0; j < len; j++) {
+                    keys[i][j] = 'a' + next_random(&state) % 26;
+                }
+                for (j = 0, state = i; j < 5; j++, state /= 26) {
+                    keys[i][j] = 'a' + state % 26;
+                }
+                state = i + 1;
+                keys[i][len] = '\0';
+            }
+
+            alloc_before = allocated_bytes();
+            rss_before = resident_bytes();
+            oSymTable = SymTable_new();
+            for (i = 0; i < num_keys; i++) {
+                SymTable_put(oSymTable, keys[i], keys[i]);
+            }
+            n = SymTable_getLength(oSymTable);
+            SymTable_getMemory(oSymTable, &mem);
+            requested = SymTable_getBytes(oSymTable) / n;
+            allocated = (allocated_bytes() - alloc_before) / n;
+            resident = (resident_bytes() - rss_before) / n;
+            if (!alloc_before && !allocated) {
+                allocated = requested;
+            }
+
+            if (json) {
+                printf("%s\n  {\"keys\": %d, \"key_len\": %d, \"buckets_per_binding\": %.2f, "
+                    "\"bindings_per_binding\": %.2f, \"keys_per_binding\": %.2f, "
+                    "\"requested_per_binding\": %.2f, \"allocated_per_binding\": %.2f, "
+                    "\"overhead_per_binding\": %.2f, \"resident_per_binding\": %.2f}",
+                    first ? "[" : ",", num_keys, len, mem.uiBuckets / n, mem.uiBindings / n,
+                    mem.uiKeys / n, requested, allocated, allocated - requested, resident);
+            }
+            else {
+                printf("%d,%d,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n", num_keys, len,
+                    mem.uiBuckets / n, mem.uiBindings / n, mem.uiKeys / n, requested,
+                    allocated, allocated - requested, resident);
+            }
+            first = 0;
+
+            SymTable_free(oSymTable);
+            for (i = 0; i < num_keys; i++) {
+                free(keys[i]);
+            }
+            free(keys);
+        }
+    }
+    if (json) {
+        printf("\n]\n");
+    }
+}
+
+
+/* allocated_bytes
+
+Returns: the bytes currently taken from the allocator, including its
+overhead, or 0 if the allocator cannot report them */
+size_t allocated_bytes(void) {
+#ifdef __GLIBC__
+    struct mallinfo2 info;
+
+    info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0U;
+#endif
+}
+
+
+/* resident_bytes
+
+Returns: the resident memory of the process, or 0 if it cannot be read */
+size_t resident_bytes(void) {
+    unsigned long size, resident;
+    FILE *file;
+
+    file = fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0U;
+    }
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2) {
+        resident = 0UL;
+    }
+    fclose(file);
+    return resident * sysconf(_SC_PAGESIZE);
+}
@@ -0,0 +1,126 @@
+/* Benchmark of concurrent lookups in the thread-safe Symbol table library.
+
+Puts NUM_KEYS keys like key_12345 in a SymTableConc, then runs threads
+that each look up NUM_LOOKUPS present keys in their own random order, and
+prints the time until all threads are done, the best of NUM_RUNS runs. The
+keys and their orders are always the same, so the results only depend on
+the machine and the number of threads.
+
+The benchmark links with either implementation of symtableconc.h, see the
+benchhp and benchseq targets of the Makefile. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include <time.h>
+#include "symtableconc.h"
+#include "symtabutil.h"
+
+#define NUM_KEYS 50000
+#define NUM_LOOKUPS 3000000 /* lookups of each thread */
+#define NUM_RUNS 5
+#define MAX_KEY_LEN 32
+
+/* A reader thread.
+seed: seed of its random order of keys
+found: number of its lookups that found the right value */
+struct reader {
+    pthread_t thread;
+    unsigned long seed;
+    unsigned long found;
+};
+
+void *reader_main(void *arg);
+
+static SymTableConc_T table;
+static char *keys[NUM_KEYS];
+
+
+/*  main
+
+Parameters:
+argc: number of command line arguments.
+argv: command line arguments.
+    [THREADS]: number of reader threads, 4 by default
+
+Returns: 0, or 1 on a wrong argument */
+int main(int argc, char **argv) {
+    struct timespec start;
+    struct reader *readers;
+    char key[MAX_KEY_LEN];
+    double best, t;
+    int num_threads, run, i;
+
+    num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    if (argc > 2 || num_threads < 1) {
+        printf("Usage: %s [THREADS]\n", argv[0]);
+        return 1;
+    }
+    readers = malloc(num_threads * sizeof(struct reader));
+    assert(readers);
+    table = SymTableConc_new();
+    for (i = 0; i < NUM_KEYS; i++) {
+        sprintf(key, "key_%d", i);
+        keys[i] = malloc(strlen(key) + 1);
+        assert(keys[i]);
+        strcpy(keys[i], key);
+        SymTableConc_put(table, keys[i], keys[i]);
+    }
+
+    best = 0.0;
+    for (run = 0; run < NUM_RUNS; run++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (i = 0; i < num_threads; i++) {
+            readers[i].seed = i + 1UL;
+            readers[i].found = 0UL;
+            if (pthread_create(&readers[i].thread, NULL, reader_main, &readers[i])) {
+                printf("Cannot create thread\n");
+                exit(1);
+            }
+        }
+        for (i = 0; i < num_threads; i++) {
+            pthread_join(readers[i].thread, NULL);
+            assert(readers[i].found == NUM_LOOKUPS);
+        }
+        t = elapsed(&start);
+        best = run && best < t ? best : t;
+    }
+
+    printf("%d threads, %d lookups each in %d keys: %.3f s\n", num_threads, NUM_LOOKUPS, NUM_KEYS, best);
+
+    SymTableConc_free(table);
+    for (i = 0; i < NUM_KEYS; i++) {
+        free(keys[i]);
+    }
+    free(readers);
+    return 0;
+}
+
+
+/* reader_main
+
+Looks up NUM_LOOKUPS random keys.
+
+Parameters:
+arg: the struct reader of the thread
+
+Returns: NULL */
+void *reader_main(void *arg) {
+    struct reader *reader;
+    unsigned long state, key, found;
+    long j;
+
+    reader = arg;
+    state = reader->seed;
+    found = 0UL;
+    for (j = 0; j < NUM_LOOKUPS; j++) {
+        key = next_random(&state) % NUM_KEYS;
+        found += SymTableConc_get(table, keys[key]) == keys[key];
+    }
+    reader->found = found;
+    return NULL;
+}
@@ -0,0 +1,112 @@
+/* Benchmark of the extendible hashing Symbol table library against
+SymTable.
+
+Inserts NUM_KEYS keys like key_123456 in a SymTableExt and in a SymTable,
+then looks up NUM_LOOKUPS present keys in random order, and prints the time
+per insert and per lookup of each table, the best of NUM_RUNS runs, and the
+bytes of each table. The keys and their order are always the same, so the
+results only depend on the machine. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "symtable.h"
+#include "symtableext.h"
+#include "symtabutil.h"
+
+#define NUM_KEYS 500000
+#define NUM_LOOKUPS 2000000
+#define NUM_RUNS 5
+#define MAX_KEY_LEN 32
+
+
+/*  main
+
+Returns: 0 */
+int main(void) {
+    struct timespec start;
+    SymTable_T oSymTable;
+    SymTableExt_T oExt;
+    char **keys, key[MAX_KEY_LEN];
+    unsigned int *order;
+    unsigned long state, found;
+    size_t table_bytes, ext_bytes;
+    double table_insert, ext_insert, table_lookup, ext_lookup, t;
+    int run;
+    long i, j;
+
+    keys = malloc(NUM_KEYS * sizeof(char *));
+    order = malloc(NUM_LOOKUPS * sizeof(unsigned int));
+    assert(keys && order);
+    for (i = 0; i < NUM_KEYS; i++) {
+        sprintf(key, "key_%ld", i);
+        keys[i] = malloc(strlen(key) + 1);
+        assert(keys[i]);
+        strcpy(keys[i], key);
+    }
+    state = 1UL;
+    for (j = 0; j < NUM_LOOKUPS; j++) {
+        order[j] = next_random(&state) % NUM_KEYS;
+    }
+
+    table_insert = ext_insert = table_lookup = ext_lookup = 0.0;
+    table_bytes = ext_bytes = 0U;
+    found = 0UL;
+    for (run = 0; run < NUM_RUNS; run++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        oSymTable = SymTable_new();
+        for (i = 0; i < NUM_KEYS; i++) {
+            SymTable_put(oSymTable, keys[i], keys[i]);
+        }
+        t = elapsed(&start);
+        table_insert = run && table_insert < t ? table_insert : t;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        oExt = SymTableExt_new();
+        for (i = 0; i < NUM_KEYS; i++) {
+            SymTableExt_put(oExt, keys[i], keys[i]);
+        }
+        t = elapsed(&start);
+        ext_insert = run && ext_insert < t ? ext_insert : t;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < NUM_LOOKUPS; j++) {
+            found += SymTable_get(oSymTable, keys[order[j]]) == keys[order[j]];
+        }
+        t = elapsed(&start);
+        table_lookup = run && table_lookup < t ? table_lookup : t;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < NUM_LOOKUPS; j++) {
+            found += SymTableExt_get(oExt, keys[order[j]]) == keys[order[j]];
+        }
+        t = elapsed(&start);
+        ext_lookup = run && ext_lookup < t ? ext_lookup : t;
+
+        table_bytes = SymTable_getBytes(oSymTable);
+        ext_bytes = SymTableExt_getBytes(oExt);
+        SymTable_free(oSymTable);
+        SymTableExt_free(oExt);
+    }
+    assert(found == 2UL * NUM_RUNS * NUM_LOOKUPS);
+
+    printf("%lu keys like %s\n", (unsigned long) NUM_KEYS, keys[NUM_KEYS / 2]);
+    printf("%-10s %12s %12s %12s\n", "", "ns/insert", "ns/lookup", "bytes");
+    printf("%-10s %12.1f %12.1f %12lu\n", "SymTable", table_insert * 1e9 / NUM_KEYS,
+        table_lookup * 1e9 / NUM_LOOKUPS, (unsigned long) table_bytes);
+    printf("%-10s %12.1f %12.1f %12lu\n", "extendible", ext_insert * 1e9 / NUM_KEYS,
+        ext_lookup * 1e9 / NUM_LOOKUPS, (unsigned long) ext_bytes);
+    printf("%-10s %12.2f %12.2f %12.2f\n", "speedup", table_insert / ext_insert,
+        table_lookup / ext_lookup, (double) table_bytes / ext_bytes);
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    free(order);
+    return 0;
+}
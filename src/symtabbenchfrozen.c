@@ -0,0 +1,116 @@
+/* Benchmark of the frozen Symbol table library against SymTable.
+
+Builds a SymTable with NUM_KEYS keys like mylib::detail::Parser3::member_42,
+freezes it, and prints the bytes of the keys and of the whole table for
+both, and the time of NUM_LOOKUPS lookups of present keys in random order,
+the best of NUM_RUNS runs. The keys and their order are always the same,
+so the results only depend on the machine. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <time.h>
+#include "symtablefrozen.h"
+#include "symtabutil.h"
+
+#define NUM_MEMBERS 100     /* members of each class */
+#define NUM_KEYS (sizeof(NAMESPACES) / sizeof(NAMESPACES[0]) * \
+    sizeof(CLASSES) / sizeof(CLASSES[0]) * 10 * NUM_MEMBERS)
+#define NUM_LOOKUPS 2000000
+#define NUM_RUNS 5
+#define MAX_KEY_LEN 64
+
+static const char *const NAMESPACES[] = {"mylib::detail", "mylib::io", "mylib::net", "mylib::util",
+    "mylib::parse", "mylib::text", "mylib::math", "mylib::gui", "mylib::db", "mylib::test"};
+static const char *const CLASSES[] = {"Parser", "Lexer", "Token", "Buffer", "Stream", "Reader",
+    "Writer", "Socket", "Matrix", "Vector", "Widget", "Window", "Cursor", "Query", "Record",
+    "Schema", "Fixture", "Runner", "Handler"};
+
+
+/*  main
+
+Returns: 0 */
+int main(void) {
+    struct SymTable_memory memory;
+    struct timespec start;
+    SymTable_T oSymTable;
+    SymTableFrozen_T oFrozen;
+    char **keys, key[MAX_KEY_LEN];
+    unsigned int *order;
+    unsigned long state, found;
+    size_t table_bytes, frozen_bytes, frozen_key_bytes, ns, cls, variant, member;
+    double table_time, frozen_time, t;
+    int run;
+    long i, j;
+
+    keys = malloc(NUM_KEYS * sizeof(char *));
+    order = malloc(NUM_LOOKUPS * sizeof(unsigned int));
+    assert(keys && order);
+    i = 0;
+    for (ns = 0; ns < sizeof(NAMESPACES) / sizeof(NAMESPACES[0]); ns++) {
+        for (cls = 0; cls < sizeof(CLASSES) / sizeof(CLASSES[0]); cls++) {
+            for (variant = 0; variant < 10; variant++) {
+                for (member = 0; member < NUM_MEMBERS; member++) {
+                    sprintf(key, "%s::%s%lu::member_%lu", NAMESPACES[ns], CLASSES[cls],
+                        (unsigned long) variant, (unsigned long) member);
+                    keys[i] = malloc(strlen(key) + 1);
+                    assert(keys[i]);
+                    strcpy(keys[i++], key);
+                }
+            }
+        }
+    }
+    state = 1UL;
+    for (j = 0; j < NUM_LOOKUPS; j++) {
+        order[j] = next_random(&state) % NUM_KEYS;
+    }
+
+    oSymTable = SymTable_new();
+    for (i = 0; i < (long) NUM_KEYS; i++) {
+        SymTable_put(oSymTable, keys[i], keys[i]);
+    }
+    oFrozen = SymTableFrozen_freeze(oSymTable);
+    SymTable_getMemory(oSymTable, &memory);
+    table_bytes = SymTable_getBytes(oSymTable);
+    frozen_bytes = SymTableFrozen_getBytes(oFrozen, &frozen_key_bytes);
+
+    table_time = frozen_time = 0.0;
+    found = 0UL;
+    for (run = 0; run < NUM_RUNS; run++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < NUM_LOOKUPS; j++) {
+            found += SymTable_get(oSymTable, keys[order[j]]) == keys[order[j]];
+        }
+        t = elapsed(&start);
+        table_time = run && table_time < t ? table_time : t;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (j = 0; j < NUM_LOOKUPS; j++) {
+            found += SymTableFrozen_get(oFrozen, keys[order[j]]) == keys[order[j]];
+        }
+        t = elapsed(&start);
+        frozen_time = run && frozen_time < t ? frozen_time : t;
+    }
+    assert(found == 2UL * NUM_RUNS * NUM_LOOKUPS);
+
+    printf("%lu keys like %s\n", (unsigned long) NUM_KEYS, keys[NUM_KEYS / 2]);
+    printf("%-10s %12s %12s %12s\n", "", "key bytes", "bytes", "ns/lookup");
+    printf("%-10s %12lu %12lu %12.1f\n", "SymTable", (unsigned long) memory.uiKeys,
+        (unsigned long) table_bytes, table_time * 1e9 / NUM_LOOKUPS);
+    printf("%-10s %12lu %12lu %12.1f\n", "frozen", (unsigned long) frozen_key_bytes,
+        (unsigned long) frozen_bytes, frozen_time * 1e9 / NUM_LOOKUPS);
+    printf("%-10s %12.1f %12.1f %12.2f\n", "ratio", (double) memory.uiKeys / frozen_key_bytes,
+        (double) table_bytes / frozen_bytes, frozen_time / table_time);
+
+    SymTableFrozen_free(oFrozen);
+    SymTable_free(oSymTable);
+    for (i = 0; i < (long) NUM_KEYS; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    free(order);
+    return 0;
+}
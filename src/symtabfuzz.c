@@ -0,0 +1,350 @@
+/* Fuzzing and differential testing harness for the Symbol table library.
+
+Applies a sequence of operations decoded from an input to a SymTable and to
+a reference map that is simply an array indexed by key, and aborts as soon
+as the two disagree. After every operation the number of bindings and the
+bytes of the key copies are compared. Whenever the number of buckets
+changes, every key is looked up and the table is traversed with
+SymTable_map, so each resize is checked.
+
+The first byte of the input selects a plain table or a table with a blob
+(see SymTable_newBlob), and whether the table counts the references to its
+values with value callbacks, or owns them with only a release callback.
+The counts are compared with the reference map at every full check and
+must be 0 once the table is freed. Every following operation takes 3 bytes: an
+operation code and two bytes that select a key. Policy changes with small
+load factors are part of the operations, so that short inputs also make the
+table grow and shrink, and so are the lookup cache and access sampling.
+The keys of the key space that have the same hash code all go to one chain.
+
+The harness is linked with the driver of symtabharness.c. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "symtable.h"
+#include "symtabharness.h"
+
+#define NUM_VALUES 256      /* number of distinct values */
+#define RANDOM_LEN 60000    /* length of a random input */
+
+/* State of a test: the table and the reference map.
+present, values: whether each key is in the map and its value
+owned: whether the table has a copy of the key, i.e. it was not added by
+SymTable_putBlob
+num_bindings: number of keys in the map
+key_bytes: bytes of the key copies
+counted: whether the table has value callbacks
+retains: whether the table has a retain callback. Otherwise the test gives
+the table its reference to each value that it puts.
+refs: references to each value counted by the value callbacks */
+struct state {
+    SymTable_T table;
+    int blob;
+    char present[NUM_KEYS];
+    char owned[NUM_KEYS];
+    const void *values[NUM_KEYS];
+    unsigned int num_bindings;
+    size_t key_bytes;
+    int counted;
+    int retains;
+    long refs[NUM_VALUES];
+};
+
+void init_blob(void);
+void run_op(struct state *state, unsigned int op, unsigned int key);
+void check_all(struct state *state, SymTable_T table);
+void count_binding(const char *pcKey, void *pvValue, void *pvExtra);
+void retain_value(void *pvValue, void *pvExtra);
+void release_value(void *pvValue, void *pvExtra);
+void check_refs(struct state *state);
+
+/* random inputs narrow the key range of every operation in turn */
+const struct target target = {RANDOM_LEN, 1U, 0x00U, NULL, NULL, NULL, NULL, NULL};
+
+static size_t offsets[NUM_KEYS];
+static char *blob;
+static size_t blob_size;
+static char value_tokens[NUM_VALUES];
+
+
+/* LLVMFuzzerTestOneInput
+
+Runs one input.
+
+Parameters:
+data: the input
+size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+    static struct state state;
+    struct SymTable_memory mem;
+    size_t pos, buckets;
+
+    if (!size) {
+        return 0;
+    }
+    init_blob();
+    memset(&state, 0, sizeof(state));
+    state.blob = data[0] & 1;
+    state.table = state.blob ? SymTable_newBlob(blob, blob_size) : SymTable_new();
+    state.counted = (data[0] & 2) != 0;
+    state.retains = (data[0] & 4) == 0;
+    if (state.counted) {
+        SymTable_setValueCallbacks(state.table, state.retains ? retain_value : NULL, release_value, &state);
+    }
+    SymTable_getMemory(state.table, &mem);
+    buckets = mem.uiBuckets;
+
+    for (pos = 1; pos + 3 <= size; pos += 3) {
+        run_op(&state, data[pos], data[pos + 1] | (data[pos + 2] << 8));
+        if (SymTable_getLength(state.table) != state.num_bindings) {
+            fail("wrong length", 0U);
+        }
+        SymTable_getMemory(state.table, &mem);
+        if (mem.uiKeys != state.key_bytes) {
+            fail("wrong key bytes", 0U);
+        }
+        if (mem.uiBuckets != buckets) {
+            buckets = mem.uiBuckets;
+            check_all(&state, state.table);
+        }
+    }
+    check_all(&state, state.table);
+    check_refs(&state);
+    SymTable_free(state.table);
+    memset(state.present, 0, sizeof(state.present));
+    check_refs(&state);
+    return 0;
+}
+
+
+/* init_blob
+
+Creates the key space once and stores all keys in a blob, separated by
+'\0'. */
+void init_blob(void) {
+    int i;
+
+    if (blob) {
+        return;
+    }
+    init_keys();
+    blob_size = 0U;
+    for (i = 0; i < NUM_KEYS; i++) {
+        offsets[i] = blob_size;
+        blob_size += strlen(keys[i]) + 1;
+    }
+    blob = malloc(blob_size);
+    assert(blob);
+    for (i = 0; i < NUM_KEYS; i++) {
+        strcpy(blob + offsets[i], keys[i]);
+    }
+}
+
+
+/* run_op
+
+Applies one operation to the table and to the reference map and compares
+the results. The low 3 bits of op select the operation, the other bits
+its value or its variant.
+
+Parameters:
+state: the test
+op: operation code
+key: selects the key */
+void run_op(struct state *state, unsigned int op, unsigned int key) {
+    const void *value;
+    void *taken_value;
+    char *taken_key;
+    SymTable_T snap;
+    size_t max_bytes;
+    int found;
+
+    key %= NUM_KEYS;
+    value = &value_tokens[(op >> 3) * 7 % NUM_VALUES];
+    switch (op & 7U) {
+        case 0:
+        case 1:
+            /* a table that only releases takes over a reference, unless it
+            already holds the value for this key */
+            if (state->counted && !state->retains && !(state->present[key] && state->values[key] == value)) {
+                retain_value((void *) value, state);
+            }
+            if (state->blob && (op & 1U)) {
+                SymTable_putBlob(state->table, offsets[key], value);
+            }
+            else if (op & 0x80U) {
+                if (!SymTable_tryPut(state->table, keys[key], value)) {
+                    fail("tryPut failed", key);
+                }
+            }
+            else {
+                SymTable_put(state->table, keys[key], value);
+            }
+            if (!state->present[key]) {
+                state->present[key] = 1;
+                state->owned[key] = !(state->blob && (op & 1U));
+                state->num_bindings++;
+                if (state->owned[key]) {
+                    state->key_bytes += strlen(keys[key]) + 1;
+                }
+            }
+            state->values[key] = value;
+            break;
+        case 2:
+            if (op & 0x80U) {
+                taken_value = NULL;
+                taken_key = NULL;
+                found = SymTable_take(state->table, keys[key], &taken_value, (op & 0x40U) ? &taken_key : NULL);
+                if (found < 0) {
+                    fail("cannot allocate taken key", key);
+                }
+                if (found && (taken_value != state->values[key] ||
+                        ((op & 0x40U) && strcmp(taken_key, keys[key])))) {
+                    fail("wrong take result", key);
+                }
+                free(taken_key);
+                /* the reference held by the table is now ours */
+                if (found && state->counted) {
+                    release_value(taken_value, state);
+                }
+            }
+            else {
+                found = SymTable_remove(state->table, keys[key]);
+            }
+            if (found != state->present[key]) {
+                fail("wrong remove result", key);
+            }
+            if (found) {
+                state->present[key] = 0;
+                state->num_bindings--;
+                if (state->owned[key]) {
+                    state->key_bytes -= strlen(keys[key]) + 1;
+                }
+            }
+            break;
+        case 7:
+            /* 1 in 16 of these checks the whole table */
+            if (!(op & 0x78U)) {
+                check_all(state, state->table);
+                if (op & 0x80U) {
+                    snap = SymTable_snapshot(state->table);
+                    assert(snap);
+                    check_all(state, snap);
+                    SymTable_free(snap);
+                }
+                check_refs(state);
+                break;
+            }
+            /* fall through */
+        case 3:
+        case 4:
+            if (SymTable_get(state->table, keys[key]) != (state->present[key] ? state->values[key] : NULL)) {
+                fail("wrong get result", key);
+            }
+            break;
+        case 5:
+            if (SymTable_contains(state->table, keys[key]) != state->present[key]) {
+                fail("wrong contains result", key);
+            }
+            break;
+        case 6:
+            if (op & 0x40U) {
+                if (!SymTable_setCache(state->table, key & 0x3FFU) ||
+                        !SymTable_setSampling(state->table, (key >> 10) & 3U)) {
+                    fail("cannot allocate cache or sampling", key);
+                }
+                break;
+            }
+            /* max load in [0.125, 2], min load below it or 0, growth in
+            [1, 2.5], and sometimes a memory cap close to the current size */
+            max_bytes = (op & 0x80U) ? SymTable_getBytes(state->table) + (key & 0xFFU) * 64 : 0U;
+            SymTable_setPolicy(state->table, ((key >> 8) & 3U) * ((key & 15U) + 1) / 64.0,
+                ((key & 15U) + 1) / 8.0, 1 + ((op >> 3) & 3U) * 0.5, max_bytes);
+            break;
+    }
+}
+
+
+/* check_all
+
+Compares every key of table with the reference map, one at a time and with
+SymTable_getBatch, and traverses table.
+
+Parameters:
+state: the test
+table: the table of the test or a snapshot of it */
+void check_all(struct state *state, SymTable_T table) {
+    static void *batch_values[NUM_KEYS];
+    unsigned int count;
+    int i;
+
+    SymTable_getBatch(table, (const char **) keys, NUM_KEYS, batch_values);
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (SymTable_get(table, keys[i]) != (state->present[i] ? state->values[i] : NULL) ||
+                batch_values[i] != (state->present[i] ? state->values[i] : NULL) ||
+                SymTable_contains(table, keys[i]) != state->present[i]) {
+            fail("wrong binding", i);
+        }
+    }
+    count = 0U;
+    SymTable_map(table, count_binding, &count);
+    if (count != state->num_bindings || SymTable_getLength(table) != state->num_bindings) {
+        fail("wrong number of bindings", 0U);
+    }
+}
+
+
+/* count_binding
+
+Function of SymTable_map that counts the bindings. */
+void count_binding(const char *pcKey, void *pvValue, void *pvExtra) {
+    (*(unsigned int *) pvExtra)++;
+}
+
+
+/* retain_value, release_value
+
+Value callbacks that count the references to each value of a test.
+
+Parameters:
+pvValue: one of value_tokens
+pvExtra: the test */
+void retain_value(void *pvValue, void *pvExtra) {
+    ((struct state *) pvExtra)->refs[(char *) pvValue - value_tokens]++;
+}
+
+void release_value(void *pvValue, void *pvExtra) {
+    if (--((struct state *) pvExtra)->refs[(char *) pvValue - value_tokens] < 0) {
+        fail("value released too often", 0U);
+    }
+}
+
+
+/* check_refs
+
+Compares the references counted by the value callbacks with the number of
+keys of the reference map that have each value. Without callbacks the
+counts must stay 0.
+
+Parameters:
+state: the test */
+void check_refs(struct state *state) {
+    long expected[NUM_VALUES];
+    int i;
+
+    memset(expected, 0, sizeof(expected));
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (state->present[i]) {
+            expected[(const char *) state->values[i] - value_tokens]++;
+        }
+    }
+    for (i = 0; i < NUM_VALUES; i++) {
+        if (state->refs[i] != (state->counted ? expected[i] : 0L)) {
+            fail("wrong number of references", 0U);
+        }
+    }
+}
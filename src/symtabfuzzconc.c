@@ -0,0 +1,440 @@
+/* Fuzzing and differential testing harness for the thread-safe Symbol table
+library.
+
+Applies a sequence of operations decoded from an input to a SymTableConc
+and to a reference map of the same key space, and aborts at the first
+difference. Every key is compared at the end, and the table is traversed
+and freed, so that a memory checker finds bindings that are lost or freed
+twice. The key space is large enough for several resizes. SymTableConc_atomicAdd
+and SymTableConc_compareAndSwap are applied to keys of either kind of
+value, and to missing keys.
+
+With -t the harness runs threads on one table at the same time. Stable keys
+are put before the threads start and must always be found with their
+value. Every writer thread puts and removes its own keys and keeps their
+reference map, which is compared with the table when all threads are done.
+Writers also count in shared counter keys, which do not exist at first,
+with SymTableConc_atomicAdd or with SymTableConc_compareAndSwap after a get,
+and record how many times they counted in each: no count may be lost.
+Reader threads check the stable keys and that other keys have their own
+value or none, while the writers grow the table. It is meant to be built
+with -fsanitize=thread or address on a machine with several cores.
+
+The harness links with either implementation of symtableconc.h, see the
+fuzzhp and fuzzseq targets of the Makefile, and with the driver of
+symtabharness.c. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "symtableconc.h"
+#include "symtabharness.h"
+
+#define NUM_VALUES 4        /* number of distinct values */
+#define RANDOM_LEN 30000    /* length of a random input */
+#define NUM_STABLE 1024     /* keys that stay in the table with -t */
+#define NUM_COUNTERS 16     /* keys counted in by all writers with -t */
+#define FIRST_OWN (NUM_STABLE + NUM_COUNTERS)   /* first key of the writers */
+#define THREAD_OPS 200000   /* operations of each writer thread with -t */
+
+/* The reference map of a test.
+present, values: whether each key is in the table and its value
+num_bindings: number of keys in the table */
+struct reference {
+    char present[NUM_KEYS];
+    void *values[NUM_KEYS];
+    unsigned int num_bindings;
+};
+
+/* A thread of -t.
+index, num_writers: number of the writer and number of writers
+stop: set when the writers are done, for readers
+counts: number of times a writer counted in each counter key */
+struct thread {
+    pthread_t thread;
+    int index;
+    int num_writers;
+    int *stop;
+    long counts[NUM_COUNTERS];
+};
+
+void run_op(SymTableConc_T table, struct reference *reference, unsigned int op, unsigned int arg);
+void check_table(SymTableConc_T table, struct reference *reference);
+void check_binding(const char *pcKey, void *pvValue, void *pvExtra);
+int run_threads(const char *arg);
+void *writer_main(void *arg);
+void *reader_main(void *arg);
+void count(unsigned int key, unsigned long random, long *last);
+
+/* random inputs keep the high bits of the key argument for case 7 */
+const struct target target = {RANDOM_LEN, 0U, 0xF0U, NULL, "-t", run_threads, NULL, NULL};
+
+static char value_tokens[NUM_VALUES];
+static SymTableConc_T shared_table;
+
+
+/* LLVMFuzzerTestOneInput
+
+Runs one input.
+
+Parameters:
+data: the input
+size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+    static struct reference reference;
+    SymTableConc_T table;
+    size_t pos;
+
+    init_keys();
+    memset(&reference, 0, sizeof(reference));
+    table = SymTableConc_new();
+    for (pos = 0; pos + 3 <= size; pos += 3) {
+        run_op(table, &reference, data[pos], data[pos + 1] | (data[pos + 2] << 8));
+    }
+    check_table(table, &reference);
+    SymTableConc_free(table);
+    return 0;
+}
+
+
+/* run_op
+
+Applies one operation to the table and to the reference map and compares
+the results. The low 4 bits of op select the operation and the high bits
+the value, or what atomicAdd adds. The low 12 bits of arg select the key,
+and the high bits the value that compareAndSwap expects, unless it expects
+the current one.
+
+Parameters:
+table: the table
+reference: its reference map
+op: operation code
+arg: selects the key */
+void run_op(SymTableConc_T table, struct reference *reference, unsigned int op, unsigned int arg) {
+    unsigned int key;
+    void *value, *expected, *current;
+    long delta;
+
+    key = arg % NUM_KEYS;
+    value = &value_tokens[(op >> 4) % NUM_VALUES];
+    current = reference->present[key] ? reference->values[key] : NULL;
+    switch (op & 15U) {
+        case 0:
+        case 1:
+        case 2:
+        case 12:
+        case 13:
+            SymTableConc_put(table, keys[key], value);
+            if (!reference->present[key]) {
+                reference->present[key] = 1;
+                reference->num_bindings++;
+            }
+            reference->values[key] = value;
+            break;
+        case 3:
+        case 4:
+        case 14:
+            if (SymTableConc_remove(table, keys[key]) != reference->present[key]) {
+                fail("wrong remove result", key);
+            }
+            if (reference->present[key]) {
+                reference->present[key] = 0;
+                reference->num_bindings--;
+            }
+            break;
+        case 5:
+        case 15:
+            if (SymTableConc_get(table, keys[key]) != current) {
+                fail("wrong get result", key);
+            }
+            break;
+        case 6:
+            if (SymTableConc_contains(table, keys[key]) != reference->present[key]) {
+                fail("wrong contains result", key);
+            }
+            break;
+        case 7:
+            /* 1 in 16 of these checks the whole table */
+            if (!(arg & 0xF000U)) {
+                check_table(table, reference);
+            }
+            if (SymTableConc_getLength(table) != reference->num_bindings) {
+                fail("wrong length", key);
+            }
+            break;
+        case 8:
+        case 9:
+            /* the value of a binding becomes a count, or a count a value */
+            delta = (long) (op >> 4) - 8;
+            value = (void *) (size_t) ((long) (size_t) current + delta);
+            if (SymTableConc_atomicAdd(table, keys[key], delta) != (long) (size_t) value) {
+                fail("wrong atomicAdd result", key);
+            }
+            if (!reference->present[key]) {
+                reference->present[key] = 1;
+                reference->num_bindings++;
+            }
+            reference->values[key] = value;
+            break;
+        case 10:
+        case 11:
+            expected = (op & 1U) ? current : &value_tokens[(arg >> 12) % NUM_VALUES];
+            if (SymTableConc_compareAndSwap(table, keys[key], expected, value) !=
+                    (reference->present[key] && current == expected)) {
+                fail("wrong compareAndSwap result", key);
+            }
+            if (reference->present[key] && current == expected) {
+                reference->values[key] = value;
+            }
+            break;
+    }
+}
+
+
+/* check_table
+
+Compares every key of the table with the reference map and traverses it.
+
+Parameters:
+table: the table
+reference: its reference map */
+void check_table(SymTableConc_T table, struct reference *reference) {
+    struct reference seen;
+    int i;
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (SymTableConc_get(table, keys[i]) != (reference->present[i] ? reference->values[i] : NULL) ||
+                SymTableConc_contains(table, keys[i]) != reference->present[i]) {
+            fail("wrong binding", i);
+        }
+    }
+    memset(&seen, 0, sizeof(seen));
+    SymTableConc_map(table, check_binding, &seen);
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (seen.present[i] != reference->present[i] || (seen.present[i] && seen.values[i] != reference->values[i])) {
+            fail("wrong binding in map", i);
+        }
+    }
+    if (seen.num_bindings != reference->num_bindings || SymTableConc_getLength(table) != reference->num_bindings) {
+        fail("wrong number of bindings", 0U);
+    }
+}
+
+
+/* check_binding
+
+Function of SymTableConc_map that records each binding in a reference map,
+failing on keys that are not in the key space or are found twice. */
+void check_binding(const char *pcKey, void *pvValue, void *pvExtra) {
+    struct reference *seen;
+    unsigned int key;
+
+    seen = pvExtra;
+    key = key_index(pcKey);
+    if (key >= NUM_KEYS || strcmp(pcKey, keys[key]) || seen->present[key]) {
+        fprintf(stderr, "unexpected key in map (key %s)\n", pcKey);
+        abort();
+    }
+    seen->present[key] = 1;
+    seen->values[key] = pvValue;
+    seen->num_bindings++;
+}
+
+
+/* run_threads
+
+Puts the stable keys, then runs num_threads writer threads and as many
+reader threads on the same table. Writer w owns the keys FIRST_OWN + w,
+FIRST_OWN + w + num_threads and so on. When all threads are done the table
+is compared with the reference maps of the writers, and each counter key
+with the sum of the counts of the writers.
+
+Parameters:
+arg: number of writer threads and of reader threads, 4 if it is NULL or
+not a positive number
+
+Returns: 0 */
+int run_threads(const char *arg) {
+    struct thread *threads;
+    struct reference **writer_references, reference;
+    long sum;
+    int num_threads, stop, i, j;
+
+    num_threads = arg && atoi(arg) > 0 ? atoi(arg) : 4;
+    init_keys();
+    shared_table = SymTableConc_new();
+    for (i = 0; i < NUM_STABLE; i++) {
+        SymTableConc_put(shared_table, keys[i], keys[i]);
+    }
+    threads = malloc(2 * num_threads * sizeof(struct thread));
+    writer_references = malloc(num_threads * sizeof(struct reference *));
+    assert(threads && writer_references);
+
+    stop = 0;
+    for (i = 0; i < 2 * num_threads; i++) {
+        threads[i].index = i;
+        threads[i].num_writers = num_threads;
+        threads[i].stop = &stop;
+        memset(threads[i].counts, 0, sizeof(threads[i].counts));
+        assert(!pthread_create(&threads[i].thread, NULL,
+                i < num_threads ? writer_main : reader_main, &threads[i]));
+    }
+    for (i = 0; i < num_threads; i++) {
+        pthread_join(threads[i].thread, (void **) &writer_references[i]);
+    }
+    __atomic_store_n(&stop, 1, __ATOMIC_SEQ_CST);
+    for (i = num_threads; i < 2 * num_threads; i++) {
+        pthread_join(threads[i].thread, NULL);
+    }
+
+    /* merge the reference maps of the writers with the stable keys and the
+    counts */
+    memset(&reference, 0, sizeof(reference));
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (i < NUM_STABLE) {
+            reference.present[i] = 1;
+            reference.values[i] = keys[i];
+        }
+        else if (i < FIRST_OWN) {
+            for (j = 0, sum = 0L; j < num_threads; j++) {
+                sum += threads[j].counts[i - NUM_STABLE];
+            }
+            reference.present[i] = sum > 0L;
+            reference.values[i] = (void *) (size_t) sum;
+        }
+        else {
+            reference.present[i] = writer_references[(i - FIRST_OWN) % num_threads]->present[i];
+            reference.values[i] = writer_references[(i - FIRST_OWN) % num_threads]->values[i];
+        }
+        reference.num_bindings += reference.present[i];
+    }
+    check_table(shared_table, &reference);
+    SymTableConc_free(shared_table);
+    for (i = 0; i < num_threads; i++) {
+        free(writer_references[i]);
+    }
+    free(writer_references);
+    free(threads);
+    printf("%d threads passed\n", num_threads);
+    return 0;
+}
+
+
+/* writer_main
+
+Puts and removes random keys of the thread, recording them in its own
+reference map, and checks its keys after every change. The value of a key
+is the key itself or NULL. One in four operations counts in a counter key
+instead.
+
+Parameters:
+arg: the struct thread of the thread
+
+Returns: the reference map of the keys of the thread */
+void *writer_main(void *arg) {
+    struct thread *thread;
+    struct reference *reference;
+    unsigned long state, random;
+    unsigned int key, num_own;
+    long i, last[NUM_COUNTERS];
+
+    thread = arg;
+    reference = calloc(1, sizeof(struct reference));
+    assert(reference);
+    memset(last, 0, sizeof(last));
+    num_own = (NUM_KEYS - FIRST_OWN - thread->index + thread->num_writers - 1) / thread->num_writers;
+    state = 2UL * thread->index + 1UL;
+    for (i = 0; i < THREAD_OPS; i++) {
+        random = next_random(&state);
+        if (!(random & 3UL)) {
+            key = (random >> 2) % NUM_COUNTERS;
+            count(NUM_STABLE + key, random >> 6, &last[key]);
+            thread->counts[key]++;
+            continue;
+        }
+        key = FIRST_OWN + (next_random(&state) % num_own) * thread->num_writers + thread->index;
+        if (next_random(&state) & 1) {
+            if (SymTableConc_remove(shared_table, keys[key]) != reference->present[key]) {
+                fail("wrong remove result", key);
+            }
+            reference->present[key] = 0;
+            reference->values[key] = NULL;
+        }
+        else {
+            reference->present[key] = 1;
+            reference->values[key] = (next_random(&state) & 1) ? keys[key] : NULL;
+            SymTableConc_put(shared_table, keys[key], reference->values[key]);
+        }
+        if (SymTableConc_get(shared_table, keys[key]) != reference->values[key] ||
+                SymTableConc_contains(shared_table, keys[key]) != reference->present[key]) {
+            fail("wrong binding of writer", key);
+        }
+    }
+    return reference;
+}
+
+
+/* count
+
+Adds 1 to the count of a counter key, with SymTableConc_atomicAdd or, if
+the key exists, with SymTableConc_compareAndSwap until no other thread
+changed the count between the get and the swap. Counts only grow, so each
+must be larger than the last one the thread saw.
+
+Parameters:
+key: the counter key
+random: selects the function
+last: the last count of the key seen by the thread */
+void count(unsigned int key, unsigned long random, long *last) {
+    void *value;
+    long result;
+
+    if ((random & 1UL) || !SymTableConc_contains(shared_table, keys[key])) {
+        result = SymTableConc_atomicAdd(shared_table, keys[key], 1L);
+    }
+    else {
+        do {
+            value = SymTableConc_get(shared_table, keys[key]);
+        } while (!SymTableConc_compareAndSwap(shared_table, keys[key], value, (void *) ((size_t) value + 1)));
+        result = (long) (size_t) value + 1L;
+    }
+    if (result <= *last) {
+        fail("count did not grow", key);
+    }
+    *last = result;
+}
+
+
+/* reader_main
+
+Looks up random keys until the writers are done. Stable keys must always
+be found with their value, counter keys must have a count that a writer can
+reach, and other keys must have their own key as value, or NULL.
+
+Parameters:
+arg: the struct thread of the thread
+
+Returns: NULL */
+void *reader_main(void *arg) {
+    struct thread *thread;
+    unsigned long state;
+    unsigned int key;
+    void *value;
+
+    thread = arg;
+    state = 2UL * thread->index + 1UL;
+    while (!__atomic_load_n(thread->stop, __ATOMIC_SEQ_CST)) {
+        key = next_random(&state) % NUM_KEYS;
+        value = SymTableConc_get(shared_table, keys[key]);
+        if (key < NUM_STABLE ? value != keys[key] || !SymTableConc_contains(shared_table, keys[key])
+                : key < FIRST_OWN ? (size_t) value > (size_t) THREAD_OPS * thread->num_writers
+                : value && value != keys[key]) {
+            fail("wrong binding of reader", key);
+        }
+    }
+    return NULL;
+}
@@ -0,0 +1,310 @@
+/* Fuzzing and differential testing harness for the disk based Symbol table
+library.
+
+Applies a sequence of operations decoded from an input to a SymTableDisk
+and to a reference map of the same key space, and aborts at the first
+difference. Values are byte strings of 0 to 70000 bytes whose contents are
+derived from a stamp that changes with every put, so that a lookup that
+returns an old record or the record of another key is detected. Values of
+all sizes make the log grow by megabytes, so inputs compact it many times,
+and some are larger than the write buffer. Batched lookups get keys that
+are present, missing or repeated, and each key must get its value exactly
+once.
+
+The first byte of an input selects the memory budget of the table, from
+none to more than the whole log, and whether the size of files is limited
+to FILE_LIMIT bytes, so that writes fail once the log reaches it. A put
+that fails must leave the table unchanged.
+
+The harness is linked with the driver of symtabharness.c. */
+
+#define _XOPEN_SOURCE 500
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "symtabledisk.h"
+#include "symtabharness.h"
+
+#define MAX_VALUE 70000     /* maximum size of a value */
+#define RANDOM_LEN 15000    /* length of a random input */
+#define FILE_LIMIT 4194304  /* size of files when it is limited */
+#define MAX_BATCH 64        /* maximum number of keys of a batched lookup */
+
+/* bytes of records kept in memory, selected by an input */
+static size_t const BUDGETS[4] = {0U, 4096U, 262144U, 67108864U};
+
+/* unit of the size of a value, selected by an operation */
+static size_t const SIZE_UNITS[4] = {1U, 64U, 1024U, 10000U};
+
+/* The reference map of a test.
+present, sizes, stamps: whether each key is in the table, the size of its
+value and the stamp its contents are derived from
+num_bindings: number of keys in the table */
+struct reference {
+    char present[NUM_KEYS];
+    size_t sizes[NUM_KEYS];
+    unsigned int stamps[NUM_KEYS];
+    unsigned int num_bindings;
+};
+
+void run_op(SymTableDisk_T table, struct reference *reference, unsigned int op, unsigned int arg);
+void check_value(struct reference *reference, unsigned int key, const void *value, size_t size);
+void check_table(SymTableDisk_T table, struct reference *reference);
+void check_binding(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra);
+void check_batch(unsigned int uiIndex, const void *pvValue, size_t uiSize, void *pvExtra);
+void make_value(unsigned int stamp, size_t size);
+void limit_files(int limit);
+
+/* random inputs narrow the key range of every operation in turn */
+const struct target target = {RANDOM_LEN, 1U, 0x00U, NULL, NULL, NULL, NULL, NULL};
+
+static unsigned char value[MAX_VALUE];
+static unsigned int next_stamp;
+static unsigned int bindings_seen;
+static unsigned int batch_keys[MAX_BATCH];
+static char batch_done[MAX_BATCH];
+static char path[64];
+
+
+/* LLVMFuzzerTestOneInput
+
+Runs one input. The first input also sets the path of the log files.
+
+Parameters:
+data: the input
+size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+    static struct reference reference;
+    SymTableDisk_T table;
+    size_t pos;
+
+    if (!size) {
+        return 0;
+    }
+    init_keys();
+    if (!path[0]) {
+        sprintf(path, "/tmp/symtabfuzzdisk.%ld", (long) getpid());
+
+        /* writes beyond the limit fail instead of killing the process */
+        signal(SIGXFSZ, SIG_IGN);
+    }
+    memset(&reference, 0, sizeof(reference));
+    table = SymTableDisk_new(path, BUDGETS[data[0] & 3U]);
+    if (!table) {
+        fprintf(stderr, "Cannot create %s\n", path);
+        abort();
+    }
+    limit_files(data[0] & 4U);
+    for (pos = 1; pos + 3 <= size; pos += 3) {
+        run_op(table, &reference, data[pos], data[pos + 1] | (data[pos + 2] << 8));
+    }
+    check_table(table, &reference);
+    limit_files(0);
+    SymTableDisk_free(table);
+    return 0;
+}
+
+
+/* run_op
+
+Applies one operation to the table and to the reference map and compares
+the results. The low 3 bits of op select the operation, the next 2 bits the
+unit of the size of a value and the high 3 bits the number of units. arg
+selects the key.
+
+Parameters:
+table: the table
+reference: its reference map
+op: operation code
+arg: selects the key */
+void run_op(SymTableDisk_T table, struct reference *reference, unsigned int op, unsigned int arg) {
+    const char *keys_of_batch[MAX_BATCH];
+    const void *found;
+    unsigned int key, count, ui;
+    size_t size;
+
+    key = arg % NUM_KEYS;
+    switch (op & 7U) {
+        case 0:
+        case 1:
+        case 2:
+            size = (op >> 5) * SIZE_UNITS[(op >> 3) & 3U];
+            make_value(next_stamp, size);
+            if (!SymTableDisk_put(table, keys[key], value, size)) {
+                /* only writes can fail, and only with a file size limit */
+                if (SymTableDisk_getLength(table) != reference->num_bindings) {
+                    fail("failed put changed the table", key);
+                }
+                break;
+            }
+            if (!reference->present[key]) {
+                reference->present[key] = 1;
+                reference->num_bindings++;
+            }
+            reference->sizes[key] = size;
+            reference->stamps[key] = next_stamp++;
+            break;
+        case 3:
+            if (SymTableDisk_remove(table, keys[key]) != reference->present[key]) {
+                fail("wrong remove result", key);
+            }
+            if (reference->present[key]) {
+                reference->present[key] = 0;
+                reference->num_bindings--;
+            }
+            break;
+        case 4:
+            found = SymTableDisk_get(table, keys[key], &size);
+            check_value(reference, key, found, size);
+            break;
+        case 7:
+            /* keys at a stride from key, so that some are repeated */
+            count = 1U + (op >> 3) % MAX_BATCH;
+            for (ui = 0U; ui < count; ui++) {
+                batch_keys[ui] = (key + ui * (op >> 6) * 37U) % NUM_KEYS;
+                keys_of_batch[ui] = keys[batch_keys[ui]];
+                batch_done[ui] = 0;
+            }
+            if (!SymTableDisk_getBatch(table, keys_of_batch, count, check_batch, reference)) {
+                fail("cannot read the log", key);
+            }
+            for (ui = 0U; ui < count; ui++) {
+                if (!batch_done[ui]) {
+                    fail("batched lookup without value", batch_keys[ui]);
+                }
+            }
+            break;
+        case 5:
+            if (SymTableDisk_contains(table, keys[key]) != reference->present[key]) {
+                fail("wrong contains result", key);
+            }
+            break;
+        case 6:
+            /* 1 in 32 of these checks the whole table */
+            if (!(op & 0xF8U)) {
+                check_table(table, reference);
+            }
+            if (SymTableDisk_getLength(table) != reference->num_bindings) {
+                fail("wrong length", key);
+            }
+            break;
+    }
+}
+
+
+/* check_value
+
+Compares a value found in the table with the reference map.
+
+Parameters:
+reference: the reference map
+key: the key of the value
+found: the value, or NULL if the key was not found
+size: size of the value */
+void check_value(struct reference *reference, unsigned int key, const void *found, size_t size) {
+    if (!found != !reference->present[key]) {
+        fail(found ? "removed key found" : "key not found", key);
+    }
+    if (!found) {
+        return;
+    }
+    make_value(reference->stamps[key], reference->sizes[key]);
+    if (size != reference->sizes[key] || memcmp(found, value, size)) {
+        fail("wrong value", key);
+    }
+}
+
+
+/* check_table
+
+Compares every key of the table with the reference map and traverses it.
+
+Parameters:
+table: the table
+reference: its reference map */
+void check_table(SymTableDisk_T table, struct reference *reference) {
+    const void *found;
+    size_t size;
+    int i;
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        found = SymTableDisk_get(table, keys[i], &size);
+        check_value(reference, i, found, size);
+    }
+    bindings_seen = 0U;
+    if (!SymTableDisk_map(table, check_binding, reference)) {
+        fail("cannot read the log", 0U);
+    }
+    if (bindings_seen != reference->num_bindings || SymTableDisk_getLength(table) != reference->num_bindings) {
+        fail("wrong number of bindings", 0U);
+    }
+}
+
+
+/* check_binding
+
+Function of SymTableDisk_map that compares each binding with the reference
+map and counts them. */
+void check_binding(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra) {
+    unsigned int key;
+
+    key = key_index(pcKey);
+    if (key >= NUM_KEYS || strcmp(pcKey, keys[key])) {
+        fprintf(stderr, "unexpected key in map (key %s)\n", pcKey);
+        abort();
+    }
+    check_value(pvExtra, key, pvValue, uiSize);
+    bindings_seen++;
+}
+
+
+/* check_batch
+
+Function of SymTableDisk_getBatch that compares each value with the
+reference map and records that its key got it. */
+void check_batch(unsigned int uiIndex, const void *pvValue, size_t uiSize, void *pvExtra) {
+    if (uiIndex >= MAX_BATCH || batch_done[uiIndex]) {
+        fprintf(stderr, "batched lookup %u got more than one value\n", uiIndex);
+        abort();
+    }
+    check_value(pvExtra, batch_keys[uiIndex], pvValue, uiSize);
+    batch_done[uiIndex] = 1;
+}
+
+
+/* make_value
+
+Fills the first size bytes of value with the contents of the values put
+with stamp. */
+void make_value(unsigned int stamp, size_t size) {
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        value[i] = (unsigned char) (stamp * 31U + i + (i >> 8));
+    }
+}
+
+
+/* limit_files
+
+Limits the size of the files written by the process to FILE_LIMIT bytes,
+or removes the limit.
+
+Parameters:
+limit: whether files are limited */
+void limit_files(int limit) {
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_FSIZE, &rl)) {
+        return;
+    }
+    rl.rlim_cur = limit && rl.rlim_max > FILE_LIMIT ? FILE_LIMIT : rl.rlim_max;
+    setrlimit(RLIMIT_FSIZE, &rl);
+}
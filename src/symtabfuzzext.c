@@ -0,0 +1,180 @@
+/* Fuzzing and differential testing harness for the extendible hashing
+Symbol table library.
+
+Applies a sequence of operations decoded from an input to a SymTableExt
+and to a reference map of the same key space, and aborts at the first
+difference. Every key is compared at the end, and the table is traversed
+and freed, so that a memory checker finds bindings that are lost or freed
+twice. The key space is large enough for many page splits and directory
+doublings.
+
+The last NUM_COLLIDING keys of the key space have the same hash code (see
+init_keys). More than a page of them splits their page down to the maximum
+depth and fills overflow pages.
+
+The harness is linked with the driver of symtabharness.c. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "symtableext.h"
+#include "symtabharness.h"
+
+#define NUM_VALUES 4        /* number of distinct values */
+#define RANDOM_LEN 30000    /* length of a random input */
+
+/* The reference map of a test.
+present, values: whether each key is in the table and its value
+num_bindings: number of keys in the table */
+struct reference {
+    char present[NUM_KEYS];
+    void *values[NUM_KEYS];
+    unsigned int num_bindings;
+};
+
+void run_op(SymTableExt_T table, struct reference *reference, unsigned int op, unsigned int arg);
+void check_table(SymTableExt_T table, struct reference *reference);
+void check_binding(const char *pcKey, void *pvValue, void *pvExtra);
+
+/* random inputs keep the high bits of the key argument for case 7 */
+const struct target target = {RANDOM_LEN, 0U, 0xF0U, NULL, NULL, NULL, NULL, NULL};
+
+static char value_tokens[NUM_VALUES];
+
+
+/* LLVMFuzzerTestOneInput
+
+Runs one input.
+
+Parameters:
+data: the input
+size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+    static struct reference reference;
+    SymTableExt_T table;
+    size_t pos;
+
+    init_keys();
+    memset(&reference, 0, sizeof(reference));
+    table = SymTableExt_new();
+    for (pos = 0; pos + 3 <= size; pos += 3) {
+        run_op(table, &reference, data[pos], data[pos + 1] | (data[pos + 2] << 8));
+    }
+    check_table(table, &reference);
+    SymTableExt_free(table);
+    return 0;
+}
+
+
+/* run_op
+
+Applies one operation to the table and to the reference map and compares
+the results. The low 3 bits of op select the operation and the high bits
+the value. arg selects the key.
+
+Parameters:
+table: the table
+reference: its reference map
+op: operation code
+arg: selects the key */
+void run_op(SymTableExt_T table, struct reference *reference, unsigned int op, unsigned int arg) {
+    unsigned int key;
+    void *value;
+
+    key = arg % NUM_KEYS;
+    value = &value_tokens[(op >> 3) % NUM_VALUES];
+    switch (op & 7U) {
+        case 0:
+        case 1:
+        case 2:
+            SymTableExt_put(table, keys[key], value);
+            if (!reference->present[key]) {
+                reference->present[key] = 1;
+                reference->num_bindings++;
+            }
+            reference->values[key] = value;
+            break;
+        case 3:
+        case 4:
+            if (SymTableExt_remove(table, keys[key]) != reference->present[key]) {
+                fail("wrong remove result", key);
+            }
+            if (reference->present[key]) {
+                reference->present[key] = 0;
+                reference->num_bindings--;
+            }
+            break;
+        case 5:
+            if (SymTableExt_get(table, keys[key]) != (reference->present[key] ? reference->values[key] : NULL)) {
+                fail("wrong get result", key);
+            }
+            break;
+        case 6:
+            if (SymTableExt_contains(table, keys[key]) != reference->present[key]) {
+                fail("wrong contains result", key);
+            }
+            break;
+        case 7:
+            /* 1 in 16 of these checks the whole table */
+            if (!(arg & 0xF000U)) {
+                check_table(table, reference);
+            }
+            if (SymTableExt_getLength(table) != reference->num_bindings) {
+                fail("wrong length", key);
+            }
+            break;
+    }
+}
+
+
+/* check_table
+
+Compares every key of the table with the reference map and traverses it.
+
+Parameters:
+table: the table
+reference: its reference map */
+void check_table(SymTableExt_T table, struct reference *reference) {
+    struct reference seen;
+    int i;
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (SymTableExt_get(table, keys[i]) != (reference->present[i] ? reference->values[i] : NULL) ||
+                SymTableExt_contains(table, keys[i]) != reference->present[i]) {
+            fail("wrong binding", i);
+        }
+    }
+    memset(&seen, 0, sizeof(seen));
+    SymTableExt_map(table, check_binding, &seen);
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (seen.present[i] != reference->present[i] || (seen.present[i] && seen.values[i] != reference->values[i])) {
+            fail("wrong binding in map", i);
+        }
+    }
+    if (seen.num_bindings != reference->num_bindings || SymTableExt_getLength(table) != reference->num_bindings) {
+        fail("wrong number of bindings", 0U);
+    }
+}
+
+
+/* check_binding
+
+Function of SymTableExt_map that records each binding in a reference map,
+failing on keys that are not in the key space or are found twice. */
+void check_binding(const char *pcKey, void *pvValue, void *pvExtra) {
+    struct reference *seen;
+    unsigned int key;
+
+    seen = pvExtra;
+    key = key_index(pcKey);
+    if (key >= NUM_KEYS || strcmp(pcKey, keys[key]) || seen->present[key]) {
+        fprintf(stderr, "unexpected key in map (key %s)\n", pcKey);
+        abort();
+    }
+    seen->present[key] = 1;
+    seen->values[key] = pvValue;
+    seen->num_bindings++;
+}
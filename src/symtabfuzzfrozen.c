@@ -0,0 +1,272 @@
+/* Fuzzing and differential testing harness for the frozen Symbol table
+library.
+
+Applies the puts and removes decoded from an input to a SymTable and to a
+reference map, and records every put in arrays of keys and values. From
+time to time, and at the end, it builds a frozen table from the SymTable
+with SymTableFrozen_freeze and another from the arrays with
+SymTableFrozen_new, in which a repeated key must get its last value, and
+compares both with their reference maps: every key of the key space, the
+number of bindings, and the keys and values passed to SymTableFrozen_map,
+which must come in increasing strcmp order.
+
+Keys are built like namespace::class::member names, so that they share
+long prefixes. The key space includes the empty key, keys that are
+prefixes of other keys, and keys that share prefixes of more than 255
+characters.
+
+The harness is linked with the driver of symtabharness.c. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "symtablefrozen.h"
+#include "symtabharness.h"
+
+#define NUM_VALUES 4        /* number of distinct values */
+#define LONG_PREFIX 300     /* length of the long part of some keys */
+#define RANDOM_LEN 30000    /* length of a random input */
+#define MAX_PUTS (RANDOM_LEN / 3)   /* puts recorded for SymTableFrozen_new */
+
+/* The reference map of a frozen table.
+present, values: whether each key is in the table and its value
+num_bindings: number of keys in the table */
+struct reference {
+    char present[NUM_KEYS];
+    void *values[NUM_KEYS];
+    unsigned int num_bindings;
+};
+
+/* State of SymTableFrozen_map while a frozen table is compared.
+reference: the reference map
+position: position in sorted of the next key that can come
+count: number of keys seen */
+struct walk {
+    struct reference *reference;
+    unsigned int position;
+    unsigned int count;
+};
+
+void make_key(int index, char *key);
+void sort_keys(void);
+void put(struct reference *reference, unsigned int key, void *value);
+void freeze_and_check(void);
+void check_frozen(SymTableFrozen_T frozen, struct reference *reference);
+void check_binding(const char *pcKey, void *pvValue, void *pvExtra);
+int compare_keys(const void *a, const void *b);
+
+/* random inputs narrow the key range of every operation in turn */
+const struct target target = {RANDOM_LEN, 0U, 0x00U, make_key, NULL, NULL, NULL, NULL};
+
+static unsigned int sorted[NUM_KEYS];   /* the keys in increasing order */
+static int keys_sorted;
+static char value_tokens[NUM_VALUES];
+static SymTable_T table;
+static struct reference table_reference, array_reference;
+static const char *put_keys[MAX_PUTS];
+static const void *put_values[MAX_PUTS];
+static unsigned int num_puts;
+
+
+/* LLVMFuzzerTestOneInput
+
+Runs one input.
+
+Parameters:
+data: the input
+size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+    unsigned int key, op, arg;
+    size_t pos;
+    void *value;
+
+    sort_keys();
+    memset(&table_reference, 0, sizeof(table_reference));
+    memset(&array_reference, 0, sizeof(array_reference));
+    num_puts = 0U;
+    table = SymTable_new();
+    for (pos = 0; pos + 3 <= size; pos += 3) {
+        op = data[pos];
+        arg = data[pos + 1] | (data[pos + 2] << 8);
+        key = arg % NUM_KEYS;
+        value = &value_tokens[op >> 6];
+        switch (op & 3U) {
+            case 0:
+            case 1:
+                SymTable_put(table, keys[key], value);
+                put(&table_reference, key, value);
+                if (num_puts < MAX_PUTS) {
+                    put_keys[num_puts] = keys[key];
+                    put_values[num_puts] = value;
+                    num_puts++;
+                    put(&array_reference, key, value);
+                }
+                break;
+            case 2:
+                SymTable_remove(table, keys[key]);
+                if (table_reference.present[key]) {
+                    table_reference.present[key] = 0;
+                    table_reference.num_bindings--;
+                }
+                break;
+            case 3:
+                /* 1 in 64 of these freezes the tables */
+                if (!(op & 0xFCU)) {
+                    freeze_and_check();
+                }
+                break;
+        }
+    }
+    freeze_and_check();
+    SymTable_free(table);
+    return 0;
+}
+
+
+/* make_key
+
+Creates key index of the key space. Key 0 is empty. The others are
+nsN::CM::mK, where the member part is left out when K is 0, so that the key
+is a prefix of the others of its class. Classes 15 have LONG_PREFIX
+characters 'L' before the member part. */
+void make_key(int index, char *key) {
+    size_t len;
+
+    if (!index) {
+        key[0] = '\0';
+    }
+    else {
+        sprintf(key, "ns%d::C%d", index >> 9, (index >> 5) & 15);
+    }
+    len = strlen(key);
+    if (((index >> 5) & 15) == 15) {
+        memset(key + len, 'L', LONG_PREFIX);
+        len += LONG_PREFIX;
+        key[len] = '\0';
+    }
+    if (index && (index & 31)) {
+        sprintf(key + len, "::m%d", index & 31);
+    }
+}
+
+
+/* sort_keys
+
+Creates the key space and sorts it once. */
+void sort_keys(void) {
+    unsigned int i;
+
+    if (keys_sorted) {
+        return;
+    }
+    init_keys();
+    for (i = 0; i < NUM_KEYS; i++) {
+        sorted[i] = i;
+    }
+    qsort(sorted, NUM_KEYS, sizeof(unsigned int), compare_keys);
+    keys_sorted = 1;
+}
+
+
+/* compare_keys
+
+Comparison function of qsort that orders indexes by their keys. */
+int compare_keys(const void *a, const void *b) {
+    return strcmp(keys[*(const unsigned int *) a], keys[*(const unsigned int *) b]);
+}
+
+
+/* put
+
+Records a binding in a reference map.
+
+Parameters:
+reference: the reference map
+key: the key
+value: its value */
+void put(struct reference *reference, unsigned int key, void *value) {
+    if (!reference->present[key]) {
+        reference->present[key] = 1;
+        reference->num_bindings++;
+    }
+    reference->values[key] = value;
+}
+
+
+/* freeze_and_check
+
+Builds a frozen table from the SymTable and another from the recorded
+puts, and compares them with their reference maps. */
+void freeze_and_check(void) {
+    SymTableFrozen_T frozen;
+
+    frozen = SymTableFrozen_freeze(table);
+    check_frozen(frozen, &table_reference);
+    SymTableFrozen_free(frozen);
+
+    frozen = SymTableFrozen_new(put_keys, put_values, num_puts);
+    check_frozen(frozen, &array_reference);
+    SymTableFrozen_free(frozen);
+}
+
+
+/* check_frozen
+
+Compares every key of a frozen table with a reference map, and traverses
+it.
+
+Parameters:
+frozen: the frozen table
+reference: its reference map */
+void check_frozen(SymTableFrozen_T frozen, struct reference *reference) {
+    struct walk walk;
+    size_t key_bytes;
+    int i;
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (SymTableFrozen_get(frozen, keys[i]) != (reference->present[i] ? reference->values[i] : NULL) ||
+                SymTableFrozen_contains(frozen, keys[i]) != reference->present[i]) {
+            fail("wrong binding", i);
+        }
+    }
+    if (SymTableFrozen_getLength(frozen) != reference->num_bindings) {
+        fail("wrong length", 0U);
+    }
+    walk.reference = reference;
+    walk.position = 0U;
+    walk.count = 0U;
+    SymTableFrozen_map(frozen, check_binding, &walk);
+    if (walk.count != reference->num_bindings) {
+        fail("wrong number of bindings in map", 0U);
+    }
+    if (SymTableFrozen_getBytes(frozen, &key_bytes) < key_bytes) {
+        fail("key bytes larger than the table", 0U);
+    }
+}
+
+
+/* check_binding
+
+Function of SymTableFrozen_map that checks that each binding is in the
+reference map and that keys come in increasing order, by walking the
+sorted key space along with them. */
+void check_binding(const char *pcKey, void *pvValue, void *pvExtra) {
+    struct walk *walk;
+    unsigned int key;
+
+    walk = pvExtra;
+    while (walk->position < NUM_KEYS && strcmp(keys[sorted[walk->position]], pcKey) < 0) {
+        walk->position++;
+    }
+    key = walk->position < NUM_KEYS ? sorted[walk->position] : 0U;
+    if (walk->position == NUM_KEYS || strcmp(keys[key], pcKey) ||
+            !walk->reference->present[key] || walk->reference->values[key] != pvValue) {
+        fprintf(stderr, "unexpected or unordered binding in map (key %s)\n", pcKey);
+        abort();
+    }
+    walk->position++;
+    walk->count++;
+}
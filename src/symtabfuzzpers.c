@@ -0,0 +1,290 @@
+/* Fuzzing and differential testing harness for the persistent Symbol table
+library.
+
+Keeps NUM_VERSIONS versions of a table, each with its own reference map,
+and applies a sequence of operations decoded from an input to them. Every
+put and remove reads one version and stores the new version in another,
+freeing the version it replaces, so versions share their nodes in many
+different ways. Lookups are compared with the reference map of their
+version and the harness aborts at the first difference. All versions are
+compared completely at the end, and every version is freed, so that a
+memory checker finds nodes that are freed too early or never.
+
+The last NUM_COLLIDING keys of the key space have the same hash code (see
+init_keys), so that the trie also gets collision nodes. The two bytes of
+every operation that select a key also select a version.
+
+With -t the harness also runs threads that modify and free versions
+derived from a shared version at the same time, as a check of the
+reference counts of shared nodes. It is meant to be built with
+-fsanitize=thread or address, which report races on the counts and nodes
+that are freed twice.
+
+The harness is linked with the driver of symtabharness.c. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+#include "symtablepers.h"
+#include "symtabharness.h"
+
+#define NUM_VERSIONS 8      /* versions kept by a test */
+#define NUM_VALUES 4        /* number of distinct values */
+#define RANDOM_LEN 30000    /* length of a random input */
+#define THREAD_OPS 200000   /* operations of each thread with -t */
+
+/* A version and its reference map.
+present, values: whether each key is in the version and its value
+num_bindings: number of keys in the version */
+struct version {
+    SymTablePers_T table;
+    char present[NUM_KEYS];
+    const void *values[NUM_KEYS];
+    unsigned int num_bindings;
+};
+
+void run_op(struct version *versions, unsigned int op, unsigned int arg);
+void check_version(struct version *version);
+void count_binding(const char *pcKey, void *pvValue, void *pvExtra);
+int run_threads(const char *arg);
+void *thread_main(void *arg);
+
+/* random inputs keep the bits of the key argument that select the version
+that is written */
+const struct target target = {RANDOM_LEN, 0U, 0x70U, NULL, "-t", run_threads, NULL, NULL};
+
+static char value_tokens[NUM_VALUES];
+static SymTablePers_T shared_version;
+
+
+/* LLVMFuzzerTestOneInput
+
+Runs one input.
+
+Parameters:
+data: the input
+size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+    static struct version versions[NUM_VERSIONS];
+    size_t pos;
+    int i;
+
+    init_keys();
+    for (i = 0; i < NUM_VERSIONS; i++) {
+        memset(&versions[i], 0, sizeof(versions[i]));
+        versions[i].table = SymTablePers_new();
+    }
+    for (pos = 0; pos + 3 <= size; pos += 3) {
+        run_op(versions, data[pos], data[pos + 1] | (data[pos + 2] << 8));
+    }
+    for (i = 0; i < NUM_VERSIONS; i++) {
+        check_version(&versions[i]);
+        SymTablePers_free(versions[i].table);
+    }
+    return 0;
+}
+
+
+/* run_op
+
+Applies one operation to the versions and to their reference maps and
+compares the results. The low 3 bits of op select the operation, the next
+3 bits the version it reads and the last 2 bits the value. The low 12 bits
+of arg select the key and the next 3 bits the version that is written.
+
+Parameters:
+versions: the versions of the test
+op: operation code
+arg: selects the key and the version that is written */
+void run_op(struct version *versions, unsigned int op, unsigned int arg) {
+    struct version *src, *dst;
+    SymTablePers_T table;
+    const void *value;
+    unsigned int key;
+
+    key = arg % NUM_KEYS;
+    src = &versions[(op >> 3) & 7U];
+    dst = &versions[(arg >> 12) & 7U];
+    value = &value_tokens[op >> 6];
+    switch (op & 7U) {
+        case 0:
+        case 1:
+            table = SymTablePers_put(src->table, keys[key], value);
+            if (SymTablePers_get(src->table, keys[key]) != (src->present[key] ? src->values[key] : NULL)) {
+                fail("put modified its version", key);
+            }
+            SymTablePers_free(dst->table);
+            if (dst != src) {
+                memcpy(dst, src, sizeof(struct version));
+            }
+            dst->table = table;
+            if (!dst->present[key]) {
+                dst->present[key] = 1;
+                dst->num_bindings++;
+            }
+            dst->values[key] = value;
+            break;
+        case 2:
+        case 3:
+            table = SymTablePers_remove(src->table, keys[key]);
+            if (SymTablePers_contains(src->table, keys[key]) != src->present[key]) {
+                fail("remove modified its version", key);
+            }
+            SymTablePers_free(dst->table);
+            if (dst != src) {
+                memcpy(dst, src, sizeof(struct version));
+            }
+            dst->table = table;
+            if (dst->present[key]) {
+                dst->present[key] = 0;
+                dst->num_bindings--;
+            }
+            break;
+        case 4:
+            if (SymTablePers_get(src->table, keys[key]) != (src->present[key] ? src->values[key] : NULL)) {
+                fail("wrong get result", key);
+            }
+            break;
+        case 5:
+            if (SymTablePers_contains(src->table, keys[key]) != src->present[key]) {
+                fail("wrong contains result", key);
+            }
+            break;
+        case 6:
+            /* 1 in 16 of these checks the whole version */
+            if (!(arg & 0xF00U)) {
+                check_version(src);
+            }
+            if (SymTablePers_getLength(src->table) != src->num_bindings) {
+                fail("wrong length", key);
+            }
+            break;
+        case 7:
+            /* start over with an empty version */
+            SymTablePers_free(dst->table);
+            memset(dst, 0, sizeof(struct version));
+            dst->table = SymTablePers_new();
+            break;
+    }
+}
+
+
+/* check_version
+
+Compares every key of a version with its reference map and traverses it.
+
+Parameters:
+version: the version */
+void check_version(struct version *version) {
+    unsigned int count;
+    int i;
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (SymTablePers_get(version->table, keys[i]) != (version->present[i] ? version->values[i] : NULL) ||
+                SymTablePers_contains(version->table, keys[i]) != version->present[i]) {
+            fail("wrong binding", i);
+        }
+    }
+    count = 0U;
+    SymTablePers_map(version->table, count_binding, &count);
+    if (count != version->num_bindings || SymTablePers_getLength(version->table) != version->num_bindings) {
+        fail("wrong number of bindings", 0U);
+    }
+}
+
+
+/* count_binding
+
+Function of SymTablePers_map that counts the bindings. */
+void count_binding(const char *pcKey, void *pvValue, void *pvExtra) {
+    (*(unsigned int *) pvExtra)++;
+}
+
+
+/* run_threads
+
+Creates a version with all keys, then runs num_threads threads that each
+derive their own versions from it and modify them, while sharing its
+nodes. The shared version is freed while the threads run.
+
+Parameters:
+arg: number of threads, 4 if it is NULL or not a positive number
+
+Returns: 0 */
+int run_threads(const char *arg) {
+    pthread_t *threads;
+    SymTablePers_T table;
+    int num_threads;
+    long i;
+
+    num_threads = arg && atoi(arg) > 0 ? atoi(arg) : 4;
+    init_keys();
+    shared_version = SymTablePers_new();
+    for (i = 0; i < NUM_KEYS; i++) {
+        table = SymTablePers_put(shared_version, keys[i], keys[i]);
+        SymTablePers_free(shared_version);
+        shared_version = table;
+    }
+    threads = malloc(num_threads * sizeof(pthread_t));
+    assert(threads);
+
+    /* each thread derives its first version before the shared one is freed */
+    for (i = 0; i < num_threads; i++) {
+        table = SymTablePers_put(shared_version, keys[i % NUM_KEYS], keys[i % NUM_KEYS]);
+        assert(!pthread_create(&threads[i], NULL, thread_main, table));
+    }
+    SymTablePers_free(shared_version);
+    for (i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    printf("%d threads passed\n", num_threads);
+    return 0;
+}
+
+
+/* thread_main
+
+Removes and puts back random keys of its version, freeing every version it
+replaces. The value of each key is the key itself, or NULL while it is
+changed, so every lookup can be checked without a reference map.
+
+Parameters:
+arg: the first version of the thread
+
+Returns: NULL */
+void *thread_main(void *arg) {
+    SymTablePers_T table, new_table;
+    unsigned long state;
+    unsigned int key;
+    void *value;
+    long i;
+
+    table = arg;
+    state = (unsigned long) (size_t) arg | 1UL;
+    for (i = 0; i < THREAD_OPS; i++) {
+        key = next_random(&state) % NUM_KEYS;
+        if (next_random(&state) & 1) {
+            new_table = SymTablePers_remove(table, keys[key]);
+            if (SymTablePers_contains(new_table, keys[key])) {
+                fail("key not removed", key);
+            }
+        }
+        else {
+            new_table = SymTablePers_put(table, keys[key], (next_random(&state) & 1) ? keys[key] : NULL);
+        }
+        SymTablePers_free(table);
+        table = new_table;
+        key = next_random(&state) % NUM_KEYS;
+        value = SymTablePers_get(table, keys[key]);
+        if (value && value != keys[key]) {
+            fail("wrong value", key);
+        }
+    }
+    SymTablePers_free(table);
+    return NULL;
+}
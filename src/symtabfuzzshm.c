@@ -0,0 +1,549 @@
+/* Fuzzing and differential testing harness for the shared memory Symbol
+table library.
+
+Applies a sequence of operations decoded from an input to a SymTableShm
+and to a reference map of the same key space, and aborts at the first
+difference. The first byte of an input selects the size of the segment,
+from one that is full after a few hundred bindings to one that never
+fills: a put into a full segment must fail and leave the table unchanged.
+The table is also opened a second time, at another address, and the whole
+table is compared through both handles from time to time and at the end.
+Creating a segment that exists, or one too small for its buckets, and
+opening a segment that does not exist must fail. Before the random inputs
+of -r, each initialization of a lock is made to fail in turn: creating the
+table must then fail too and leave no segment behind. The harness is
+linked with --wrap=pthread_mutex_init for this.
+
+Values are made of bytes derived from their key and a stamp, so that each
+value is checked byte by byte.
+
+With -p the harness runs processes on one table at the same time. Stable
+keys are put before the processes start and must always be found with
+their value. A writer process puts and removes other keys; since it is
+driven by a fixed seed, the parent replays its operations on a reference
+map and compares the table with it when all processes are done. Reader
+processes check the stable keys and that other keys have their own value
+or none. Then writers are killed in the middle of their puts, and the
+parent must still be able to modify every partition of the table.
+
+The harness is linked with the driver of symtabharness.c. */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <pthread.h>
+#include "symtableshm.h"
+#include "symtabharness.h"
+
+#define NUM_STAMPS 16       /* number of distinct values of a key */
+#define MAX_VALUE_LEN 200   /* maximum length of a value */
+#define RANDOM_LEN 30000    /* length of a random input */
+#define NUM_STABLE 1024     /* keys that stay in the table with -p */
+#define NUM_READERS 3       /* reader processes of -p */
+#define PROCESS_OPS 200000  /* operations of the writer process of -p */
+#define NUM_KILLS 20        /* writers killed with -p */
+
+/* The reference map of a test.
+present, stamps: whether each key is in the table and the stamp of its
+value
+num_bindings: number of keys in the table */
+struct reference {
+    char present[NUM_KEYS];
+    unsigned char stamps[NUM_KEYS];
+    unsigned int num_bindings;
+};
+
+void make_name(void);
+void remove_segment(void);
+void run_op(struct reference *reference, unsigned int op, unsigned int arg);
+size_t make_value(unsigned int key, unsigned int stamp, unsigned char *value);
+int check_value(unsigned int key, unsigned int stamp, const void *value, size_t size);
+void check_table(SymTableShm_T table, struct reference *reference);
+void check_binding(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra);
+int run_processes(const char *arg);
+void writer_op(SymTableShm_T table, struct reference *reference, unsigned long *state);
+void reader_main(int index);
+void wait_children(void);
+void check_lock_failures(void);
+int __real_pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+int __wrap_pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+
+/* random inputs keep the high bits of the key argument for case 7 */
+const struct target target = {RANDOM_LEN, 1U, 0xF0U, NULL, "-p", run_processes, check_lock_failures,
+    remove_segment};
+
+/* sizes of the segment, selected by the first byte of an input */
+static const size_t SEGMENT_SIZES[] = {300000U, 512000U, 2000000U, 64000000U};
+
+static char name[64];
+static SymTableShm_T table, other;
+static size_t segment_size, last_bytes;
+static unsigned long lock_inits, fail_at;   /* see __wrap_pthread_mutex_init */
+
+
+/* LLVMFuzzerTestOneInput
+
+Runs one input.
+
+Parameters:
+data: the input
+size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size) {
+    static struct reference reference;
+    size_t pos;
+
+    init_keys();
+    make_name();
+    memset(&reference, 0, sizeof(reference));
+    if (size < 1) {
+        return 0;
+    }
+    SymTableShm_unlink(name);
+    if (SymTableShm_open(name) || SymTableShm_create(name, 4096U, NUM_KEYS) || SymTableShm_open(name)) {
+        fail("open of a missing or create of a small segment did not fail", 0U);
+    }
+    segment_size = SEGMENT_SIZES[data[0] % 4];
+    table = SymTableShm_create(name, segment_size, NUM_KEYS);
+    if (!table) {
+        fprintf(stderr, "cannot create segment %s\n", name);
+        abort();
+    }
+    other = SymTableShm_open(name);
+    if (!other || SymTableShm_create(name, segment_size, NUM_KEYS)) {
+        fail("second open failed or second create did not fail", 0U);
+    }
+    last_bytes = SymTableShm_getBytes(table, NULL);
+    for (pos = 1; pos + 3 <= size; pos += 3) {
+        run_op(&reference, data[pos], data[pos + 1] | (data[pos + 2] << 8));
+    }
+    check_table(table, &reference);
+    check_table(other, &reference);
+    SymTableShm_close(other);
+    if (!SymTableShm_unlink(name)) {
+        fail("unlink failed", 0U);
+    }
+    SymTableShm_close(table);
+    return 0;
+}
+
+
+/* make_name
+
+Sets the name of the segment, unique to the process so that several
+harnesses can run at the same time. */
+void make_name(void) {
+    sprintf(name, "/symtabfuzzshm.%ld", (long) getpid());
+}
+
+
+/* remove_segment
+
+Removes the segment, so that a failure leaves none behind. */
+void remove_segment(void) {
+    SymTableShm_unlink(name);
+}
+
+
+/* run_op
+
+Applies one operation to the table and to the reference map and compares
+the results. The low 3 bits of op select the operation, the next bit the
+handle and the high bits the stamp. arg selects the key.
+
+Parameters:
+reference: the reference map
+op: operation code
+arg: selects the key */
+void run_op(struct reference *reference, unsigned int op, unsigned int arg) {
+    unsigned char value[MAX_VALUE_LEN];
+    unsigned int key, stamp;
+    SymTableShm_T handle;
+    const void *found;
+    size_t len, bytes, garbage;
+
+    key = arg % NUM_KEYS;
+    stamp = (op >> 4) % NUM_STAMPS;
+    handle = (op & 8U) ? other : table;
+    switch (op & 7U) {
+        case 0:
+        case 1:
+        case 2:
+            len = make_value(key, stamp, value);
+            if (SymTableShm_put(handle, keys[key], value, len)) {
+                if (!reference->present[key]) {
+                    reference->present[key] = 1;
+                    reference->num_bindings++;
+                }
+                reference->stamps[key] = stamp;
+            }
+            else if (SymTableShm_getBytes(table, NULL) != last_bytes) {
+                fail("failed put changed the table", key);
+            }
+            break;
+        case 3:
+        case 4:
+            if (SymTableShm_remove(handle, keys[key]) != reference->present[key]) {
+                fail("wrong remove result", key);
+            }
+            if (reference->present[key]) {
+                reference->present[key] = 0;
+                reference->num_bindings--;
+            }
+            break;
+        case 5:
+            found = SymTableShm_get(handle, keys[key], &len);
+            if (reference->present[key] ? !check_value(key, reference->stamps[key], found, len) : found != NULL) {
+                fail("wrong get result", key);
+            }
+            break;
+        case 6:
+            if (SymTableShm_contains(handle, keys[key]) != reference->present[key]) {
+                fail("wrong contains result", key);
+            }
+            break;
+        case 7:
+            /* 1 in 16 of these checks the whole table */
+            if (!(arg & 0xF000U)) {
+                check_table(handle, reference);
+            }
+            if (SymTableShm_getLength(handle) != reference->num_bindings) {
+                fail("wrong length", key);
+            }
+            break;
+    }
+
+    /* space is never reused, so the used bytes only grow */
+    bytes = SymTableShm_getBytes(handle, &garbage);
+    if (bytes < last_bytes || garbage > bytes || bytes > segment_size) {
+        fail("wrong byte counts", key);
+    }
+    last_bytes = bytes;
+}
+
+
+/* make_value
+
+Fills value with the bytes of key with stamp.
+
+Returns: the length of the value, at most MAX_VALUE_LEN, 0 for some keys */
+size_t make_value(unsigned int key, unsigned int stamp, unsigned char *value) {
+    size_t len, i;
+
+    len = (key * 7U + stamp * 13U) % MAX_VALUE_LEN;
+    for (i = 0; i < len; i++) {
+        value[i] = (unsigned char) (key + stamp * 31U + i);
+    }
+    return len;
+}
+
+
+/* check_value
+
+Returns: 1 if value and size are the value of key with stamp, 0 otherwise */
+int check_value(unsigned int key, unsigned int stamp, const void *value, size_t size) {
+    unsigned char expected[MAX_VALUE_LEN];
+    size_t len;
+
+    len = make_value(key, stamp, expected);
+    return value && size == len && !memcmp(value, expected, len) && !((size_t) value & 7U);
+}
+
+
+/* check_table
+
+Compares every key of the table with the reference map and traverses it.
+
+Parameters:
+handle: a handle of the table
+reference: its reference map */
+void check_table(SymTableShm_T handle, struct reference *reference) {
+    struct reference seen;
+    const void *found;
+    size_t len;
+    int i;
+
+    for (i = 0; i < NUM_KEYS; i++) {
+        found = SymTableShm_get(handle, keys[i], &len);
+        if ((reference->present[i] ? !check_value(i, reference->stamps[i], found, len) : found != NULL) ||
+                SymTableShm_contains(handle, keys[i]) != reference->present[i]) {
+            fail("wrong binding", i);
+        }
+    }
+    memset(&seen, 0, sizeof(seen));
+    SymTableShm_map(handle, check_binding, &seen);
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (seen.present[i] != reference->present[i] || (seen.present[i] && seen.stamps[i] != reference->stamps[i])) {
+            fail("wrong binding in map", i);
+        }
+    }
+    if (seen.num_bindings != reference->num_bindings || SymTableShm_getLength(handle) != reference->num_bindings) {
+        fail("wrong number of bindings", 0U);
+    }
+}
+
+
+/* check_binding
+
+Function of SymTableShm_map that records each binding in a reference map,
+failing on keys that are not in the key space or are found twice, and on
+values that have no stamp. */
+void check_binding(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra) {
+    struct reference *seen;
+    unsigned int key, stamp;
+
+    seen = pvExtra;
+    key = key_index(pcKey);
+    if (key >= NUM_KEYS || strcmp(pcKey, keys[key]) || seen->present[key]) {
+        fprintf(stderr, "unexpected key in map (key %s)\n", pcKey);
+        abort();
+    }
+    for (stamp = 0U; stamp < NUM_STAMPS && !check_value(key, stamp, pvValue, uiSize); stamp++) {
+    }
+    seen->present[key] = 1;
+    seen->stamps[key] = (unsigned char) stamp;
+    seen->num_bindings++;
+}
+
+
+/* run_processes
+
+Puts the stable keys, then runs a writer process and NUM_READERS reader
+processes on the same table, and compares the table with the operations of
+the writer when they are done. Then kills NUM_KILLS writers while they put
+keys, and checks that every partition can still be modified.
+
+Parameters:
+arg: not used
+
+Returns: 0 */
+int run_processes(const char *arg) {
+    static struct reference reference;
+    unsigned char value[MAX_VALUE_LEN];
+    struct timespec delay;
+    unsigned long state;
+    pid_t pid;
+    long i;
+    int r;
+
+    init_keys();
+    make_name();
+    SymTableShm_unlink(name);
+    table = SymTableShm_create(name, SEGMENT_SIZES[3], NUM_KEYS);
+    if (!table) {
+        fprintf(stderr, "cannot create segment %s\n", name);
+        return 1;
+    }
+    memset(&reference, 0, sizeof(reference));
+    for (i = 0; i < NUM_STABLE; i++) {
+        assert(SymTableShm_put(table, keys[i], value, make_value(i, 0U, value)));
+        reference.present[i] = 1;
+        reference.num_bindings++;
+    }
+    fflush(stdout);
+    for (r = 0; r <= NUM_READERS; r++) {
+        pid = fork();
+        assert(pid >= 0);
+        if (!pid) {
+            other = SymTableShm_open(name);
+            if (!other) {
+                _exit(2);
+            }
+            if (r) {
+                reader_main(r);
+            }
+            else {
+                state = 1UL;
+                for (i = 0; i < PROCESS_OPS; i++) {
+                    writer_op(other, NULL, &state);
+                }
+            }
+            SymTableShm_close(other);
+            _exit(0);
+        }
+    }
+    wait_children();
+
+    /* the writer is replayed on the reference map */
+    state = 1UL;
+    for (i = 0; i < PROCESS_OPS; i++) {
+        writer_op(NULL, &reference, &state);
+    }
+    check_table(table, &reference);
+
+    /* a writer that dies holding a lock must not block the others */
+    for (r = 0; r < NUM_KILLS; r++) {
+        pid = fork();
+        assert(pid >= 0);
+        if (!pid) {
+            other = SymTableShm_open(name);
+            for (state = 1UL + r;;) {
+                writer_op(other, NULL, &state);
+            }
+        }
+        delay.tv_sec = 0;
+        delay.tv_nsec = 2000000L + r * 300000L;
+        nanosleep(&delay, NULL);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    alarm(60);
+    for (i = NUM_STABLE; i < NUM_KEYS; i++) {
+        if (!SymTableShm_put(table, keys[i], keys[i], strlen(keys[i]) + 1) ||
+                strcmp(SymTableShm_get(table, keys[i], NULL), keys[i])) {
+            fail("table not usable after killed writers", i);
+        }
+    }
+    alarm(0);
+
+    SymTableShm_unlink(name);
+    SymTableShm_close(table);
+    printf("%d processes passed, %d writers killed\n", NUM_READERS + 1, NUM_KILLS);
+    return 0;
+}
+
+
+/* writer_op
+
+Puts or removes a random key that is not stable.
+
+Parameters:
+handle: a handle of the table, or NULL to only update reference
+reference: the reference map, or NULL to only update the table
+state: state of the random generator */
+void writer_op(SymTableShm_T handle, struct reference *reference, unsigned long *state) {
+    unsigned char value[MAX_VALUE_LEN];
+    unsigned long random;
+    unsigned int key, stamp;
+    size_t len;
+
+    random = next_random(state);
+    key = NUM_STABLE + (random >> 8) % (NUM_KEYS - NUM_STABLE);
+    stamp = (random >> 4) % NUM_STAMPS;
+    if (random & 1UL) {
+        if (handle) {
+            SymTableShm_remove(handle, keys[key]);
+        }
+        if (reference && reference->present[key]) {
+            reference->present[key] = 0;
+            reference->num_bindings--;
+        }
+    }
+    else {
+        len = make_value(key, stamp, value);
+        if (handle && !SymTableShm_put(handle, keys[key], value, len)) {
+            fail("segment full", key);
+        }
+        if (reference) {
+            if (!reference->present[key]) {
+                reference->present[key] = 1;
+                reference->num_bindings++;
+            }
+            reference->stamps[key] = stamp;
+        }
+    }
+}
+
+
+/* reader_main
+
+Looks up random keys while the writer runs. Stable keys must always be
+found with their value, other keys must have one of their own values, or
+none.
+
+Parameters:
+index: number of the reader */
+void reader_main(int index) {
+    unsigned long state, l;
+    unsigned int key, stamp;
+    const void *found;
+    size_t len;
+
+    state = 2UL * index + 1UL;
+    for (l = 0UL; l < 4UL * PROCESS_OPS; l++) {
+        key = next_random(&state) % NUM_KEYS;
+        found = SymTableShm_get(other, keys[key], &len);
+        if (key < NUM_STABLE) {
+            if (!check_value(key, 0U, found, len) || !SymTableShm_contains(other, keys[key])) {
+                fail("wrong binding of reader", key);
+            }
+            continue;
+        }
+        for (stamp = 0U; found && stamp < NUM_STAMPS && !check_value(key, stamp, found, len); stamp++) {
+        }
+        if (stamp == NUM_STAMPS) {
+            fail("wrong binding of reader", key);
+        }
+    }
+}
+
+
+/* wait_children
+
+Waits for every child process, and fails if any of them failed. */
+void wait_children(void) {
+    int status;
+
+    while (wait(&status) > 0) {
+        if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+            fail("child process failed", 0U);
+        }
+    }
+}
+
+
+/* check_lock_failures
+
+Makes each initialization of a lock of SymTableShm_create fail in turn,
+until the call needs no more initializations than the ones that were
+allowed to succeed, and checks that the failure is reported and that no
+segment is left, then prints the number of failures checked. A failure of
+a check aborts. */
+void check_lock_failures(void) {
+    SymTableShm_T oSymTable;
+    unsigned long n, before;
+
+    init_keys();
+    make_name();
+    SymTableShm_unlink(name);
+    for (n = 1UL;; n++) {
+        before = lock_inits;
+        fail_at = before + n;
+        oSymTable = SymTableShm_create(name, SEGMENT_SIZES[0], NUM_KEYS);
+        fail_at = 0UL;
+        if (oSymTable) {
+            if (lock_inits - before >= n) {
+                fail("create ignored a failed lock", 0U);
+            }
+            break;
+        }
+        if (SymTableShm_open(name) || SymTableShm_unlink(name)) {
+            fail("failed create left a segment", 0U);
+        }
+    }
+    SymTableShm_unlink(name);
+    SymTableShm_close(oSymTable);
+    printf("%lu lock failures passed\n", n - 1);
+}
+
+
+/* __wrap_pthread_mutex_init
+
+Counts the initialization and calls pthread_mutex_init, or returns EAGAIN
+if it is initialization number fail_at. */
+int __wrap_pthread_mutex_init(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
+    if (++lock_inits == fail_at) {
+        return EAGAIN;
+    }
+    return __real_pthread_mutex_init(mutex, attr);
+}
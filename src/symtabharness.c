@@ -0,0 +1,187 @@
+/* Driver shared by the fuzzing and differential testing harnesses of the
+Symbol table libraries, see symtabharness.h. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "symtabharness.h"
+
+int run_file(FILE *file);
+
+/* two blocks with the same hash code for the multiplier 65599 */
+static const char *const BLOCKS[2] = {"ziwxnswy", "retpbvpd"};
+
+char *keys[NUM_KEYS];
+
+
+/* init_keys
+
+Creates the key space once, see symtabharness.h. */
+void init_keys(void) {
+    char key[MAX_KEY_LEN + 1];
+    size_t len;
+    int i, j;
+
+    if (keys[0]) {
+        return;
+    }
+    for (i = 0; i < NUM_KEYS; i++) {
+        if (target.make_key) {
+            target.make_key(i, key);
+        }
+        else if (i < NUM_KEYS - NUM_COLLIDING) {
+            sprintf(key, "%x", i);
+            len = strlen(key);
+            memset(key + len, 'x', i % 23);
+            key[len + i % 23] = '\0';
+        }
+        else {
+            key[0] = 'z';
+            for (j = 0; j < COLLIDING_BLOCKS; j++) {
+                memcpy(key + 1 + j * BLOCK_LEN, BLOCKS[(i >> j) & 1], BLOCK_LEN);
+            }
+            key[1 + COLLIDING_BLOCKS * BLOCK_LEN] = '\0';
+        }
+        keys[i] = malloc(strlen(key) + 1);
+        assert(keys[i]);
+        strcpy(keys[i], key);
+    }
+}
+
+
+/* key_index
+
+Returns the index of a key of the default key space, or NUM_KEYS if it is
+not of the form of init_keys. */
+unsigned int key_index(const char *key) {
+    char *end;
+    unsigned long index;
+    int j;
+
+    if (key[0] == 'z') {
+        if (strlen(key) != 1 + COLLIDING_BLOCKS * BLOCK_LEN) {
+            return NUM_KEYS;
+        }
+        index = NUM_KEYS - NUM_COLLIDING;
+        for (j = 0; j < COLLIDING_BLOCKS; j++) {
+            index |= (unsigned long) !strncmp(key + 1 + j * BLOCK_LEN, BLOCKS[1], BLOCK_LEN) << j;
+        }
+        return (unsigned int) index;
+    }
+    index = strtoul(key, &end, 16);
+    if (end == key || index >= NUM_KEYS - NUM_COLLIDING) {
+        return NUM_KEYS;
+    }
+    return (unsigned int) index;
+}
+
+
+/* fail
+
+Prints message, cleans up and aborts, so that fuzzers record the input.
+
+Parameters:
+message: what went wrong
+key: the key involved */
+void fail(const char *message, unsigned int key) {
+    fprintf(stderr, "%s (key %s)\n", message, keys[key]);
+    if (target.cleanup) {
+        target.cleanup();
+    }
+    abort();
+}
+
+
+#ifndef SYMTAB_LIBFUZZER
+/*  main
+
+Parameters:
+argc: number of command line arguments.
+argv: command line arguments.
+    no arguments: run standard input
+    FILE...: run each file
+    -r [ITERATIONS [SEED]]: run random inputs, 100 with seed 1 by default
+    target.option [ARG]: run the option of the harness
+
+Returns: 0 if all inputs pass. A failure aborts. */
+int main(int argc, char **argv) {
+    unsigned char *data;
+    unsigned long iterations, state, ul;
+    FILE *file;
+    size_t i;
+    int arg;
+
+    if (argc == 1) {
+        return run_file(stdin);
+    }
+    if (target.option && !strcmp(argv[1], target.option)) {
+        return target.run_option(argc > 2 ? argv[2] : NULL);
+    }
+    if (!strcmp(argv[1], "-r")) {
+        iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : 100UL;
+        state = argc > 3 ? strtoul(argv[3], NULL, 10) : 1UL;
+        if (argc > 4 || !state) {
+            printf("Usage: %s -r [ITERATIONS [SEED]]\n", argv[0]);
+            return 1;
+        }
+        if (target.prepare) {
+            target.prepare();
+        }
+        data = malloc(target.random_len);
+        assert(data);
+        for (ul = 0UL; ul < iterations; ul++) {
+            /* vary the length and the key range so that some inputs keep
+            few keys, which also makes the removes find them. Only the full
+            range reaches the colliding keys. */
+            for (i = 0; i < target.random_len; i++) {
+                data[i] = (unsigned char) next_random(&state);
+            }
+            for (i = target.header_len + 2; i < target.random_len; i += 3) {
+                data[i] &= (unsigned char) (target.random_keep | ((1U << ul % 5) - 1));
+            }
+            LLVMFuzzerTestOneInput(data, target.random_len / (1 + ul % 4));
+        }
+        free(data);
+        printf("%lu random inputs passed\n", iterations);
+        return 0;
+    }
+    for (arg = 1; arg < argc; arg++) {
+        file = fopen(argv[arg], "rb");
+        if (!file) {
+            printf("Cannot open %s\n", argv[arg]);
+            return 1;
+        }
+        run_file(file);
+        fclose(file);
+    }
+    return 0;
+}
+
+
+/* run_file
+
+Runs the contents of file as one input.
+
+Parameters:
+file: the input
+
+Returns: 0 */
+int run_file(FILE *file) {
+    unsigned char *data;
+    size_t size, max;
+
+    size = 0U;
+    max = 4096U;
+    data = malloc(max);
+    assert(data);
+    while ((size += fread(data + size, 1, max - size, file)) == max) {
+        max *= 2;
+        data = realloc(data, max);
+        assert(data);
+    }
+    LLVMFuzzerTestOneInput(data, size);
+    free(data);
+    return 0;
+}
+#endif
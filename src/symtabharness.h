@@ -0,0 +1,90 @@
+/* Driver shared by the fuzzing and differential testing harnesses of the
+Symbol table libraries.
+
+A harness defines LLVMFuzzerTestOneInput, which runs one input on the table
+it tests, and target, which describes its inputs and options to the
+driver. The driver provides the key space, the reporting of failures and,
+unless built with -DSYMTAB_LIBFUZZER, main, which runs the inputs given as
+files, or standard input for AFL, or random inputs with -r.
+
+Every operation of an input takes 3 bytes: an operation code and two bytes
+that select a key, the key being the second and third bytes modulo
+NUM_KEYS. */
+
+#ifndef SYMTABHARNESS_INCLUDE
+#define SYMTABHARNESS_INCLUDE
+
+#include <stddef.h>
+#include "symtabutil.h"
+
+#define NUM_KEYS 4096       /* size of the key space */
+#define MAX_KEY_LEN 400     /* maximum length of a key */
+#define COLLIDING_BLOCKS 7  /* blocks of a colliding key */
+#define NUM_COLLIDING (1 << COLLIDING_BLOCKS)   /* keys with the same hash code */
+#define BLOCK_LEN 8         /* length of a block */
+
+/* Description of a harness.
+random_len: length of a random input
+header_len: bytes of an input before its first operation
+random_keep: bits of the third byte of every operation that random inputs
+keep. The other bits are cleared in turn, so that some random inputs only
+use a few keys.
+make_key: creates key number index in key, at most MAX_KEY_LEN characters.
+NULL for the default key space, see init_keys.
+option, run_option: an option of main other than -r, such as "-t", and the
+function that runs it with the argument that follows it, or NULL. Both are
+NULL if the harness has no such option.
+prepare: called before the random inputs of -r, or NULL
+cleanup: called by fail before it aborts, or NULL */
+struct target {
+    size_t random_len;
+    size_t header_len;
+    unsigned char random_keep;
+    void (*make_key)(int index, char *key);
+    const char *option;
+    int (*run_option)(const char *arg);
+    void (*prepare)(void);
+    void (*cleanup)(void);
+};
+
+extern const struct target target;
+extern char *keys[NUM_KEYS];
+
+
+/* Runs one input. Defined by each harness.
+
+Parameters:
+* data: the input
+* size: length of the input
+
+Returns: 0 */
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+
+
+/* Creates the key space once, with target.make_key if it is not NULL. By
+default key i is i in hexadecimal followed by i % 23 characters 'x', so
+that keys of many lengths are used, except for the last NUM_COLLIDING
+keys. These have the same hash code for the multiplier 65599 of the
+libraries: each is 'z' followed by COLLIDING_BLOCKS blocks, every one of
+which is either of two strings of the same length and hash code, chosen by
+the bits of the index. */
+void init_keys(void);
+
+
+/* Returns the index of a key of the default key space, or NUM_KEYS if it is
+not of the form of init_keys.
+
+Parameters:
+* key: a null terminated key */
+unsigned int key_index(const char *key);
+
+
+/* Prints message and the key involved, calls target.cleanup and aborts, so
+that fuzzers record the input.
+
+Parameters:
+* message: what went wrong
+* key: index of the key involved */
+void fail(const char *message, unsigned int key);
+
+#endif
@@ -0,0 +1,361 @@
+/* Hash quality analysis for the Symbol table library.
+
+Reads a corpus of keys, one per line, and reports for SymTable_hashKey and
+for alternative hash functions:
+
+1) Collisions of the full hash codes.
+2) Avalanche: how many bits of the hash code change when one bit of a key
+changes. A good hash changes each bit with probability 0.5.
+3) For every bucket size a table can have: chi-squared uniformity of the
+buckets, colliding keys and chain lengths, observed and expected for a
+uniformly random hash. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+#include "symtable.h"
+
+#define MAX_KEY_LEN 1024        /* maximum length of a key in the corpus */
+#define AVALANCHE_KEYS 10000    /* keys used for the avalanche test */
+#define HASH_BITS 32
+
+unsigned int fnv1a_hash(const char *pcKey);
+unsigned int murmur_hash(const char *pcKey);
+char** read_keys(FILE *file, int *num_keys);
+void full_collisions(unsigned int (*hash)(const char *), char **keys, int num_keys);
+void avalanche(unsigned int (*hash)(const char *), char **keys, int num_keys);
+void bucket_stats(unsigned int (*hash)(const char *), char **keys, int num_keys, unsigned int buckets);
+int compare_keys(const void *a, const void *b);
+int compare_uint(const void *a, const void *b);
+
+
+/* Hash functions to analyze. */
+static const struct {
+    const char *name;
+    unsigned int (*hash)(const char *);
+} HASHES[] = {
+    {"SymTable_hashKey", SymTable_hashKey},
+    {"FNV-1a", fnv1a_hash},
+    {"65599 + murmur3 finalizer", murmur_hash}
+};
+
+
+/*  main
+
+Parameters:
+argc: number of command line arguments. Can be 1 (keys are read from stdin)
+or 2.
+argv: command line arguments.
+    1st argument: executable file name
+    2nd argument: file with one key per line */
+int main(int argc, char **argv) {
+    const unsigned int *sizes;
+    unsigned int num_sizes, ui;
+    char **keys;
+    FILE *file;
+    int i, h, num_keys;
+
+    if (argc > 2) {
+        printf("Usage: %s [KEYS_FILE]\n", argv[0]);
+        return 1;
+    }
+    file = stdin;
+    if (argc == 2) {
+        file = fopen(argv[1], "r");
+        if (!file) {
+            printf("Cannot open %s\n", argv[1]);
+            return 1;
+        }
+    }
+    keys = read_keys(file, &num_keys);
+    if (file != stdin) {
+        fclose(file);
+    }
+    printf("%d distinct keys\n", num_keys);
+    if (!num_keys) {
+        free(keys);
+        return 0;
+    }
+
+    num_sizes = SymTable_bucketSizes(&sizes);
+    for (h = 0; h < (int) (sizeof(HASHES) / sizeof(HASHES[0])); h++) {
+        printf("\n==> %s\n", HASHES[h].name);
+        full_collisions(HASHES[h].hash, keys, num_keys);
+        avalanche(HASHES[h].hash, keys, num_keys);
+        printf("%8s %10s %10s %12s %12s %10s %10s %8s %8s\n", "buckets", "load", "chi2/df",
+            "collisions", "expected", "avg chain", "expected", "max", "expected");
+        for (ui = 0U; ui < num_sizes; ui++) {
+            bucket_stats(HASHES[h].hash, keys, num_keys, sizes[ui]);
+        }
+    }
+
+    for (i = 0; i < num_keys; i++) {
+        free(keys[i]);
+    }
+    free(keys);
+    return 0;
+}
+
+
+/* fnv1a_hash
+
+32-bit FNV-1a hash of pcKey. */
+unsigned int fnv1a_hash(const char *pcKey) {
+    unsigned long hash;
+
+    hash = 2166136261UL;
+    for (; *pcKey; pcKey++) {
+        hash ^= (unsigned char) *pcKey;
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return (unsigned int) hash;
+}
+
+
+/* murmur_hash
+
+SymTable_hashKey followed by the 32-bit finalizer of MurmurHash3, which
+mixes every input bit into every output bit. */
+unsigned int murmur_hash(const char *pcKey) {
+    unsigned long hash;
+
+    hash = SymTable_hashKey(pcKey) & 0xFFFFFFFFUL;
+    hash ^= hash >> 16;
+    hash = (hash * 0x85EBCA6BUL) & 0xFFFFFFFFUL;
+    hash ^= hash >> 13;
+    hash = (hash * 0xC2B2AE35UL) & 0xFFFFFFFFUL;
+    hash ^= hash >> 16;
+    return (unsigned int) hash;
+}
+
+
+/* read_keys
+
+Reads one key per line from file. Empty lines and repeated keys are
+ignored.
+
+Parameters:
+file: the corpus
+num_keys: set to the number of keys
+
+Returns: a sorted array of distinct null terminated keys */
+char** read_keys(FILE *file, int *num_keys) {
+    char line[MAX_KEY_LEN + 2], **keys;
+    int count, max, i, j;
+    size_t len;
+
+    count = 0;
+    max = 1024;
+    keys = malloc(max * sizeof(char *));
+    assert(keys);
+    while (fgets(line, sizeof(line), file)) {
+        len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (!len) {
+            continue;
+        }
+        if (count == max) {
+            max *= 2;
+            keys = realloc(keys, max * sizeof(char *));
+            assert(keys);
+        }
+        keys[count] = malloc(len + 1);
+        assert(keys[count]);
+        strcpy(keys[count], line);
+        count++;
+    }
+
+    qsort(keys, count, sizeof(char *), compare_keys);
+    for (i = 0, j = 0; i < count; i++) {
+        if (j && !strcmp(keys[j - 1], keys[i])) {
+            free(keys[i]);
+        }
+        else {
+            keys[j++] = keys[i];
+        }
+    }
+    *num_keys = j;
+    return keys;
+}
+
+
+/* full_collisions
+
+Prints the number of keys whose full hash code is the same as the one of
+another key, and the number expected from a uniformly random 32-bit hash.
+
+Parameters:
+hash: the hash function
+keys: array of distinct keys
+num_keys: number of keys
+
+Returns: void */
+void full_collisions(unsigned int (*hash)(const char *), char **keys, int num_keys) {
+    unsigned int *codes;
+    double expected;
+    int i, collisions;
+
+    codes = malloc(num_keys * sizeof(unsigned int));
+    assert(codes);
+    for (i = 0; i < num_keys; i++) {
+        codes[i] = hash(keys[i]) & 0xFFFFFFFFU;
+    }
+    qsort(codes, num_keys, sizeof(unsigned int), compare_uint);
+    collisions = 0;
+    for (i = 1; i < num_keys; i++) {
+        if (codes[i] == codes[i - 1]) {
+            collisions++;
+        }
+    }
+
+    /* birthday approximation for 2^32 codes */
+    expected = (double) num_keys * (num_keys - 1) / (2 * 4294967296.0);
+    printf("full hash collisions: %d (expected %.2f)\n", collisions, expected);
+    free(codes);
+}
+
+
+/* avalanche
+
+Flips every bit of every character of up to AVALANCHE_KEYS keys and
+prints the average fraction of hash bits that change, and the least and
+most often changed hash bit. Flips that would produce a '\0' are skipped.
+
+Parameters:
+hash: the hash function
+keys: array of keys
+num_keys: number of keys
+
+Returns: void */
+void avalanche(unsigned int (*hash)(const char *), char **keys, int num_keys) {
+    unsigned long flips[HASH_BITS], total, trials;
+    unsigned int code, diff;
+    double prob, min_prob, max_prob;
+    int i, j, bit, out, step;
+    char *key, saved;
+
+    for (out = 0; out < HASH_BITS; out++) {
+        flips[out] = 0UL;
+    }
+    trials = 0UL;
+    total = 0UL;
+    step = num_keys > AVALANCHE_KEYS ? num_keys / AVALANCHE_KEYS : 1;
+    for (i = 0; i < num_keys; i += step) {
+        key = keys[i];
+        code = hash(key);
+        for (j = 0; key[j]; j++) {
+            saved = key[j];
+            for (bit = 0; bit < 8; bit++) {
+                key[j] = (char) (saved ^ (1 << bit));
+                if (!key[j]) {
+                    continue;
+                }
+                diff = (hash(key) ^ code) & 0xFFFFFFFFU;
+                trials++;
+                for (out = 0; out < HASH_BITS; out++) {
+                    if ((diff >> out) & 1U) {
+                        flips[out]++;
+                        total++;
+                    }
+                }
+            }
+            key[j] = saved;
+        }
+    }
+    if (!trials) {
+        return;
+    }
+    min_prob = 1.0;
+    max_prob = 0.0;
+    for (out = 0; out < HASH_BITS; out++) {
+        prob = (double) flips[out] / trials;
+        if (prob < min_prob) {
+            min_prob = prob;
+        }
+        if (prob > max_prob) {
+            max_prob = prob;
+        }
+    }
+    printf("avalanche: %.3f of output bits change per input bit flip (ideal 0.500), "
+        "per-bit probability in [%.3f, %.3f]\n", (double) total / (trials * HASH_BITS), min_prob, max_prob);
+}
+
+
+/* bucket_stats
+
+Prints, for a table with the given number of buckets:
+1) load factor
+2) chi-squared statistic of the bucket counts divided by its degrees of
+freedom. About 1 for a uniform hash, much larger if keys cluster.
+3) keys that share their bucket with a previous key, observed and expected
+4) average chain length seen by a successful search, observed and expected
+5) longest chain, observed and expected (approximately)
+
+Parameters:
+hash: the hash function
+keys: array of keys
+num_keys: number of keys
+buckets: number of buckets
+
+Returns: void */
+void bucket_stats(unsigned int (*hash)(const char *), char **keys, int num_keys, unsigned int buckets) {
+    unsigned int *counts, ui, max_chain;
+    double load, chi2, chain, exp_collisions, exp_chain, exp_max;
+    int i, collisions;
+
+    counts = calloc(buckets, sizeof(unsigned int));
+    assert(counts);
+    for (i = 0; i < num_keys; i++) {
+        counts[hash(keys[i]) % buckets]++;
+    }
+
+    load = (double) num_keys / buckets;
+    chi2 = 0.0;
+    chain = 0.0;
+    collisions = num_keys;
+    max_chain = 0U;
+    for (ui = 0U; ui < buckets; ui++) {
+        chi2 += (counts[ui] - load) * (counts[ui] - load) / load;
+        chain += counts[ui] * (counts[ui] + 1.0) / 2;
+        if (counts[ui]) {
+            collisions--;
+        }
+        if (counts[ui] > max_chain) {
+            max_chain = counts[ui];
+        }
+    }
+    chain /= num_keys;
+
+    /* uniformly random hash: a bucket is empty with probability (1-1/m)^n,
+    the i-th key of a chain is reached after i comparisons and the longest
+    chain is about ln(m) / ln(ln(m) / load) for small loads */
+    exp_collisions = num_keys - buckets * (1 - exp(num_keys * log(1 - 1.0 / buckets)));
+    exp_chain = 1 + (num_keys - 1) / (2.0 * buckets);
+    exp_max = load + log((double) buckets) / log(1 + log((double) buckets) / load);
+
+    printf("%8u %10.3f %10.3f %12d %12.1f %10.3f %10.3f %8u %8.1f\n", buckets, load,
+        chi2 / (buckets - 1), collisions, exp_collisions, chain, exp_chain, max_chain, exp_max);
+    free(counts);
+}
+
+
+/* compare_keys
+
+Comparison function of qsort for keys. */
+int compare_keys(const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+
+/* compare_uint
+
+Comparison function of qsort for unsigned ints. */
+int compare_uint(const void *a, const void *b) {
+    unsigned int x, y;
+
+    x = *(const unsigned int *) a;
+    y = *(const unsigned int *) b;
+    return (x > y) - (x < y);
+}
@@ -8,13 +8,51 @@
 typedef void* SymTable_T;
 
 
+/* Memory allocated by a table, in bytes, see SymTable_getMemory.
+uiTable: the table struct
+uiBuckets: the bucket array
+uiBindings: the bindings, without their keys
+uiKeys: the keys owned by the table
+uiSampling: the access counters, see SymTable_setSampling
+uiCache: the lookup cache, see SymTable_setCache */
+struct SymTable_memory {
+    size_t uiTable;
+    size_t uiBuckets;
+    size_t uiBindings;
+    size_t uiKeys;
+    size_t uiSampling;
+    size_t uiCache;
+};
+
+
 /* Creates a SymTable struct with no bindings. 
 
-Asserts: if memory was allocated succesfully for oSymTable at runtime. */
+Aborts if memory could not be allocated for oSymTable, see SymTable_tryNew. */
 SymTable_T SymTable_new(void);
 
 
-/* Frees all memory used by oSymTable.
+/* Creates a SymTable struct with no bindings.
+
+Returns: a SymTable_T type or NULL if memory could not be allocated */
+SymTable_T SymTable_tryNew(void);
+
+
+/* Creates a SymTable struct with no bindings. Keys inserted with
+SymTable_putBlob reference pcBlob and are never copied. pcBlob must not change
+and must outlive the table.
+
+Asserts: if pcBlob is not NULL at runtime.
+
+Aborts if memory could not be allocated for oSymTable.
+
+Parameters:
+* pcBlob: read-only block of null terminated keys (e.g. a mmap'd file)
+* uiSize: size of pcBlob in bytes */
+SymTable_T SymTable_newBlob(const char *pcBlob, size_t uiSize);
+
+
+/* Frees all memory used by oSymTable. Every value is released if oSymTable
+has a release callback (see SymTable_setValueCallbacks).
 
 Parameters:
 * oSymTable: a SymTable_T type */
@@ -32,9 +70,9 @@ unsigned int SymTable_getLength(SymTable_T oSymTable);
 
 /* Creates a new binding for oSymTable from a given pcKey and pvValue.
 
-Asserts: 
-1) if oSymTable and pcKey are not NULL at runtime.
-2) if necessary memory was allocated succesfully at runtime.
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Aborts if necessary memory could not be allocated, see SymTable_tryPut.
 
 Parameters:
 * oSymTable: a SymTable_T type
@@ -43,6 +81,39 @@ Parameters:
 void SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue);
 
 
+/* Creates a new binding for oSymTable from a given pcKey and pvValue.
+Same as SymTable_put, except that failing to allocate memory is reported
+instead of aborting. When the table would grow but the larger bucket array
+cannot be allocated, the binding is added to the current buckets.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value
+
+Returns: 1 on success, 0 if memory could not be allocated. In that case
+oSymTable is not modified. */
+int SymTable_tryPut(SymTable_T oSymTable, const char *pcKey, const void *pvValue);
+
+
+/* Creates a new binding for oSymTable whose key is the null terminated string
+that starts at offset uiOffset of the table blob. The key is not copied.
+
+Asserts:
+1) if oSymTable is not NULL and has a blob at runtime.
+2) if the key at uiOffset is null terminated inside the blob at runtime.
+
+Aborts if necessary memory could not be allocated.
+
+Parameters:
+* oSymTable: a SymTable_T type created by SymTable_newBlob
+* uiOffset: offset of the key in the blob
+* pvValue: pointer to any value */
+void SymTable_putBlob(SymTable_T oSymTable, size_t uiOffset, const void *pvValue);
+
+
 /* Removes a binding with key equal to pcKey.
 
 Asserts: if oSymTable and pcKey are not NULL at runtime.
@@ -55,6 +126,30 @@ Returns: 1 if removal was successful, 0 if such binding was not found */
 int SymTable_remove(SymTable_T oSymTable, const char *pcKey);
 
 
+/* Removes a binding with key equal to pcKey and gives its value, and
+optionally its key, to the caller, finding the key only once. The value is
+not released (see SymTable_setValueCallbacks): the reference held by
+oSymTable passes to the caller. The key is returned in memory that the
+caller frees with free; a key copied by the table is not copied again. In
+a table created by SymTable_newBlob the key is copied first, so that a
+failed allocation leaves oSymTable unchanged.
+
+Asserts:
+1) if oSymTable is not NULL and not a snapshot at runtime.
+2) if pcKey is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pcKey: a character array (key). Must be null terminated.
+* ppvValue: set to the value of the binding. Can be NULL.
+* ppcKey: set to the key of the binding. Can be NULL.
+
+Returns: 1 if the binding was found and removed, 0 if it was not found, -1
+if memory could not be allocated for the key. oSymTable is then not
+modified. */
+int SymTable_take(SymTable_T oSymTable, const char *pcKey, void **ppvValue, char **ppcKey);
+
+
 /* Checks whether a binding with key equal to pcKey is present in oSymTable.
 
 Asserts: if oSymTable and pcKey are not NULL at runtime.
@@ -79,6 +174,23 @@ Returns: a pointer to the value or NULL if such binding was not found. */
 void* SymTable_get(SymTable_T oSymTable, const char *pcKey);
 
 
+/* Finds in oSymTable the values of the uiCount keys of ppcKeys, like
+SymTable_get for each key. Hashing the keys together and prefetching their
+buckets before walking any chain makes this faster than separate calls on
+tables that do not fit in the CPU cache.
+
+Asserts: if oSymTable, ppcKeys, ppvValues and each key are not NULL at
+runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* ppcKeys: array of keys. Each must be null terminated.
+* uiCount: number of keys
+* ppvValues: array of uiCount values, set to the value of each key or NULL
+if it was not found */
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, unsigned int uiCount, void **ppvValues);
+
+
 /* Applies function pfApply to every binding in oSymTable.
 
 Asserts: if oSymTable and pfApply are not NULL at runtime.
@@ -92,6 +204,202 @@ void  SymTable_map(SymTable_T oSymTable,
         const void *pvExtra);
 
 
+/* Creates a SymTable struct with the bindings (ppcKeys[i], ppvValues[i]),
+using uiThreads threads. The result is the same as calling SymTable_put for
+each binding in order on a new table, a key that appears more than once is
+bound to its last value.
+
+Asserts: if ppcKeys and ppvValues are not NULL at runtime.
+
+Parameters:
+* ppcKeys: array of uiCount keys. Each must be null terminated.
+* ppvValues: array of uiCount pointers to any value
+* uiCount: number of bindings
+* uiThreads: number of threads. 0 is the same as 1. At most uiCount and 256
+threads are used.
+
+Returns: a SymTable_T type or NULL if memory could not be allocated */
+SymTable_T SymTable_buildParallel(const char **ppcKeys, const void **ppvValues, unsigned int uiCount, unsigned int uiThreads);
+
+
+/* Sets the resize policy of oSymTable. The load factor is the number of
+bindings divided by the number of buckets.
+
+1) When the load factor reaches dMaxLoad, the number of buckets is multiplied
+by at least dGrowth.
+2) When the load factor drops below dMinLoad, the number of buckets is
+reduced. 0 disables shrinking.
+3) The bucket array never grows beyond what keeps the total memory of the
+table within uiMaxBytes, the table then uses longer chains. Bindings are
+always added. 0 means no limit.
+
+The default policy is dMinLoad = 0, dMaxLoad = 1, dGrowth = 1 and
+uiMaxBytes = 0.
+
+Asserts:
+1) if oSymTable is not NULL at runtime.
+2) if 0 <= dMinLoad < dMaxLoad and dGrowth >= 1 at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* dMinLoad: minimum load factor
+* dMaxLoad: maximum load factor
+* dGrowth: minimum growth factor of the number of buckets
+* uiMaxBytes: maximum number of bytes allocated by the table */
+void SymTable_setPolicy(SymTable_T oSymTable, double dMinLoad, double dMaxLoad, double dGrowth, size_t uiMaxBytes);
+
+
+/* Returns the number of bytes allocated by oSymTable, including its bucket
+array, its bindings and the keys it owns.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type */
+size_t SymTable_getBytes(SymTable_T oSymTable);
+
+
+/* Fills *pMemory with the bytes allocated by oSymTable for each of its parts.
+The sum is SymTable_getBytes(oSymTable). Allocator overhead is not included.
+
+Asserts: if oSymTable and pMemory are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pMemory: the result */
+void SymTable_getMemory(SymTable_T oSymTable, struct SymTable_memory *pMemory);
+
+
+/* Enables sampling of the successful SymTable_get calls of oSymTable, on
+average 1 in uiRate calls, or disables it if uiRate is 0. Sampled keys are
+counted, see SymTable_topKeys. Counts are halved periodically, so they
+follow changes of the access pattern. Sampling does not prevent calling
+SymTable_get, SymTable_getBatch and SymTable_topKeys from several threads at
+the same time; a sample that would be counted at the same time as another
+one is skipped.
+
+Asserts: if oSymTable is not NULL and not a snapshot at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* uiRate: average number of calls per sample, 0 to disable sampling
+
+Returns: 1 on success, 0 if memory could not be allocated. In that case
+sampling stays disabled. */
+int SymTable_setSampling(SymTable_T oSymTable, unsigned int uiRate);
+
+
+/* Fills ppcKeys with the keys of up to uiMax of the hottest bindings of
+oSymTable, hottest first, and pulCounts with their estimated number of
+SymTable_get calls. Requires sampling, see SymTable_setSampling. The keys
+remain valid until their bindings are removed.
+
+Asserts: if oSymTable, ppcKeys and pulCounts are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* ppcKeys: array of at least uiMax keys
+* pulCounts: array of at least uiMax counts
+* uiMax: maximum number of keys
+
+Returns: the number of keys, at most 16. 0 if sampling is disabled. */
+unsigned int SymTable_topKeys(SymTable_T oSymTable, const char **ppcKeys, unsigned long *pulCounts,
+        unsigned int uiMax);
+
+
+/* Enables a direct-mapped cache of uiEntries bindings that SymTable_get
+looks up before the bucket array, or disables it if uiEntries is 0. The
+number of entries is rounded up to a power of 2, at most 65536. The cache
+speeds up lookups of a few hot keys. SymTable_get and SymTable_getBatch
+stay safe to call from several threads at once with the cache enabled.
+
+Asserts: if oSymTable is not NULL and not a snapshot at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* uiEntries: number of entries, 0 to disable the cache
+
+Returns: 1 on success, 0 if memory could not be allocated. In that case
+oSymTable keeps its previous cache, if any. */
+int SymTable_setCache(SymTable_T oSymTable, unsigned int uiEntries);
+
+
+/* Sets the functions that oSymTable calls when it starts and stops holding a
+value, so that values can be reference counted or owned by the table.
+pfRetain is called with each value that is put in oSymTable, pfRelease with
+each value that leaves it: when SymTable_put replaces it, when its binding is
+removed and when oSymTable is freed. The new value is retained before the
+old one is released. With only pfRelease, e.g. free, oSymTable owns its
+values, and putting the value a key already has releases nothing. Values
+already in oSymTable are released like the others. The callbacks must not
+modify oSymTable.
+
+Asserts: if oSymTable is not NULL and not a snapshot at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pfRetain: function called with a value and pvExtra, or NULL
+* pfRelease: function called with a value and pvExtra, or NULL
+* pvExtra: a pointer to any value. Used by pfRetain and pfRelease. */
+void SymTable_setValueCallbacks(SymTable_T oSymTable,
+        void (*pfRetain)(void *pvValue, void *pvExtra),
+        void (*pfRelease)(void *pvValue, void *pvExtra),
+        const void *pvExtra);
+
+
+/* Creates a read-only snapshot of oSymTable. The snapshot has the same
+bindings as oSymTable at the time of the call and does not share any memory
+with it, therefore it can be read (SymTable_get, SymTable_contains,
+SymTable_map, ...) while oSymTable keeps changing. Values are shared; a
+snapshot has the value callbacks of oSymTable, retains every value and
+releases them when it is freed. A snapshot of a table without retain
+function has no callbacks, so the values stay owned by oSymTable.
+SymTable_put, SymTable_putBlob and SymTable_remove must not be used on the
+snapshot. It must be freed with SymTable_free.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+
+Returns: a SymTable_T type that cannot be modified, or NULL if memory could
+not be allocated */
+SymTable_T SymTable_snapshot(SymTable_T oSymTable);
+
+
+/* Computes the hash code for pcKey. The bucket of pcKey is the hash code
+modulo the number of buckets.
+
+Asserts: if pcKey is NULL at runtime.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+unsigned int SymTable_hashKey(const char *pcKey);
+
+
+/* Computes the hash codes of the uiCount keys of ppcKeys into puiCodes, the
+same as SymTable_hashKey. Several keys are hashed together, which is faster
+than one at a time.
+
+Asserts: if ppcKeys, puiCodes and each key are not NULL at runtime.
+
+Parameters:
+* ppcKeys: array of keys. Each must be null terminated.
+* uiCount: number of keys
+* puiCodes: array of uiCount hash codes */
+void SymTable_hashKeys(const char **ppcKeys, unsigned int uiCount, unsigned int *puiCodes);
+
+
+/* Returns the number of bucket sizes a table can have and sets *ppuiSizes
+to an array with them, in increasing order.
+
+Asserts: if ppuiSizes is not NULL at runtime.
+
+Parameters:
+* ppuiSizes: pointer that is set to the array of sizes */
+unsigned int SymTable_bucketSizes(const unsigned int **ppuiSizes);
+
+
 /* Prints basic information about the hashtable:
 1) Max bindings in a bucket.
 2) Min binding in a bucket.
@@ -0,0 +1,140 @@
+/* Library for creating and using thread-safe Symbol tables.
+
+All functions can be called concurrently from any number of threads on the
+same table, except SymTableConc_new and SymTableConc_free.
+
+symtablehp.c and symtableseq.c both implement these functions under the
+same names, so the implementation is selected when linking: a program links
+exactly one of symtablehp.o and symtableseq.o. */
+
+#ifndef SYMTABLECONC_INCLUDE
+#define SYMTABLECONC_INCLUDE
+
+#include <stdio.h>
+
+typedef void* SymTableConc_T;
+
+
+/* Creates a SymTableConc struct with no bindings.
+
+Asserts: if memory was allocated succesfully at runtime. */
+SymTableConc_T SymTableConc_new(void);
+
+
+/* Frees all memory used by oSymTable. No other thread may be using the
+table.
+
+Parameters:
+* oSymTable: a SymTableConc_T type */
+void SymTableConc_free(SymTableConc_T oSymTable);
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type */
+unsigned int SymTableConc_getLength(SymTableConc_T oSymTable);
+
+
+/* Creates a new binding for oSymTable from a given pcKey and pvValue.
+If pcKey exists, its value is updated.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value */
+void SymTableConc_put(SymTableConc_T oSymTable, const char *pcKey, const void *pvValue);
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTableConc_remove(SymTableConc_T oSymTable, const char *pcKey);
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableConc_contains(SymTableConc_T oSymTable, const char *pcKey);
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTableConc_get(SymTableConc_T oSymTable, const char *pcKey);
+
+
+/* Adds lDelta to the value of the binding with key equal to pcKey, as one
+atomic step. The value is used as a counter: a pointer holding the count
+itself, read back with (long) (size_t) SymTableConc_get(oSymTable, pcKey).
+If pcKey does not exist, a binding with count lDelta is created.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* lDelta: number to add, can be negative
+
+Returns: the count after the addition */
+long SymTableConc_atomicAdd(SymTableConc_T oSymTable, const char *pcKey, long lDelta);
+
+
+/* Sets the value of the binding with key equal to pcKey to pvValue, only if
+its value is pvExpected, as one atomic step.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvExpected: the value the binding must have
+* pvValue: the new value
+
+Returns: 1 if the value was replaced, 0 if such binding was not found or
+its value was not pvExpected */
+int SymTableConc_compareAndSwap(SymTableConc_T oSymTable, const char *pcKey,
+        const void *pvExpected, const void *pvValue);
+
+
+/* Applies function pfApply to every binding in oSymTable. Modifications of
+the table wait until pfApply has been applied to every binding, therefore
+pfApply must not modify oSymTable.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableConc_map(SymTableConc_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra);
+
+#endif
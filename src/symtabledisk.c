@@ -0,0 +1,1218 @@
+/* Library for creating and using Symbol tables that keep their bindings on
+disk.
+
+Each binding is a record appended to a log file: a header with the sizes of
+the key and the value, the key padded to 8 bytes, and the value. Replacing
+or removing a binding leaves its old record in the log as garbage, and the
+log is compacted when the garbage takes more space than the live records.
+
+In memory, each binding is an index entry with the full hash code of its key
+and the position of its record, in a hash array with linked lists for
+resolving conflicts. Keys are compared only when hash codes are equal.
+Recently used records are also kept in memory, up to a budget, and the
+least recently used one is evicted first. New records are collected in a
+write buffer before they are written to the file.
+
+SymTableDisk_getBatch issues the reads of many lookups at once through
+io_uring on Linux, with the raw system calls since liburing is not required,
+and falls back to pread where io_uring is not available. */
+
+#define _XOPEN_SOURCE 500
+#define _DEFAULT_SOURCE
+#define _FILE_OFFSET_BITS 64
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+#include "symtabledisk.h"
+
+#define HASH_MULTIPLIER 65599
+#define MAX_BUCKETS 16777213
+#define MIN_BUCKETS 519
+#define WRITE_BUFFER 65536      /* bytes of the write buffer */
+#define COMPACT_MIN 1048576     /* bytes of garbage before the log is compacted */
+#define ALIGN 8                 /* alignment of keys and values in a record */
+#define QUEUE_DEPTH 256         /* reads in flight in SymTableDisk_getBatch */
+
+/* the index is meant for more bindings than fit in memory, so it grows
+beyond the largest table of symtablehash.c */
+static unsigned const BUCKARR[] = {MIN_BUCKETS, 1021, 2053, 4093, 8191, 16381, 32771, 65521,
+    131071, 262139, 524287, 1048573, 2097143, 4194301, 8388593, MAX_BUCKETS};
+
+
+/* Struct that represents the header of a record in the log.
+uiKeySize: size of the key, including its '\0' and the padding
+uiValueSize: size of the value */
+struct record {
+    unsigned int uiKeySize;
+    unsigned int uiValueSize;
+};
+
+
+/* Struct that represents a record kept in memory. The record is stored right
+after the struct, so its value is aligned to ALIGN bytes. prev and next link
+the records in most recently used order. */
+struct resident {
+    struct dbind *bind;
+    struct resident *prev;
+    struct resident *next;
+};
+
+
+/* Struct that represents a binding in the index.
+uiCode: hash code of the key
+uiSize: size of the record
+offset: position of the record in the log
+resident: the record if it is kept in memory, NULL otherwise
+next: next binding of the bucket */
+struct dbind {
+    unsigned int uiCode;
+    unsigned int uiSize;
+    off_t offset;
+    struct resident *resident;
+    struct dbind *next;
+};
+
+
+/* Struct that represents an io_uring instance: the file descriptor and the
+shared submission and completion rings, see io_uring_setup(2). */
+struct uring {
+    int iFd;
+    unsigned int *puiSqHead;
+    unsigned int *puiSqTail;
+    unsigned int *puiSqMask;
+    unsigned int *puiSqArray;
+    unsigned int *puiCqHead;
+    unsigned int *puiCqTail;
+    unsigned int *puiCqMask;
+    void *pvSqes;
+    void *pvCqes;
+    void *pvSq;
+    void *pvCq;
+    size_t uiSqSize;
+    size_t uiCqSize;
+    size_t uiSqesSize;
+};
+
+
+/* Struct that represents a read of a record in SymTableDisk_getBatch.
+uiIndex: the key the record may belong to
+bind: the binding whose record is read
+res: the memory the record is read into. It becomes the record in memory of
+bind if the key matches. */
+struct request {
+    unsigned int uiIndex;
+    struct dbind *bind;
+    struct resident *res;
+};
+
+
+/* Struct that holds the state of SymTableDisk_getBatch.
+ppcKeys, uiCount: the keys
+pfDone, pvExtra: the function that gets the values, and its argument
+puiWaiting: reads in flight for each key
+pcDone: 1 for the keys that pfDone got
+pcFailed: 1 for the keys whose reads failed
+requests, uiRequests: the reads */
+struct batch {
+    const char **ppcKeys;
+    unsigned int uiCount;
+    void (*pfDone)(unsigned int uiIndex, const void *pvValue, size_t uiSize, void *pvExtra);
+    void *pvExtra;
+    unsigned int *puiWaiting;
+    char *pcDone;
+    char *pcFailed;
+    struct request *requests;
+    unsigned int uiRequests;
+};
+
+
+/* Struct that represents a disk based symbol table.
+iFd: the log file
+uiBindings, uiBuckets, array: the index
+end: size of the log
+flushed: size of the part of the log that is in the file. The rest is in
+pcBuffer.
+uiLive, uiDead: bytes of the records of the bindings and of garbage
+uiMaxMemory: bytes of records that can be kept in memory
+uiResident: bytes of records kept in memory
+head, tail: most and least recently used record in memory
+pcScratch, uiScratch: buffer for records that are read but not kept
+ring: the io_uring of SymTableDisk_getBatch, NULL until it is first needed
+iNoRing: 1 if io_uring is not available, SymTableDisk_getBatch then uses
+pread */
+struct SymTableDisk {
+    int iFd;
+    unsigned int uiBindings;
+    unsigned int uiBuckets;
+    struct dbind **array;
+    off_t end;
+    off_t flushed;
+    char *pcBuffer;
+    size_t uiLive;
+    size_t uiDead;
+    size_t uiMaxMemory;
+    size_t uiResident;
+    struct resident *head;
+    struct resident *tail;
+    char *pcScratch;
+    size_t uiScratch;
+    struct uring *ring;
+    int iNoRing;
+};
+
+
+static unsigned int SymTableDisk_hashKey(const char *pcKey);
+static size_t SymTableDisk_keySize(const char *pcKey);
+static int SymTableDisk_read(int iFd, char *pcBuf, size_t uiSize, off_t offset);
+static int SymTableDisk_write(int iFd, const char *pcBuf, size_t uiSize, off_t offset);
+static int SymTableDisk_flush(struct SymTableDisk *symtable);
+static int SymTableDisk_append(struct SymTableDisk *symtable, const char *pcKey, const void *pvValue,
+    size_t uiSize, off_t *pOffset);
+static int SymTableDisk_readRecord(struct SymTableDisk *symtable, struct dbind *pBind, char *pcDest);
+static char *SymTableDisk_scratch(struct SymTableDisk *symtable, size_t uiSize);
+static char *SymTableDisk_load(struct SymTableDisk *symtable, struct dbind *pBind);
+static void SymTableDisk_promote(struct SymTableDisk *symtable, struct resident *pRes);
+static void SymTableDisk_unlink(struct SymTableDisk *symtable, struct resident *pRes);
+static void SymTableDisk_drop(struct SymTableDisk *symtable, struct dbind *pBind);
+static int SymTableDisk_find(struct SymTableDisk *symtable, const char *pcKey, struct dbind ***pppLink);
+static void SymTableDisk_change(struct SymTableDisk *symtable, unsigned int uiBuckets);
+static int SymTableDisk_compact(struct SymTableDisk *symtable);
+static int SymTableDisk_compareOffsets(const void *a, const void *b);
+static void SymTableDisk_complete(struct SymTableDisk *symtable, struct batch *pBatch, struct request *pReq,
+    int iOk);
+static void SymTableDisk_finish(struct batch *pBatch, unsigned int uiIndex);
+static struct uring *SymTableDisk_ringNew(void);
+static void SymTableDisk_ringFree(struct uring *ring);
+static unsigned int SymTableDisk_ringRun(struct SymTableDisk *symtable, struct batch *pBatch,
+    unsigned int uiNext);
+
+
+/* Computes the hash code for pcKey, the same as SymTable_hashKey.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+static unsigned int SymTableDisk_hashKey(const char *pcKey) {
+    size_t ui;
+    unsigned int uiHash;
+
+    uiHash = 0U;
+    for (ui = 0U; pcKey[ui] != '\0'; ui++) {
+        uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+    }
+    return uiHash;
+}
+
+
+/* Returns the size of pcKey in a record: its length, plus its '\0', rounded
+up to a multiple of ALIGN.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+static size_t SymTableDisk_keySize(const char *pcKey) {
+    return (strlen(pcKey) + ALIGN) / ALIGN * ALIGN;
+}
+
+
+/* Reads uiSize bytes at offset of file iFd into pcBuf, retrying short and
+interrupted reads.
+
+Returns: 1 on success, 0 on error */
+static int SymTableDisk_read(int iFd, char *pcBuf, size_t uiSize, off_t offset) {
+    ssize_t iDone;
+
+    while (uiSize) {
+        iDone = pread(iFd, pcBuf, uiSize, offset);
+        if (iDone < 0 && errno == EINTR) {
+            continue;
+        }
+        if (iDone <= 0) {
+            return 0;
+        }
+        pcBuf += iDone;
+        uiSize -= iDone;
+        offset += iDone;
+    }
+    return 1;
+}
+
+
+/* Writes uiSize bytes of pcBuf at offset of file iFd, retrying short and
+interrupted writes.
+
+Returns: 1 on success, 0 on error */
+static int SymTableDisk_write(int iFd, const char *pcBuf, size_t uiSize, off_t offset) {
+    ssize_t iDone;
+
+    while (uiSize) {
+        iDone = pwrite(iFd, pcBuf, uiSize, offset);
+        if (iDone < 0 && errno == EINTR) {
+            continue;
+        }
+        if (iDone <= 0) {
+            return 0;
+        }
+        pcBuf += iDone;
+        uiSize -= iDone;
+        offset += iDone;
+    }
+    return 1;
+}
+
+
+/* Writes the write buffer of symtable to the file. If that fails, the
+records stay in the buffer.
+
+Returns: 1 on success, 0 on error */
+static int SymTableDisk_flush(struct SymTableDisk *symtable) {
+    if (symtable->flushed == symtable->end) {
+        return 1;
+    }
+    if (!SymTableDisk_write(symtable->iFd, symtable->pcBuffer, symtable->end - symtable->flushed,
+            symtable->flushed)) {
+        return 0;
+    }
+    symtable->flushed = symtable->end;
+    return 1;
+}
+
+
+/* Appends a record for pcKey and the uiSize bytes of pvValue to the log of
+symtable. The record goes to the write buffer, or directly to the file if
+it does not fit in the buffer.
+
+Parameters:
+* symtable: the table
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: the value
+* uiSize: size of the value
+* pOffset: set to the position of the record
+
+Returns: 1 on success, 0 if the file could not be written. The log is then
+not modified. */
+static int SymTableDisk_append(struct SymTableDisk *symtable, const char *pcKey, const void *pvValue,
+        size_t uiSize, off_t *pOffset) {
+    struct record header;
+    size_t uiKeySize, uiRecord;
+    char *pcDest;
+
+    uiKeySize = SymTableDisk_keySize(pcKey);
+    uiRecord = sizeof(struct record) + uiKeySize + uiSize;
+    assert(uiRecord <= UINT_MAX);
+    if (symtable->end - symtable->flushed + uiRecord > WRITE_BUFFER && !SymTableDisk_flush(symtable)) {
+        return 0;
+    }
+    if (uiRecord > WRITE_BUFFER) {
+        pcDest = SymTableDisk_scratch(symtable, uiRecord);
+    }
+    else {
+        pcDest = symtable->pcBuffer + (symtable->end - symtable->flushed);
+    }
+
+    header.uiKeySize = uiKeySize;
+    header.uiValueSize = uiSize;
+    memcpy(pcDest, &header, sizeof(struct record));
+    memset(pcDest + sizeof(struct record), '\0', uiKeySize);
+    strcpy(pcDest + sizeof(struct record), pcKey);
+    if (uiSize) {
+        memcpy(pcDest + sizeof(struct record) + uiKeySize, pvValue, uiSize);
+    }
+
+    if (uiRecord > WRITE_BUFFER) {
+        if (!SymTableDisk_write(symtable->iFd, pcDest, uiRecord, symtable->end)) {
+            return 0;
+        }
+        symtable->flushed += uiRecord;
+    }
+    *pOffset = symtable->end;
+    symtable->end += uiRecord;
+    return 1;
+}
+
+
+/* Copies the record of pBind, from the write buffer or from the file, to
+pcDest.
+
+Returns: 1 on success, 0 if the file could not be read */
+static int SymTableDisk_readRecord(struct SymTableDisk *symtable, struct dbind *pBind, char *pcDest) {
+    if (pBind->offset >= symtable->flushed) {
+        memcpy(pcDest, symtable->pcBuffer + (pBind->offset - symtable->flushed), pBind->uiSize);
+        return 1;
+    }
+    return SymTableDisk_read(symtable->iFd, pcDest, pBind->uiSize, pBind->offset);
+}
+
+
+/* Returns the scratch buffer of symtable, grown to at least uiSize bytes.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static char *SymTableDisk_scratch(struct SymTableDisk *symtable, size_t uiSize) {
+    if (symtable->uiScratch < uiSize) {
+        free(symtable->pcScratch);
+        symtable->pcScratch = malloc(uiSize);
+        assert(symtable->pcScratch);
+        symtable->uiScratch = uiSize;
+    }
+    return symtable->pcScratch;
+}
+
+
+/* Makes the record of pBind the most recently used record in memory,
+reading it if necessary, and evicts the least recently used records while
+the memory budget is exceeded. The record of pBind is never evicted here.
+
+Asserts: if memory was allocated succesfully at runtime.
+
+Returns: the record or NULL if the file could not be read */
+static char *SymTableDisk_load(struct SymTableDisk *symtable, struct dbind *pBind) {
+    struct resident *res;
+
+    res = pBind->resident;
+    if (res) {
+        SymTableDisk_unlink(symtable, res);
+    }
+    else {
+        res = malloc(sizeof(struct resident) + pBind->uiSize);
+        assert(res);
+        if (!SymTableDisk_readRecord(symtable, pBind, (char *) (res + 1))) {
+            free(res);
+            return NULL;
+        }
+        res->bind = pBind;
+        pBind->resident = res;
+        symtable->uiResident += sizeof(struct resident) + pBind->uiSize;
+    }
+    SymTableDisk_promote(symtable, res);
+    return (char *) (res + 1);
+}
+
+
+/* Makes pRes, a record in memory that is not in the list of records in
+memory, the most recently used one, and evicts the least recently used
+records other than pRes while the memory budget is exceeded. */
+static void SymTableDisk_promote(struct SymTableDisk *symtable, struct resident *pRes) {
+    pRes->prev = NULL;
+    pRes->next = symtable->head;
+    if (symtable->head) {
+        symtable->head->prev = pRes;
+    }
+    else {
+        symtable->tail = pRes;
+    }
+    symtable->head = pRes;
+
+    while (symtable->uiResident > symtable->uiMaxMemory && symtable->tail != pRes) {
+        SymTableDisk_drop(symtable, symtable->tail->bind);
+    }
+}
+
+
+/* Removes pRes from the list of records in memory. */
+static void SymTableDisk_unlink(struct SymTableDisk *symtable, struct resident *pRes) {
+    if (pRes->prev) {
+        pRes->prev->next = pRes->next;
+    }
+    else {
+        symtable->head = pRes->next;
+    }
+    if (pRes->next) {
+        pRes->next->prev = pRes->prev;
+    }
+    else {
+        symtable->tail = pRes->prev;
+    }
+}
+
+
+/* Frees the record of pBind that is kept in memory, if there is one. */
+static void SymTableDisk_drop(struct SymTableDisk *symtable, struct dbind *pBind) {
+    if (!pBind->resident) {
+        return;
+    }
+    SymTableDisk_unlink(symtable, pBind->resident);
+    symtable->uiResident -= sizeof(struct resident) + pBind->uiSize;
+    free(pBind->resident);
+    pBind->resident = NULL;
+}
+
+
+/* Finds in symtable a binding with key equal to pcKey. The records of the
+bindings whose hash code is equal to the one of pcKey are loaded to compare
+the keys.
+
+Parameters:
+* symtable: the table
+* pcKey: a character array (key). Must be null terminated.
+* pppLink: set to the pointer to the binding, or to the NULL pointer at the
+end of the bucket if it is not found
+
+Returns: 1 if the binding is found, 0 if it is not found, -1 if the file
+could not be read */
+static int SymTableDisk_find(struct SymTableDisk *symtable, const char *pcKey, struct dbind ***pppLink) {
+    struct dbind **link, *ptr;
+    unsigned int uiCode;
+    char *pcRecord;
+
+    uiCode = SymTableDisk_hashKey(pcKey);
+    for (link = &symtable->array[uiCode % symtable->uiBuckets]; (ptr = *link); link = &ptr->next) {
+        if (ptr->uiCode != uiCode) {
+            continue;
+        }
+        pcRecord = SymTableDisk_load(symtable, ptr);
+        if (!pcRecord) {
+            return -1;
+        }
+        if (!strcmp(pcRecord + sizeof(struct record), pcKey)) {
+            *pppLink = link;
+            return 1;
+        }
+    }
+    *pppLink = link;
+    return 0;
+}
+
+
+/* Rehashes the index of symtable into uiBuckets buckets, using the hash
+codes of the bindings. No record is read.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static void SymTableDisk_change(struct SymTableDisk *symtable, unsigned int uiBuckets) {
+    struct dbind **bind_arr, *ptr, *ptr_next;
+    unsigned int ui, uiHash;
+
+    bind_arr = calloc(uiBuckets, sizeof(struct dbind *));
+    assert(bind_arr);
+    for (ui = 0U; ui < symtable->uiBuckets; ui++) {
+        for (ptr = symtable->array[ui]; ptr; ptr = ptr_next) {
+            ptr_next = ptr->next;
+            uiHash = ptr->uiCode % uiBuckets;
+            ptr->next = bind_arr[uiHash];
+            bind_arr[uiHash] = ptr;
+        }
+    }
+    free(symtable->array);
+    symtable->array = bind_arr;
+    symtable->uiBuckets = uiBuckets;
+}
+
+
+/* Moves the live records of symtable to the start of the log, in the order
+they were written, and truncates the garbage after them. A record is first
+copied to its new place and only then does its binding point there, so a
+failed write leaves the binding on its old copy. A record whose new place
+would overlap its old copy is not moved, since a failed write would then
+damage the only copy; the garbage before it stays.
+
+Returns: 1 on success, 0 if memory could not be allocated or the file could
+not be read or written. Bindings that were moved before the failure point to
+their new records and the others to their old ones. */
+static int SymTableDisk_compact(struct SymTableDisk *symtable) {
+    struct dbind **binds, *ptr;
+    unsigned int ui, uiCount;
+    size_t uiDead;
+    off_t offset;
+    char *pcRecord;
+
+    if (!SymTableDisk_flush(symtable)) {
+        return 0;
+    }
+    binds = malloc((symtable->uiBindings + 1) * sizeof(struct dbind *));
+    if (!binds) {
+        return 0;
+    }
+    uiCount = 0U;
+    for (ui = 0U; ui < symtable->uiBuckets; ui++) {
+        for (ptr = symtable->array[ui]; ptr; ptr = ptr->next) {
+            binds[uiCount++] = ptr;
+        }
+    }
+    qsort(binds, uiCount, sizeof(struct dbind *), SymTableDisk_compareOffsets);
+
+    offset = 0;
+    uiDead = 0U;
+    for (ui = 0U; ui < uiCount; ui++) {
+        if (binds[ui]->offset != offset && offset + binds[ui]->uiSize > binds[ui]->offset) {
+            uiDead += binds[ui]->offset - offset;
+            offset = binds[ui]->offset;
+        }
+        else if (binds[ui]->offset != offset) {
+            pcRecord = SymTableDisk_scratch(symtable, binds[ui]->uiSize);
+            if (!SymTableDisk_readRecord(symtable, binds[ui], pcRecord) ||
+                    !SymTableDisk_write(symtable->iFd, pcRecord, binds[ui]->uiSize, offset)) {
+                free(binds);
+                return 0;
+            }
+            binds[ui]->offset = offset;
+        }
+        offset += binds[ui]->uiSize;
+    }
+    free(binds);
+
+    /* if the file cannot be truncated, the garbage after the last record
+    stays in the log and new records are appended after it */
+    if (ftruncate(symtable->iFd, offset)) {
+        uiDead += symtable->end - offset;
+    }
+    else {
+        symtable->end = offset;
+        symtable->flushed = offset;
+    }
+    symtable->uiDead = uiDead;
+    return 1;
+}
+
+
+/* Comparison function of qsort for bindings by the position of their
+records. */
+static int SymTableDisk_compareOffsets(const void *a, const void *b) {
+    off_t x, y;
+
+    x = (*(struct dbind * const *) a)->offset;
+    y = (*(struct dbind * const *) b)->offset;
+    return (x > y) - (x < y);
+}
+
+
+/* Creates a SymTableDisk struct with no bindings that stores them in a new
+file at pcPath. An existing file at pcPath is replaced. The file is removed
+from its directory immediately, so it disappears when the table is freed or
+the program exits.
+
+Asserts:
+1) if pcPath is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* pcPath: path of the file
+* uiMaxMemory: bytes of recently used records to keep in memory
+
+Returns: a SymTableDisk_T type or NULL if the file could not be created */
+SymTableDisk_T SymTableDisk_new(const char *pcPath, size_t uiMaxMemory) {
+    struct SymTableDisk *symtable;
+    int iFd;
+
+    assert(pcPath);
+    iFd = open(pcPath, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (iFd < 0) {
+        return NULL;
+    }
+    unlink(pcPath);
+
+    symtable = malloc(sizeof(struct SymTableDisk));
+    assert(symtable);
+    symtable->array = calloc(MIN_BUCKETS, sizeof(struct dbind *));
+    assert(symtable->array);
+    symtable->pcBuffer = malloc(WRITE_BUFFER);
+    assert(symtable->pcBuffer);
+    symtable->iFd = iFd;
+    symtable->uiBindings = 0U;
+    symtable->uiBuckets = MIN_BUCKETS;
+    symtable->end = 0;
+    symtable->flushed = 0;
+    symtable->uiLive = 0U;
+    symtable->uiDead = 0U;
+    symtable->uiMaxMemory = uiMaxMemory;
+    symtable->uiResident = 0U;
+    symtable->head = NULL;
+    symtable->tail = NULL;
+    symtable->pcScratch = NULL;
+    symtable->uiScratch = 0U;
+    symtable->ring = NULL;
+    symtable->iNoRing = 0;
+    return (SymTableDisk_T) symtable;
+}
+
+
+/* Frees all memory used by oSymTable and closes its file.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type */
+void SymTableDisk_free(SymTableDisk_T oSymTable) {
+    struct SymTableDisk *symtable;
+    struct dbind *ptr, *ptr_next;
+    unsigned int ui;
+
+    symtable = oSymTable;
+    if (!symtable) {
+        return;
+    }
+    for (ui = 0U; ui < symtable->uiBuckets; ui++) {
+        for (ptr = symtable->array[ui]; ptr; ptr = ptr_next) {
+            ptr_next = ptr->next;
+            free(ptr->resident);
+            free(ptr);
+        }
+    }
+    SymTableDisk_ringFree(symtable->ring);
+    close(symtable->iFd);
+    free(symtable->pcScratch);
+    free(symtable->pcBuffer);
+    free(symtable->array);
+    free(symtable);
+}
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type */
+unsigned int SymTableDisk_getLength(SymTableDisk_T oSymTable) {
+    assert(oSymTable);
+    return ((struct SymTableDisk *) oSymTable)->uiBindings;
+}
+
+
+/* Creates a new binding for oSymTable from a given pcKey and a copy of the
+uiSize bytes at pvValue. If pcKey exists, its value is replaced: the new
+record is appended to the log and the old one becomes garbage. The log is
+compacted when its garbage is larger than its live records and COMPACT_MIN.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if pvValue is not NULL when uiSize is not 0 at runtime.
+3) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: the value
+* uiSize: size of the value in bytes
+
+Returns: 1 on success, 0 if the file could not be read or written. In that
+case oSymTable is not modified. */
+int SymTableDisk_put(SymTableDisk_T oSymTable, const char *pcKey, const void *pvValue, size_t uiSize) {
+    struct SymTableDisk *symtable;
+    struct dbind **link, *bind;
+    unsigned int uiHash, idx;
+    off_t offset;
+    int iFound;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+    assert(pvValue || !uiSize);
+
+    iFound = SymTableDisk_find(symtable, pcKey, &link);
+    if (iFound < 0 || !SymTableDisk_append(symtable, pcKey, pvValue, uiSize, &offset)) {
+        return 0;
+    }
+
+    if (iFound) {
+        bind = *link;
+        SymTableDisk_drop(symtable, bind);
+        symtable->uiLive -= bind->uiSize;
+        symtable->uiDead += bind->uiSize;
+    }
+    else {
+        /* grow the index when it has as many bindings as buckets */
+        if (symtable->uiBindings >= symtable->uiBuckets && symtable->uiBuckets != MAX_BUCKETS) {
+            for (idx = 0; BUCKARR[idx] <= symtable->uiBuckets; idx++) {
+            }
+            SymTableDisk_change(symtable, BUCKARR[idx]);
+        }
+        bind = malloc(sizeof(struct dbind));
+        assert(bind);
+        bind->uiCode = SymTableDisk_hashKey(pcKey);
+        bind->resident = NULL;
+        uiHash = bind->uiCode % symtable->uiBuckets;
+        bind->next = symtable->array[uiHash];
+        symtable->array[uiHash] = bind;
+        symtable->uiBindings += 1;
+    }
+    bind->offset = offset;
+    bind->uiSize = (unsigned int) (symtable->end - offset);
+    symtable->uiLive += bind->uiSize;
+
+    /* a failed compaction leaves the garbage for the next one */
+    if (symtable->uiDead > symtable->uiLive && symtable->uiDead >= COMPACT_MIN) {
+        SymTableDisk_compact(symtable);
+    }
+    return 1;
+}
+
+
+/* Removes a binding with key equal to pcKey. Its record becomes garbage.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found, -1 if
+the file could not be read */
+int SymTableDisk_remove(SymTableDisk_T oSymTable, const char *pcKey) {
+    struct SymTableDisk *symtable;
+    struct dbind **link, *bind;
+    int iFound;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    iFound = SymTableDisk_find(symtable, pcKey, &link);
+    if (iFound != 1) {
+        return iFound;
+    }
+    bind = *link;
+    *link = bind->next;
+    SymTableDisk_drop(symtable, bind);
+    symtable->uiLive -= bind->uiSize;
+    symtable->uiDead += bind->uiSize;
+    symtable->uiBindings -= 1;
+    free(bind);
+
+    if (symtable->uiDead > symtable->uiLive && symtable->uiDead >= COMPACT_MIN) {
+        SymTableDisk_compact(symtable);
+    }
+    return 1;
+}
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 if it is not found, -1 if the file could not
+be read */
+int SymTableDisk_contains(SymTableDisk_T oSymTable, const char *pcKey) {
+    struct dbind **link;
+
+    assert(oSymTable);
+    assert(pcKey);
+    return SymTableDisk_find(oSymTable, pcKey, &link);
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey. Its record becomes
+the most recently used record in memory.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pcKey: a character array (key). Must be null terminated.
+* puiSize: set to the size of the value in bytes. Can be NULL.
+
+Returns: a pointer to the value, aligned to 8 bytes, or NULL if such binding
+was not found or the file could not be read. The value may be moved or
+freed by the next call on oSymTable. */
+const void* SymTableDisk_get(SymTableDisk_T oSymTable, const char *pcKey, size_t *puiSize) {
+    struct record *header;
+    struct dbind **link;
+
+    assert(oSymTable);
+    assert(pcKey);
+
+    if (SymTableDisk_find(oSymTable, pcKey, &link) != 1) {
+        return NULL;
+    }
+    header = (struct record *) ((*link)->resident + 1);
+    if (puiSize) {
+        *puiSize = header->uiValueSize;
+    }
+    return (char *) (header + 1) + header->uiKeySize;
+}
+
+
+/* Applies function pfApply to every binding in oSymTable. Records that are
+not in memory are read into the scratch buffer, so the records in memory
+do not change.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pfApply: function to apply. It gets the key, the value and its size.
+* pvExtra: a pointer to any value. Used by pfApply.
+
+Returns: 1 on success, 0 if the file could not be read. pfApply has then
+been applied to some of the bindings. */
+int SymTableDisk_map(SymTableDisk_T oSymTable,
+        void (*pfApply)(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTableDisk *symtable;
+    struct record *header;
+    struct dbind *ptr;
+    unsigned int ui;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pfApply);
+
+    for (ui = 0U; ui < symtable->uiBuckets; ui++) {
+        for (ptr = symtable->array[ui]; ptr; ptr = ptr->next) {
+            if (ptr->resident) {
+                header = (struct record *) (ptr->resident + 1);
+            }
+            else {
+                header = (struct record *) SymTableDisk_scratch(symtable, ptr->uiSize);
+                if (!SymTableDisk_readRecord(symtable, ptr, (char *) header)) {
+                    return 0;
+                }
+            }
+            (*pfApply)((char *) (header + 1), (char *) (header + 1) + header->uiKeySize,
+                header->uiValueSize, (void *) pvExtra);
+        }
+    }
+    return 1;
+}
+
+
+/* Looks up the uiCount keys of ppcKeys in oSymTable and passes their values
+to pfDone. Values in memory or in the write buffer are passed first. The
+records of the other keys are read with up to QUEUE_DEPTH reads in flight,
+submitted through io_uring, or with pread if io_uring is not available, and
+each value is passed as soon as its read completes. Keys are compared only
+after their record is read, so a key with several candidate records (equal
+hash codes) has several reads.
+
+Asserts:
+1) if oSymTable, ppcKeys and pfDone are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* ppcKeys: array of keys. Each must be null terminated.
+* uiCount: number of keys
+* pfDone: function that gets the index of a key in ppcKeys, the value, or
+NULL if the key was not found or its record could not be read, and the size
+of the value. The value is only valid during the call. pfDone must not
+modify oSymTable.
+* pvExtra: a pointer to any value. Used by pfDone.
+
+Returns: 1 on success, 0 if the file could not be read for some keys */
+int SymTableDisk_getBatch(SymTableDisk_T oSymTable, const char **ppcKeys, unsigned int uiCount,
+        void (*pfDone)(unsigned int uiIndex, const void *pvValue, size_t uiSize, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTableDisk *symtable;
+    struct batch batch;
+    struct dbind *ptr;
+    struct request *req;
+    unsigned int ui, uiCode, uiMax, uiNext;
+    const char *pcRecord;
+    int iFailed;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(ppcKeys);
+    assert(pfDone);
+
+    batch.ppcKeys = ppcKeys;
+    batch.uiCount = uiCount;
+    batch.pfDone = pfDone;
+    batch.pvExtra = (void *) pvExtra;
+    batch.puiWaiting = calloc(uiCount + 1, sizeof(unsigned int));
+    batch.pcDone = calloc(uiCount + 1, 1);
+    batch.pcFailed = calloc(uiCount + 1, 1);
+    uiMax = uiCount + 1;
+    batch.requests = malloc(uiMax * sizeof(struct request));
+    assert(batch.puiWaiting && batch.pcDone && batch.pcFailed && batch.requests);
+    batch.uiRequests = 0U;
+
+    /* keys with a candidate record in memory or in the write buffer are
+    resolved now, the other candidates are read later */
+    for (ui = 0U; ui < uiCount; ui++) {
+        assert(ppcKeys[ui]);
+        uiCode = SymTableDisk_hashKey(ppcKeys[ui]);
+        for (ptr = symtable->array[uiCode % symtable->uiBuckets]; ptr; ptr = ptr->next) {
+            if (ptr->uiCode != uiCode) {
+                continue;
+            }
+            if (ptr->resident || ptr->offset >= symtable->flushed) {
+                pcRecord = ptr->resident ? (char *) (ptr->resident + 1) :
+                    symtable->pcBuffer + (ptr->offset - symtable->flushed);
+                if (strcmp(pcRecord + sizeof(struct record), ppcKeys[ui])) {
+                    continue;
+                }
+                pcRecord = SymTableDisk_load(symtable, ptr);
+                batch.pcDone[ui] = 1;
+                pfDone(ui, pcRecord + sizeof(struct record) + ((struct record *) pcRecord)->uiKeySize,
+                    ((struct record *) pcRecord)->uiValueSize, batch.pvExtra);
+                break;
+            }
+            if (batch.uiRequests == uiMax) {
+                uiMax *= 2;
+                batch.requests = realloc(batch.requests, uiMax * sizeof(struct request));
+                assert(batch.requests);
+            }
+            req = &batch.requests[batch.uiRequests++];
+            req->uiIndex = ui;
+            req->bind = ptr;
+            req->res = NULL;
+            batch.puiWaiting[ui]++;
+        }
+        if (!batch.pcDone[ui] && !batch.puiWaiting[ui]) {
+            SymTableDisk_finish(&batch, ui);
+        }
+    }
+
+    /* the reads: through io_uring while it works, the rest with pread */
+    if (!symtable->ring && !symtable->iNoRing && batch.uiRequests) {
+        symtable->ring = SymTableDisk_ringNew();
+        symtable->iNoRing = !symtable->ring;
+    }
+    uiNext = 0U;
+    if (symtable->ring) {
+        uiNext = SymTableDisk_ringRun(symtable, &batch, uiNext);
+    }
+    for (; uiNext < batch.uiRequests; uiNext++) {
+        req = &batch.requests[uiNext];
+        req->res = malloc(sizeof(struct resident) + req->bind->uiSize);
+        assert(req->res);
+        SymTableDisk_complete(symtable, &batch, req,
+            SymTableDisk_readRecord(symtable, req->bind, (char *) (req->res + 1)));
+    }
+
+    iFailed = 0;
+    for (ui = 0U; ui < uiCount; ui++) {
+        iFailed |= batch.pcFailed[ui];
+    }
+    free(batch.puiWaiting);
+    free(batch.pcDone);
+    free(batch.pcFailed);
+    free(batch.requests);
+    return !iFailed;
+}
+
+
+/* Handles a read of SymTableDisk_getBatch that has completed. If the key
+matches, the record becomes the record in memory of the binding, unless the
+binding already has one, and pfDone gets the value. Otherwise the memory of
+the read is freed.
+
+Parameters:
+* symtable: the table
+* pBatch: state of SymTableDisk_getBatch
+* pReq: the read
+* iOk: 1 if the record was read, 0 if the read failed */
+static void SymTableDisk_complete(struct SymTableDisk *symtable, struct batch *pBatch, struct request *pReq,
+        int iOk) {
+    struct record *header;
+    unsigned int uiIndex;
+
+    uiIndex = pReq->uiIndex;
+    pBatch->puiWaiting[uiIndex]--;
+    header = (struct record *) (pReq->res + 1);
+    if (!iOk) {
+        pBatch->pcFailed[uiIndex] = 1;
+    }
+    if (!iOk || pBatch->pcDone[uiIndex] || strcmp((char *) (header + 1), pBatch->ppcKeys[uiIndex])) {
+        free(pReq->res);
+        if (!pBatch->pcDone[uiIndex] && !pBatch->puiWaiting[uiIndex]) {
+            SymTableDisk_finish(pBatch, uiIndex);
+        }
+        return;
+    }
+
+    if (pReq->bind->resident) {
+        free(pReq->res);
+        SymTableDisk_load(symtable, pReq->bind);
+    }
+    else {
+        pReq->res->bind = pReq->bind;
+        pReq->bind->resident = pReq->res;
+        symtable->uiResident += sizeof(struct resident) + pReq->bind->uiSize;
+        SymTableDisk_promote(symtable, pReq->res);
+    }
+    header = (struct record *) (pReq->bind->resident + 1);
+    pBatch->pcDone[uiIndex] = 1;
+    pBatch->pfDone(uiIndex, (char *) (header + 1) + header->uiKeySize, header->uiValueSize, pBatch->pvExtra);
+}
+
+
+/* Passes NULL to the pfDone of SymTableDisk_getBatch for a key that has no
+candidate record left. */
+static void SymTableDisk_finish(struct batch *pBatch, unsigned int uiIndex) {
+    pBatch->pcDone[uiIndex] = 1;
+    pBatch->pfDone(uiIndex, NULL, 0U, pBatch->pvExtra);
+}
+
+
+#ifdef __linux__
+/* Creates an io_uring with QUEUE_DEPTH entries and maps its rings.
+
+Returns: the io_uring or NULL if it is not available */
+static struct uring *SymTableDisk_ringNew(void) {
+    struct io_uring_params params;
+    struct uring *ring;
+    char *pcSq, *pcCq;
+    long lFd;
+
+    memset(&params, 0, sizeof(params));
+    lFd = syscall(__NR_io_uring_setup, QUEUE_DEPTH, &params);
+    if (lFd < 0) {
+        return NULL;
+    }
+    ring = malloc(sizeof(struct uring));
+    assert(ring);
+    ring->iFd = (int) lFd;
+    ring->uiSqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    ring->uiCqSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->uiSqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->pvSq = mmap(NULL, ring->uiSqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->iFd, IORING_OFF_SQ_RING);
+    ring->pvCq = mmap(NULL, ring->uiCqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->iFd, IORING_OFF_CQ_RING);
+    ring->pvSqes = mmap(NULL, ring->uiSqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring->iFd, IORING_OFF_SQES);
+    if (ring->pvSq == MAP_FAILED || ring->pvCq == MAP_FAILED || ring->pvSqes == MAP_FAILED) {
+        SymTableDisk_ringFree(ring);
+        return NULL;
+    }
+
+    pcSq = ring->pvSq;
+    pcCq = ring->pvCq;
+    ring->puiSqHead = (unsigned int *) (pcSq + params.sq_off.head);
+    ring->puiSqTail = (unsigned int *) (pcSq + params.sq_off.tail);
+    ring->puiSqMask = (unsigned int *) (pcSq + params.sq_off.ring_mask);
+    ring->puiSqArray = (unsigned int *) (pcSq + params.sq_off.array);
+    ring->puiCqHead = (unsigned int *) (pcCq + params.cq_off.head);
+    ring->puiCqTail = (unsigned int *) (pcCq + params.cq_off.tail);
+    ring->puiCqMask = (unsigned int *) (pcCq + params.cq_off.ring_mask);
+    ring->pvCqes = pcCq + params.cq_off.cqes;
+    return ring;
+}
+
+
+/* Unmaps the rings of ring and closes it. ring can be NULL. */
+static void SymTableDisk_ringFree(struct uring *ring) {
+    if (!ring) {
+        return;
+    }
+    if (ring->pvSq != MAP_FAILED) {
+        munmap(ring->pvSq, ring->uiSqSize);
+    }
+    if (ring->pvCq != MAP_FAILED) {
+        munmap(ring->pvCq, ring->uiCqSize);
+    }
+    if (ring->pvSqes != MAP_FAILED) {
+        munmap(ring->pvSqes, ring->uiSqesSize);
+    }
+    close(ring->iFd);
+    free(ring);
+}
+
+
+/* Performs the reads of pBatch from uiNext on through the io_uring of
+symtable, keeping up to QUEUE_DEPTH of them in flight, and handles each one
+when it completes. A read that fails or returns fewer bytes, e.g. because
+the kernel does not support IORING_OP_READ, is repeated with pread. If
+io_uring_enter fails, io_uring is no longer used for symtable: the reads in
+flight are waited for and the others are left to the caller.
+
+Returns: the first read that was not submitted */
+static unsigned int SymTableDisk_ringRun(struct SymTableDisk *symtable, struct batch *pBatch,
+        unsigned int uiNext) {
+    struct uring *ring;
+    struct io_uring_sqe *sqe;
+    struct io_uring_cqe *cqe;
+    struct request *req;
+    unsigned int ui, uiTail, uiHead, uiIdx, uiFlight, uiBack;
+    int iOk;
+
+    ring = symtable->ring;
+    uiFlight = 0U;
+    while (uiFlight || (uiNext < pBatch->uiRequests && !symtable->iNoRing)) {
+        /* fill the submission ring */
+        uiTail = *ring->puiSqTail;
+        while (!symtable->iNoRing && uiNext < pBatch->uiRequests && uiFlight < QUEUE_DEPTH) {
+            req = &pBatch->requests[uiNext++];
+            req->res = malloc(sizeof(struct resident) + req->bind->uiSize);
+            assert(req->res);
+            uiIdx = uiTail & *ring->puiSqMask;
+            sqe = (struct io_uring_sqe *) ring->pvSqes + uiIdx;
+            memset(sqe, 0, sizeof(struct io_uring_sqe));
+            sqe->opcode = IORING_OP_READ;
+            sqe->fd = symtable->iFd;
+            sqe->off = req->bind->offset;
+            sqe->addr = (unsigned long) (req->res + 1);
+            sqe->len = req->bind->uiSize;
+            sqe->user_data = (unsigned long) req;
+            ring->puiSqArray[uiIdx] = uiIdx;
+            uiTail++;
+            uiFlight++;
+        }
+        __atomic_store_n(ring->puiSqTail, uiTail, __ATOMIC_RELEASE);
+
+        /* submit every entry the kernel has not consumed yet and wait for
+        at least one completion */
+        uiHead = __atomic_load_n(ring->puiSqHead, __ATOMIC_ACQUIRE);
+        if (syscall(__NR_io_uring_enter, ring->iFd, uiTail - uiHead, 1U, IORING_ENTER_GETEVENTS, NULL, 0) < 0 &&
+                errno != EINTR) {
+            if (symtable->iNoRing) {
+                break;
+            }
+            symtable->iNoRing = 1;
+            uiHead = __atomic_load_n(ring->puiSqHead, __ATOMIC_ACQUIRE);
+            uiBack = uiTail - uiHead;
+            for (ui = 0U; ui < uiBack; ui++) {
+                free(pBatch->requests[uiNext - uiBack + ui].res);
+                pBatch->requests[uiNext - uiBack + ui].res = NULL;
+            }
+            uiNext -= uiBack;
+            uiFlight -= uiBack;
+            __atomic_store_n(ring->puiSqTail, uiHead, __ATOMIC_RELEASE);
+        }
+
+        /* handle the completions */
+        uiHead = *ring->puiCqHead;
+        while (uiHead != __atomic_load_n(ring->puiCqTail, __ATOMIC_ACQUIRE)) {
+            cqe = (struct io_uring_cqe *) ring->pvCqes + (uiHead & *ring->puiCqMask);
+            req = (struct request *) (unsigned long) cqe->user_data;
+            iOk = cqe->res == (int) req->bind->uiSize ||
+                SymTableDisk_read(symtable->iFd, (char *) (req->res + 1), req->bind->uiSize, req->bind->offset);
+            uiHead++;
+            __atomic_store_n(ring->puiCqHead, uiHead, __ATOMIC_RELEASE);
+            SymTableDisk_complete(symtable, pBatch, req, iOk);
+            req->res = NULL;
+            uiFlight--;
+        }
+    }
+
+    /* io_uring_enter failed while reads were in flight. Their memory may
+    still be written by the kernel, so it is not reused and the reads are
+    repeated with pread. */
+    for (ui = 0U; uiFlight && ui < uiNext; ui++) {
+        req = &pBatch->requests[ui];
+        if (req->res) {
+            req->res = malloc(sizeof(struct resident) + req->bind->uiSize);
+            assert(req->res);
+            SymTableDisk_complete(symtable, pBatch, req,
+                SymTableDisk_readRecord(symtable, req->bind, (char *) (req->res + 1)));
+            req->res = NULL;
+            uiFlight--;
+        }
+    }
+    return uiNext;
+}
+#else
+static struct uring *SymTableDisk_ringNew(void) {
+    return NULL;
+}
+
+static void SymTableDisk_ringFree(struct uring *ring) {
+}
+
+static unsigned int SymTableDisk_ringRun(struct SymTableDisk *symtable, struct batch *pBatch,
+        unsigned int uiNext) {
+    return uiNext;
+}
+#endif
@@ -0,0 +1,153 @@
+/* Library for creating and using Symbol tables that keep their bindings on
+disk, for sets of keys and values larger than the available memory.
+
+Keys and values are stored in a log file. Only a compact index and the
+recently used bindings, up to a memory budget, are kept in memory. Values
+are copied into the table, so they are given as bytes with their size. */
+
+#ifndef SYMTABLEDISK_INCLUDE
+#define SYMTABLEDISK_INCLUDE
+
+#include <stdio.h>
+
+typedef void* SymTableDisk_T;
+
+
+/* Creates a SymTableDisk struct with no bindings that stores them in a new
+file at pcPath. An existing file at pcPath is replaced. The file is removed
+from its directory immediately, so it disappears when the table is freed or
+the program exits.
+
+Asserts:
+1) if pcPath is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* pcPath: path of the file
+* uiMaxMemory: bytes of recently used bindings to keep in memory, in
+addition to the index
+
+Returns: a SymTableDisk_T type or NULL if the file could not be created */
+SymTableDisk_T SymTableDisk_new(const char *pcPath, size_t uiMaxMemory);
+
+
+/* Frees all memory used by oSymTable and closes its file.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type */
+void SymTableDisk_free(SymTableDisk_T oSymTable);
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type */
+unsigned int SymTableDisk_getLength(SymTableDisk_T oSymTable);
+
+
+/* Creates a new binding for oSymTable from a given pcKey and a copy of the
+uiSize bytes at pvValue. If pcKey exists, its value is replaced.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if pvValue is not NULL when uiSize is not 0 at runtime.
+3) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: the value
+* uiSize: size of the value in bytes
+
+Returns: 1 on success, 0 if the file could not be read or written. In that
+case oSymTable is not modified. */
+int SymTableDisk_put(SymTableDisk_T oSymTable, const char *pcKey, const void *pvValue, size_t uiSize);
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found, -1 if
+the file could not be read */
+int SymTableDisk_remove(SymTableDisk_T oSymTable, const char *pcKey);
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 if it is not found, -1 if the file could not
+be read */
+int SymTableDisk_contains(SymTableDisk_T oSymTable, const char *pcKey);
+
+
+/* Finds in oSymTable a binding with key equal to pcKey. Its value is read
+from the file if it is not in memory.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pcKey: a character array (key). Must be null terminated.
+* puiSize: set to the size of the value in bytes. Can be NULL.
+
+Returns: a pointer to the value, aligned to 8 bytes, or NULL if such binding
+was not found or the file could not be read. The value may be moved or
+freed by the next call on oSymTable. */
+const void* SymTableDisk_get(SymTableDisk_T oSymTable, const char *pcKey, size_t *puiSize);
+
+
+/* Looks up the uiCount keys of ppcKeys in oSymTable and passes each value to
+pfDone as soon as it is available: first the values that are in memory,
+then the others as their reads complete. Up to 256 reads are in flight at
+the same time, submitted through io_uring where the kernel supports it, or
+else done one after the other with pread.
+
+Asserts:
+1) if oSymTable, ppcKeys and pfDone are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* ppcKeys: array of keys. Each must be null terminated.
+* uiCount: number of keys
+* pfDone: function that gets the index of a key in ppcKeys, the value, or
+NULL if the key was not found or its record could not be read, and the size
+of the value. The value is only valid during the call. pfDone must not
+modify oSymTable.
+* pvExtra: a pointer to any value. Used by pfDone.
+
+Returns: 1 on success, 0 if the file could not be read for some keys */
+int SymTableDisk_getBatch(SymTableDisk_T oSymTable, const char **ppcKeys, unsigned int uiCount,
+        void (*pfDone)(unsigned int uiIndex, const void *pvValue, size_t uiSize, void *pvExtra),
+        const void *pvExtra);
+
+
+/* Applies function pfApply to every binding in oSymTable. Values that are
+not in memory are read from the file. pfApply must not modify oSymTable.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableDisk_T type
+* pfApply: function to apply. It gets the key, the value and its size.
+* pvExtra: a pointer to any value. Used by pfApply.
+
+Returns: 1 on success, 0 if the file could not be read. pfApply has then
+been applied to some of the bindings. */
+int SymTableDisk_map(SymTableDisk_T oSymTable,
+        void (*pfApply)(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra),
+        const void *pvExtra);
+
+#endif
@@ -0,0 +1,465 @@
+/* Library for creating and using Symbol tables that grow one page at a time.
+
+Extendible hashing based implementation. The directory has 2^uiDepth
+entries and the entry of a key is given by the first uiDepth bits of its
+hash code. Each page has its own depth, at most the depth of the directory:
+a page of depth d holds the keys whose codes start with the same d bits, and
+the 2^(uiDepth - d) entries of the directory for these bits point to it.
+
+A full page is split in two pages of depth d + 1 by the next bit of the
+codes of its keys, and only the entries of the directory for that page
+change. When a page with the depth of the directory is split, the directory
+doubles first, which copies pointers but moves no binding. Pages are not
+merged when bindings are removed. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "symtableext.h"
+
+#define HASH_MULTIPLIER 65599
+#define HASH_BITS 32
+#define PAGE_SIZE 64        /* bindings per page */
+#define MAX_DEPTH 24        /* maximum depth of the directory */
+
+
+/* Struct that represents a binding. The key is stored right after the
+struct. */
+struct ebind {
+    void *value;
+    char *key;
+};
+
+
+/* Struct that represents a page.
+uiDepth: number of leading bits of the hash code shared by all its keys
+uiCount: number of bindings
+overflow: NULL unless the page has MAX_DEPTH depth and more than PAGE_SIZE
+keys with the same leading bits. The other bindings are then in this chain
+of pages.
+auiCodes: hash code of each binding, so that a lookup scans them without
+reading the bindings
+binds: the bindings */
+struct page {
+    unsigned int uiDepth;
+    unsigned int uiCount;
+    struct page *overflow;
+    unsigned int auiCodes[PAGE_SIZE];
+    struct ebind *binds[PAGE_SIZE];
+};
+
+
+/* Struct that represents a symbol table.
+uiBindings: number of bindings
+uiDepth: depth of the directory, which has 2^uiDepth entries
+uiPages: number of pages
+directory: the page of each entry
+uiBytes: number of bytes allocated by the table */
+struct SymTableExt {
+    unsigned int uiBindings;
+    unsigned int uiDepth;
+    unsigned int uiPages;
+    struct page **directory;
+    size_t uiBytes;
+};
+
+
+static unsigned int SymTableExt_hash(const char *pcKey);
+static unsigned int SymTableExt_entry(unsigned int uiCode, unsigned int uiDepth);
+static struct page *SymTableExt_find(struct SymTableExt *symtable, const char *pcKey, unsigned int uiCode,
+        unsigned int *puiIndex);
+static struct page *SymTableExt_newPage(struct SymTableExt *symtable, unsigned int uiDepth);
+static void SymTableExt_grow(struct SymTableExt *symtable);
+static void SymTableExt_split(struct SymTableExt *symtable, unsigned int uiCode);
+
+
+/* Computes the hash code for pcKey. The code of SymTable_hashKey is mixed
+by a multiplication, because the directory uses its leading bits and these
+are 0 for short keys.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+static unsigned int SymTableExt_hash(const char *pcKey) {
+    size_t ui;
+    unsigned int uiHash;
+
+    uiHash = 0U;
+    for (ui = 0U; pcKey[ui] != '\0'; ui++) {
+        uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+    }
+    return (unsigned int) ((uiHash * 0x9E3779B1UL) & 0xFFFFFFFFUL);
+}
+
+
+/* Returns the entry of the directory for hash code uiCode: its first
+uiDepth bits.
+
+Parameters:
+* uiCode: a hash code
+* uiDepth: depth of the directory */
+static unsigned int SymTableExt_entry(unsigned int uiCode, unsigned int uiDepth) {
+    return uiDepth ? uiCode >> (HASH_BITS - uiDepth) : 0U;
+}
+
+
+/* Finds the binding with key equal to pcKey.
+
+Parameters:
+* symtable: the table
+* pcKey: a character array (key). Must be null terminated.
+* uiCode: hash code of pcKey
+* puiIndex: set to the position of the binding in its page
+
+Returns: the page of the binding or NULL if such binding was not found */
+static struct page *SymTableExt_find(struct SymTableExt *symtable, const char *pcKey, unsigned int uiCode,
+        unsigned int *puiIndex) {
+    struct page *page;
+    unsigned int ui;
+
+    for (page = symtable->directory[SymTableExt_entry(uiCode, symtable->uiDepth)]; page;
+            page = page->overflow) {
+        for (ui = 0U; ui < page->uiCount; ui++) {
+            if (page->auiCodes[ui] == uiCode && !strcmp(page->binds[ui]->key, pcKey)) {
+                *puiIndex = ui;
+                return page;
+            }
+        }
+    }
+    return NULL;
+}
+
+
+/* Creates an empty page of depth uiDepth for symtable.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct page *SymTableExt_newPage(struct SymTableExt *symtable, unsigned int uiDepth) {
+    struct page *page;
+
+    page = malloc(sizeof(struct page));
+    assert(page);
+    page->uiDepth = uiDepth;
+    page->uiCount = 0U;
+    page->overflow = NULL;
+    symtable->uiPages++;
+    symtable->uiBytes += sizeof(struct page);
+    return page;
+}
+
+
+/* Doubles the directory of symtable. Entry i of the directory becomes
+entries 2i and 2i + 1, which point to the same page.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static void SymTableExt_grow(struct SymTableExt *symtable) {
+    struct page **directory;
+    unsigned int ui, uiEntries;
+
+    uiEntries = 1U << symtable->uiDepth;
+    directory = malloc(2 * uiEntries * sizeof(struct page *));
+    assert(directory);
+    for (ui = 0U; ui < 2 * uiEntries; ui++) {
+        directory[ui] = symtable->directory[ui >> 1];
+    }
+    free(symtable->directory);
+    symtable->directory = directory;
+    symtable->uiDepth++;
+    symtable->uiBytes += uiEntries * sizeof(struct page *);
+}
+
+
+/* Splits the page of hash code uiCode in two pages of the next depth: the
+bindings whose codes have the next bit set move to a new page, and the upper
+half of the entries of the directory for the page point to the new page.
+
+Parameters:
+* symtable: the table
+* uiCode: a hash code of a key of the page */
+static void SymTableExt_split(struct SymTableExt *symtable, unsigned int uiCode) {
+    struct page *page, *new_page;
+    unsigned int ui, uiBit, uiEntries, uiFirst;
+
+    page = symtable->directory[SymTableExt_entry(uiCode, symtable->uiDepth)];
+    if (page->uiDepth == symtable->uiDepth) {
+        SymTableExt_grow(symtable);
+    }
+    page->uiDepth++;
+    new_page = SymTableExt_newPage(symtable, page->uiDepth);
+
+    uiBit = 1U << (HASH_BITS - page->uiDepth);
+    ui = 0U;
+    while (ui < page->uiCount) {
+        if (!(page->auiCodes[ui] & uiBit)) {
+            ui++;
+            continue;
+        }
+        new_page->auiCodes[new_page->uiCount] = page->auiCodes[ui];
+        new_page->binds[new_page->uiCount] = page->binds[ui];
+        new_page->uiCount++;
+        page->uiCount--;
+        page->auiCodes[ui] = page->auiCodes[page->uiCount];
+        page->binds[ui] = page->binds[page->uiCount];
+    }
+
+    /* the page had 2 * uiEntries entries, starting at uiFirst */
+    uiEntries = 1U << (symtable->uiDepth - page->uiDepth);
+    uiFirst = SymTableExt_entry(uiCode, symtable->uiDepth) & ~(2 * uiEntries - 1);
+    for (ui = uiFirst + uiEntries; ui < uiFirst + 2 * uiEntries; ui++) {
+        symtable->directory[ui] = new_page;
+    }
+}
+
+
+/* Creates a SymTableExt struct with no bindings and a single page.
+
+Asserts: if memory was allocated succesfully at runtime. */
+SymTableExt_T SymTableExt_new(void) {
+    struct SymTableExt *symtable;
+
+    symtable = malloc(sizeof(struct SymTableExt));
+    assert(symtable);
+    symtable->directory = malloc(sizeof(struct page *));
+    assert(symtable->directory);
+    symtable->uiBindings = 0U;
+    symtable->uiDepth = 0U;
+    symtable->uiPages = 0U;
+    symtable->uiBytes = sizeof(struct SymTableExt) + sizeof(struct page *);
+    symtable->directory[0] = SymTableExt_newPage(symtable, 0U);
+    return (SymTableExt_T) symtable;
+}
+
+
+/* Frees all memory used by oSymTable.
+
+Parameters:
+* oSymTable: a SymTableExt_T type */
+void SymTableExt_free(SymTableExt_T oSymTable) {
+    struct SymTableExt *symtable;
+    struct page *page, *next;
+    unsigned int ui, uiEntry, uiNext;
+
+    symtable = oSymTable;
+    if (!symtable) {
+        return;
+    }
+
+    /* the entries of a page are consecutive, each page is visited once */
+    for (uiEntry = 0U; uiEntry < 1U << symtable->uiDepth; uiEntry = uiNext) {
+        uiNext = uiEntry + (1U << (symtable->uiDepth - symtable->directory[uiEntry]->uiDepth));
+        for (page = symtable->directory[uiEntry]; page; page = next) {
+            next = page->overflow;
+            for (ui = 0U; ui < page->uiCount; ui++) {
+                free(page->binds[ui]);
+            }
+            free(page);
+        }
+    }
+    free(symtable->directory);
+    free(symtable);
+}
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type */
+unsigned int SymTableExt_getLength(SymTableExt_T oSymTable) {
+    assert(oSymTable);
+    return ((struct SymTableExt *) oSymTable)->uiBindings;
+}
+
+
+/* Creates a new binding for oSymTable from a given pcKey and pvValue. If
+pcKey exists, its value is updated. While the page of pcKey is full, it is
+split. A page that already has MAX_DEPTH depth gets an overflow page
+instead.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value */
+void SymTableExt_put(SymTableExt_T oSymTable, const char *pcKey, const void *pvValue) {
+    struct SymTableExt *symtable;
+    struct page *page;
+    struct ebind *new_bind;
+    unsigned int uiCode, uiIndex;
+    size_t uiLen;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    uiCode = SymTableExt_hash(pcKey);
+    page = SymTableExt_find(symtable, pcKey, uiCode, &uiIndex);
+    if (page) {
+        page->binds[uiIndex]->value = (void *) pvValue;
+        return;
+    }
+
+    for (;;) {
+        page = symtable->directory[SymTableExt_entry(uiCode, symtable->uiDepth)];
+        if (page->uiCount < PAGE_SIZE) {
+            break;
+        }
+        if (page->uiDepth == MAX_DEPTH) {
+            while (page->uiCount == PAGE_SIZE && page->overflow) {
+                page = page->overflow;
+            }
+            if (page->uiCount == PAGE_SIZE) {
+                page->overflow = SymTableExt_newPage(symtable, MAX_DEPTH);
+                page = page->overflow;
+            }
+            break;
+        }
+        SymTableExt_split(symtable, uiCode);
+    }
+
+    uiLen = strlen(pcKey) + 1;
+    new_bind = malloc(sizeof(struct ebind) + uiLen);
+    assert(new_bind);
+    new_bind->key = (char *) (new_bind + 1);
+    memcpy(new_bind->key, pcKey, uiLen);
+    new_bind->value = (void *) pvValue;
+    page->auiCodes[page->uiCount] = uiCode;
+    page->binds[page->uiCount] = new_bind;
+    page->uiCount++;
+    symtable->uiBindings++;
+    symtable->uiBytes += sizeof(struct ebind) + uiLen;
+}
+
+
+/* Removes a binding with key equal to pcKey. The last binding of its page
+takes its position.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTableExt_remove(SymTableExt_T oSymTable, const char *pcKey) {
+    struct SymTableExt *symtable;
+    struct page *page;
+    unsigned int uiIndex;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    page = SymTableExt_find(symtable, pcKey, SymTableExt_hash(pcKey), &uiIndex);
+    if (!page) {
+        return 0;
+    }
+    symtable->uiBytes -= sizeof(struct ebind) + strlen(page->binds[uiIndex]->key) + 1;
+    free(page->binds[uiIndex]);
+    page->uiCount--;
+    page->auiCodes[uiIndex] = page->auiCodes[page->uiCount];
+    page->binds[uiIndex] = page->binds[page->uiCount];
+    symtable->uiBindings--;
+    return 1;
+}
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableExt_contains(SymTableExt_T oSymTable, const char *pcKey) {
+    unsigned int uiIndex;
+
+    assert(oSymTable);
+    assert(pcKey);
+    return SymTableExt_find(oSymTable, pcKey, SymTableExt_hash(pcKey), &uiIndex) != NULL;
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTableExt_get(SymTableExt_T oSymTable, const char *pcKey) {
+    struct page *page;
+    unsigned int uiIndex;
+
+    assert(oSymTable);
+    assert(pcKey);
+    page = SymTableExt_find(oSymTable, pcKey, SymTableExt_hash(pcKey), &uiIndex);
+    return page ? page->binds[uiIndex]->value : NULL;
+}
+
+
+/* Applies function pfApply to every binding in oSymTable, one page after
+the other.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableExt_map(SymTableExt_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTableExt *symtable;
+    struct page *page;
+    unsigned int ui, uiEntry;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pfApply);
+
+    /* the entries of a page are consecutive, each page is visited once */
+    for (uiEntry = 0U; uiEntry < 1U << symtable->uiDepth;
+            uiEntry += 1U << (symtable->uiDepth - symtable->directory[uiEntry]->uiDepth)) {
+        for (page = symtable->directory[uiEntry]; page; page = page->overflow) {
+            for (ui = 0U; ui < page->uiCount; ui++) {
+                (*pfApply)(page->binds[ui]->key, page->binds[ui]->value, (void *) pvExtra);
+            }
+        }
+    }
+}
+
+
+/* Returns the number of bytes allocated by oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type */
+size_t SymTableExt_getBytes(SymTableExt_T oSymTable) {
+    assert(oSymTable);
+    return ((struct SymTableExt *) oSymTable)->uiBytes;
+}
+
+
+/* Prints basic information about oSymTable:
+1) Depth of the directory and its number of entries.
+2) Number of pages.
+3) Average fraction of a page that is used. */
+void SymTableExt_stats(SymTableExt_T oSymTable) {
+    struct SymTableExt *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    printf("++> Directory depth: %u (%u entries)\n", symtable->uiDepth, 1U << symtable->uiDepth);
+    printf("++> #pages: %u\n", symtable->uiPages);
+    printf("++> Average page fill: %f\n", symtable->uiBindings / (float) (symtable->uiPages * PAGE_SIZE));
+}
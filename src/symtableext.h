@@ -0,0 +1,120 @@
+/* Library for creating and using Symbol tables that grow one page at a time.
+
+Bindings are stored in fixed-size pages, and a directory indexed by the
+first bits of the hash of a key gives the page of the key. A full page is
+split in two without touching the others, so a table never rehashes all of
+its bindings at once. */
+
+#ifndef SYMTABLEEXT_INCLUDE
+#define SYMTABLEEXT_INCLUDE
+
+#include <stdio.h>
+
+typedef void* SymTableExt_T;
+
+
+/* Creates a SymTableExt struct with no bindings and a single page.
+
+Asserts: if memory was allocated succesfully at runtime. */
+SymTableExt_T SymTableExt_new(void);
+
+
+/* Frees all memory used by oSymTable.
+
+Parameters:
+* oSymTable: a SymTableExt_T type */
+void SymTableExt_free(SymTableExt_T oSymTable);
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type */
+unsigned int SymTableExt_getLength(SymTableExt_T oSymTable);
+
+
+/* Creates a new binding for oSymTable from a given pcKey and pvValue. If
+pcKey exists, its value is updated.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value */
+void SymTableExt_put(SymTableExt_T oSymTable, const char *pcKey, const void *pvValue);
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTableExt_remove(SymTableExt_T oSymTable, const char *pcKey);
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableExt_contains(SymTableExt_T oSymTable, const char *pcKey);
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTableExt_get(SymTableExt_T oSymTable, const char *pcKey);
+
+
+/* Applies function pfApply to every binding in oSymTable, one page after
+the other.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableExt_map(SymTableExt_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra);
+
+
+/* Returns the number of bytes allocated by oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type */
+size_t SymTableExt_getBytes(SymTableExt_T oSymTable);
+
+
+/* Prints basic information about oSymTable: the depth of the directory,
+the number of pages and how full they are.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableExt_T type */
+void SymTableExt_stats(SymTableExt_T oSymTable);
+
+#endif
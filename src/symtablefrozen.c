@@ -0,0 +1,501 @@
+/* Library for creating and using read-only Symbol tables with compressed
+keys.
+
+Keys are sorted and stored in blocks of BLOCK_KEYS keys with front coding:
+each key is stored as the length of the prefix it shares with the previous
+key of its block, the length of the rest and the rest. The first key of a
+block shares nothing, so any key is decoded from the start of its block.
+
+An open addressing hash array maps each key to its position in the sorted
+order, with an 8-bit tag of the hash code so that a lookup almost never
+decodes a block for a different key. A lookup compares pcKey with the key
+while it decodes the block, without copying the key. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "symtablefrozen.h"
+
+#define HASH_MULTIPLIER 65599
+#define BLOCK_KEYS 16   /* keys per front coded block */
+#define MIN_SLOTS 8
+
+
+/* Struct that represents a frozen symbol table.
+uiBindings: number of bindings
+uiSlotMask: number of slots of the hash array minus 1, a power of 2 minus 1
+puiSlots: position + 1 of the key of each slot in the sorted order, 0 if
+the slot is empty
+pucTags: tag of the hash code of the key of each slot
+puiBlocks: offset of each block in pucKeys
+pucKeys, uiKeyBytes: the front coded keys
+ppvValues: the values, in the sorted order of their keys
+uiMaxKeyLen: length of the longest key */
+struct SymTableFrozen {
+    unsigned int uiBindings;
+    unsigned int uiSlotMask;
+    unsigned int *puiSlots;
+    unsigned char *pucTags;
+    size_t *puiBlocks;
+    unsigned char *pucKeys;
+    size_t uiKeyBytes;
+    void **ppvValues;
+    size_t uiMaxKeyLen;
+};
+
+
+/* Struct that represents an input binding of SymTableFrozen_new while the
+keys are sorted. */
+struct entry {
+    const char *key;
+    unsigned int uiIndex;
+};
+
+
+static unsigned int SymTableFrozen_hashKey(const char *pcKey);
+static unsigned int SymTableFrozen_slot(unsigned int uiCode, unsigned int uiMask);
+static unsigned char SymTableFrozen_tag(unsigned int uiCode);
+static size_t SymTableFrozen_putNumber(unsigned char *pucDest, size_t uiNumber);
+static const unsigned char *SymTableFrozen_getNumber(const unsigned char *pucSrc, size_t *puiNumber);
+static int SymTableFrozen_match(struct SymTableFrozen *symtable, unsigned int uiPos, const char *pcKey);
+static void *SymTableFrozen_find(struct SymTableFrozen *symtable, const char *pcKey, int *piFound);
+static int SymTableFrozen_compare(const void *a, const void *b);
+static void SymTableFrozen_collect(const char *pcKey, void *pvValue, void *pvExtra);
+
+
+/* Computes the hash code for pcKey, the same as SymTable_hashKey.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+static unsigned int SymTableFrozen_hashKey(const char *pcKey) {
+    size_t ui;
+    unsigned int uiHash;
+
+    uiHash = 0U;
+    for (ui = 0U; pcKey[ui] != '\0'; ui++) {
+        uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+    }
+    return uiHash;
+}
+
+
+/* Returns the first slot to probe for a key with hash code uiCode in a hash
+array with uiMask + 1 slots. The code is mixed first because the number of
+slots is a power of 2. */
+static unsigned int SymTableFrozen_slot(unsigned int uiCode, unsigned int uiMask) {
+    return (unsigned int) (((uiCode * 0x9E3779B1UL) & 0xFFFFFFFFUL) >> 8) & uiMask;
+}
+
+
+/* Returns the tag of a hash code, made of other bits than the slot. */
+static unsigned char SymTableFrozen_tag(unsigned int uiCode) {
+    return (unsigned char) (uiCode ^ (uiCode >> 8) ^ (uiCode >> 16) ^ (uiCode >> 24));
+}
+
+
+/* Writes uiNumber to pucDest, 7 bits per byte with the high bit set on all
+bytes but the last. pucDest can be NULL.
+
+Returns: the number of bytes */
+static size_t SymTableFrozen_putNumber(unsigned char *pucDest, size_t uiNumber) {
+    size_t uiBytes;
+
+    for (uiBytes = 1U; uiNumber >= 0x80U; uiBytes++) {
+        if (pucDest) {
+            *pucDest++ = (unsigned char) (uiNumber | 0x80U);
+        }
+        uiNumber >>= 7;
+    }
+    if (pucDest) {
+        *pucDest = (unsigned char) uiNumber;
+    }
+    return uiBytes;
+}
+
+
+/* Reads a number written by SymTableFrozen_putNumber from pucSrc into
+*puiNumber.
+
+Returns: the first byte after the number */
+static const unsigned char *SymTableFrozen_getNumber(const unsigned char *pucSrc, size_t *puiNumber) {
+    size_t uiNumber;
+    int iShift;
+
+    uiNumber = 0U;
+    for (iShift = 0; *pucSrc & 0x80U; iShift += 7) {
+        uiNumber |= (size_t) (*pucSrc++ & 0x7FU) << iShift;
+    }
+    *puiNumber = uiNumber | (size_t) *pucSrc << iShift;
+    return pucSrc + 1;
+}
+
+
+/* Checks whether the key at position uiPos of the sorted order is equal to
+pcKey. The block of the key is decoded up to it while the length of the
+prefix that each key shares with pcKey is kept: a key that shares at most
+that many bytes with the previous key matches pcKey up to them, and a key
+that shares more still differs from pcKey where the previous key did.
+
+Returns: 1 if the keys are equal, 0 otherwise */
+static int SymTableFrozen_match(struct SymTableFrozen *symtable, unsigned int uiPos, const char *pcKey) {
+    const unsigned char *pucKey;
+    size_t uiShared, uiSuffix, uiMatch;
+    unsigned int ui;
+
+    pucKey = symtable->pucKeys + symtable->puiBlocks[uiPos / BLOCK_KEYS];
+    uiMatch = 0U;
+    for (ui = uiPos - uiPos % BLOCK_KEYS; ; ui++) {
+        pucKey = SymTableFrozen_getNumber(pucKey, &uiShared);
+        pucKey = SymTableFrozen_getNumber(pucKey, &uiSuffix);
+        if (uiShared <= uiMatch) {
+            uiMatch = uiShared;
+            while (uiMatch < uiShared + uiSuffix &&
+                    (unsigned char) pcKey[uiMatch] == pucKey[uiMatch - uiShared]) {
+                uiMatch++;
+            }
+        }
+        if (ui == uiPos) {
+            return uiMatch == uiShared + uiSuffix && pcKey[uiMatch] == '\0';
+        }
+        pucKey += uiSuffix;
+    }
+}
+
+
+/* Finds in symtable a binding with key equal to pcKey.
+
+Parameters:
+* symtable: the table
+* pcKey: a character array (key). Must be null terminated.
+* piFound: set to 1 if the binding is found, 0 otherwise
+
+Returns: the value or NULL if such binding was not found */
+static void *SymTableFrozen_find(struct SymTableFrozen *symtable, const char *pcKey, int *piFound) {
+    unsigned int uiCode, uiSlot;
+    unsigned char ucTag;
+
+    uiCode = SymTableFrozen_hashKey(pcKey);
+    ucTag = SymTableFrozen_tag(uiCode);
+    for (uiSlot = SymTableFrozen_slot(uiCode, symtable->uiSlotMask); symtable->puiSlots[uiSlot];
+            uiSlot = (uiSlot + 1) & symtable->uiSlotMask) {
+        if (symtable->pucTags[uiSlot] == ucTag &&
+                SymTableFrozen_match(symtable, symtable->puiSlots[uiSlot] - 1, pcKey)) {
+            *piFound = 1;
+            return symtable->ppvValues[symtable->puiSlots[uiSlot] - 1];
+        }
+    }
+    *piFound = 0;
+    return NULL;
+}
+
+
+/* Comparison function of qsort for entries: by key, then by input position. */
+static int SymTableFrozen_compare(const void *a, const void *b) {
+    const struct entry *x, *y;
+    int iCmp;
+
+    x = a;
+    y = b;
+    iCmp = strcmp(x->key, y->key);
+    if (iCmp) {
+        return iCmp;
+    }
+    return (x->uiIndex > y->uiIndex) - (x->uiIndex < y->uiIndex);
+}
+
+
+/* Creates a SymTableFrozen struct with the bindings of the uiCount keys in
+ppcKeys and the values in ppvValues. If a key is repeated, the last value
+is used, like SymTable_put.
+
+Asserts:
+1) if ppcKeys and each key are not NULL at runtime.
+2) if ppvValues is not NULL when uiCount is not 0 at runtime.
+3) if memory was allocated succesfully at runtime.
+
+Parameters:
+* ppcKeys: array of keys. Each must be null terminated.
+* ppvValues: array of values, ppvValues[i] is the value of ppcKeys[i]
+* uiCount: number of keys
+
+Returns: a SymTableFrozen_T type */
+SymTableFrozen_T SymTableFrozen_new(const char **ppcKeys, const void **ppvValues, unsigned int uiCount) {
+    struct SymTableFrozen *symtable;
+    struct entry *entries;
+    unsigned int ui, uiCode, uiSlot, uiSlots, uiBlocks;
+    size_t uiLen, uiShared, uiOffset;
+    const char *pcPrev, *pcKey;
+
+    assert(ppcKeys);
+    assert(ppvValues || !uiCount);
+
+    /* sort, and keep the last binding of each key */
+    entries = malloc((uiCount + 1) * sizeof(struct entry));
+    assert(entries);
+    for (ui = 0U; ui < uiCount; ui++) {
+        assert(ppcKeys[ui]);
+        entries[ui].key = ppcKeys[ui];
+        entries[ui].uiIndex = ui;
+    }
+    qsort(entries, uiCount, sizeof(struct entry), SymTableFrozen_compare);
+    symtable = malloc(sizeof(struct SymTableFrozen));
+    assert(symtable);
+    symtable->uiBindings = 0U;
+    for (ui = 0U; ui < uiCount; ui++) {
+        if (ui + 1 < uiCount && !strcmp(entries[ui].key, entries[ui + 1].key)) {
+            continue;
+        }
+        entries[symtable->uiBindings++] = entries[ui];
+    }
+
+    /* size of the front coded keys */
+    uiBlocks = (symtable->uiBindings + BLOCK_KEYS - 1) / BLOCK_KEYS;
+    symtable->puiBlocks = malloc((uiBlocks + 1) * sizeof(size_t));
+    symtable->ppvValues = malloc((symtable->uiBindings + 1) * sizeof(void *));
+    assert(symtable->puiBlocks && symtable->ppvValues);
+    symtable->uiKeyBytes = 0U;
+    symtable->uiMaxKeyLen = 0U;
+    pcPrev = "";
+    for (ui = 0U; ui < symtable->uiBindings; ui++) {
+        pcKey = entries[ui].key;
+        uiLen = strlen(pcKey);
+        uiShared = 0U;
+        if (ui % BLOCK_KEYS) {
+            while (pcKey[uiShared] && pcKey[uiShared] == pcPrev[uiShared]) {
+                uiShared++;
+            }
+        }
+        symtable->uiKeyBytes += SymTableFrozen_putNumber(NULL, uiShared) +
+            SymTableFrozen_putNumber(NULL, uiLen - uiShared) + uiLen - uiShared;
+        if (uiLen > symtable->uiMaxKeyLen) {
+            symtable->uiMaxKeyLen = uiLen;
+        }
+        pcPrev = pcKey;
+    }
+
+    /* the blocks */
+    symtable->pucKeys = malloc(symtable->uiKeyBytes + 1);
+    assert(symtable->pucKeys);
+    uiOffset = 0U;
+    pcPrev = "";
+    for (ui = 0U; ui < symtable->uiBindings; ui++) {
+        pcKey = entries[ui].key;
+        uiLen = strlen(pcKey);
+        uiShared = 0U;
+        if (ui % BLOCK_KEYS) {
+            while (pcKey[uiShared] && pcKey[uiShared] == pcPrev[uiShared]) {
+                uiShared++;
+            }
+        }
+        else {
+            symtable->puiBlocks[ui / BLOCK_KEYS] = uiOffset;
+        }
+        uiOffset += SymTableFrozen_putNumber(symtable->pucKeys + uiOffset, uiShared);
+        uiOffset += SymTableFrozen_putNumber(symtable->pucKeys + uiOffset, uiLen - uiShared);
+        memcpy(symtable->pucKeys + uiOffset, pcKey + uiShared, uiLen - uiShared);
+        uiOffset += uiLen - uiShared;
+        symtable->ppvValues[ui] = (void *) ppvValues[entries[ui].uiIndex];
+        pcPrev = pcKey;
+    }
+
+    /* the hash array, at most 3/4 full */
+    for (uiSlots = MIN_SLOTS; uiSlots / 4 * 3 <= symtable->uiBindings; uiSlots *= 2) {
+    }
+    symtable->uiSlotMask = uiSlots - 1;
+    symtable->puiSlots = calloc(uiSlots, sizeof(unsigned int));
+    symtable->pucTags = malloc(uiSlots);
+    assert(symtable->puiSlots && symtable->pucTags);
+    for (ui = 0U; ui < symtable->uiBindings; ui++) {
+        uiCode = SymTableFrozen_hashKey(entries[ui].key);
+        uiSlot = SymTableFrozen_slot(uiCode, symtable->uiSlotMask);
+        while (symtable->puiSlots[uiSlot]) {
+            uiSlot = (uiSlot + 1) & symtable->uiSlotMask;
+        }
+        symtable->puiSlots[uiSlot] = ui + 1;
+        symtable->pucTags[uiSlot] = SymTableFrozen_tag(uiCode);
+    }
+
+    free(entries);
+    return (SymTableFrozen_T) symtable;
+}
+
+
+/* Struct that collects the bindings of a SymTable for SymTableFrozen_freeze. */
+struct collect {
+    const char **ppcKeys;
+    const void **ppvValues;
+    unsigned int uiCount;
+};
+
+
+/* Function of SymTable_map that adds a binding to a struct collect. */
+static void SymTableFrozen_collect(const char *pcKey, void *pvValue, void *pvExtra) {
+    struct collect *collect;
+
+    collect = pvExtra;
+    collect->ppcKeys[collect->uiCount] = pcKey;
+    collect->ppvValues[collect->uiCount] = pvValue;
+    collect->uiCount++;
+}
+
+
+/* Creates a SymTableFrozen struct with the bindings of oSymTable. oSymTable
+is not modified.
+
+Asserts:
+1) if oSymTable is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+
+Returns: a SymTableFrozen_T type */
+SymTableFrozen_T SymTableFrozen_freeze(SymTable_T oSymTable) {
+    SymTableFrozen_T oFrozen;
+    struct collect collect;
+    unsigned int uiLength;
+
+    assert(oSymTable);
+    uiLength = SymTable_getLength(oSymTable);
+    collect.ppcKeys = malloc((uiLength + 1) * sizeof(char *));
+    collect.ppvValues = malloc((uiLength + 1) * sizeof(void *));
+    assert(collect.ppcKeys && collect.ppvValues);
+    collect.uiCount = 0U;
+    SymTable_map(oSymTable, SymTableFrozen_collect, &collect);
+
+    oFrozen = SymTableFrozen_new(collect.ppcKeys, collect.ppvValues, collect.uiCount);
+    free(collect.ppcKeys);
+    free(collect.ppvValues);
+    return oFrozen;
+}
+
+
+/* Frees all memory used by oSymTable.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type */
+void SymTableFrozen_free(SymTableFrozen_T oSymTable) {
+    struct SymTableFrozen *symtable;
+
+    symtable = oSymTable;
+    if (!symtable) {
+        return;
+    }
+    free(symtable->puiSlots);
+    free(symtable->pucTags);
+    free(symtable->puiBlocks);
+    free(symtable->pucKeys);
+    free(symtable->ppvValues);
+    free(symtable);
+}
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type */
+unsigned int SymTableFrozen_getLength(SymTableFrozen_T oSymTable) {
+    assert(oSymTable);
+    return ((struct SymTableFrozen *) oSymTable)->uiBindings;
+}
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableFrozen_contains(SymTableFrozen_T oSymTable, const char *pcKey) {
+    int iFound;
+
+    assert(oSymTable);
+    assert(pcKey);
+    SymTableFrozen_find(oSymTable, pcKey, &iFound);
+    return iFound;
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTableFrozen_get(SymTableFrozen_T oSymTable, const char *pcKey) {
+    int iFound;
+
+    assert(oSymTable);
+    assert(pcKey);
+    return SymTableFrozen_find(oSymTable, pcKey, &iFound);
+}
+
+
+/* Applies function pfApply to every binding in oSymTable, in increasing
+order of the keys. The keys are decoded into a buffer one after the other.
+
+Asserts:
+1) if oSymTable and pfApply are not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableFrozen_map(SymTableFrozen_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTableFrozen *symtable;
+    const unsigned char *pucKey;
+    size_t uiShared, uiSuffix;
+    unsigned int ui;
+    char *pcKey;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pfApply);
+
+    pcKey = malloc(symtable->uiMaxKeyLen + 1);
+    assert(pcKey);
+    pucKey = symtable->pucKeys;
+    for (ui = 0U; ui < symtable->uiBindings; ui++) {
+        pucKey = SymTableFrozen_getNumber(pucKey, &uiShared);
+        pucKey = SymTableFrozen_getNumber(pucKey, &uiSuffix);
+        memcpy(pcKey + uiShared, pucKey, uiSuffix);
+        pcKey[uiShared + uiSuffix] = '\0';
+        pucKey += uiSuffix;
+        (*pfApply)(pcKey, symtable->ppvValues[ui], (void *) pvExtra);
+    }
+    free(pcKey);
+}
+
+
+/* Returns the number of bytes allocated by oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type
+* puiKeyBytes: set to the bytes of the compressed keys. Can be NULL. */
+size_t SymTableFrozen_getBytes(SymTableFrozen_T oSymTable, size_t *puiKeyBytes) {
+    struct SymTableFrozen *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+    if (puiKeyBytes) {
+        *puiKeyBytes = symtable->uiKeyBytes;
+    }
+    return sizeof(struct SymTableFrozen) +
+        (symtable->uiSlotMask + 1) * (sizeof(unsigned int) + 1) +
+        (symtable->uiBindings + BLOCK_KEYS - 1) / BLOCK_KEYS * sizeof(size_t) +
+        symtable->uiKeyBytes + symtable->uiBindings * sizeof(void *);
+}
@@ -0,0 +1,114 @@
+/* Library for creating and using read-only Symbol tables with compressed
+keys.
+
+A frozen table is built once from all of its bindings and cannot be
+modified. Keys that share long prefixes, like namespace::class::member,
+take much less memory than in a SymTable. */
+
+#ifndef SYMTABLEFROZEN_INCLUDE
+#define SYMTABLEFROZEN_INCLUDE
+
+#include <stdio.h>
+#include "symtable.h"
+
+typedef void* SymTableFrozen_T;
+
+
+/* Creates a SymTableFrozen struct with the bindings of the uiCount keys in
+ppcKeys and the values in ppvValues. If a key is repeated, the last value
+is used, like SymTable_put.
+
+Asserts:
+1) if ppcKeys and each key are not NULL at runtime.
+2) if ppvValues is not NULL when uiCount is not 0 at runtime.
+3) if memory was allocated succesfully at runtime.
+
+Parameters:
+* ppcKeys: array of keys. Each must be null terminated.
+* ppvValues: array of values, ppvValues[i] is the value of ppcKeys[i]
+* uiCount: number of keys
+
+Returns: a SymTableFrozen_T type */
+SymTableFrozen_T SymTableFrozen_new(const char **ppcKeys, const void **ppvValues, unsigned int uiCount);
+
+
+/* Creates a SymTableFrozen struct with the bindings of oSymTable. oSymTable
+is not modified.
+
+Asserts:
+1) if oSymTable is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+
+Returns: a SymTableFrozen_T type */
+SymTableFrozen_T SymTableFrozen_freeze(SymTable_T oSymTable);
+
+
+/* Frees all memory used by oSymTable.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type */
+void SymTableFrozen_free(SymTableFrozen_T oSymTable);
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type */
+unsigned int SymTableFrozen_getLength(SymTableFrozen_T oSymTable);
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableFrozen_contains(SymTableFrozen_T oSymTable, const char *pcKey);
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTableFrozen_get(SymTableFrozen_T oSymTable, const char *pcKey);
+
+
+/* Applies function pfApply to every binding in oSymTable, in increasing
+order of the keys (as compared by strcmp).
+
+Asserts:
+1) if oSymTable and pfApply are not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableFrozen_map(SymTableFrozen_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra);
+
+
+/* Returns the number of bytes allocated by oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableFrozen_T type
+* puiKeyBytes: set to the bytes of the compressed keys. Can be NULL. */
+size_t SymTableFrozen_getBytes(SymTableFrozen_T oSymTable, size_t *puiKeyBytes);
+
+#endif
@@ -0,0 +1,627 @@
+/* Library for creating and using persistent Symbol tables.
+
+Hash array mapped trie (HAMT) based implementation. Each level of the trie
+consumes HAMT_BITS bits of the hash of a key. Modifications copy only the
+nodes on the path from the root to the binding, every other node is shared
+with the previous version.
+
+Nodes and bindings are freed when the last node or version that points to
+them is freed. Their reference counts are changed with atomic operations,
+since versions that share them may be modified or freed by different
+threads at the same time. Nothing else is ever written after creation. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include "symtablepers.h"
+
+#define HASH_MULTIPLIER 65599
+#define HASH_BITS 32
+#define HAMT_BITS 5
+#define HAMT_MASK 0x1FU
+
+#define RETAIN(ptr) __atomic_add_fetch(&(ptr)->uiRefs, 1U, __ATOMIC_RELAXED)
+#define RELEASE(ptr) __atomic_sub_fetch(&(ptr)->uiRefs, 1U, __ATOMIC_ACQ_REL)
+
+
+/* Struct that represents a binding. Bindings are never modified after they
+are created, so they can be shared by many versions.
+
+uiRefs: number of nodes that point to the binding
+uiHash: full hash of the key
+value: pointer to the value
+key: the key. It is stored right after the struct. */
+struct pleaf {
+    unsigned int uiRefs;
+    unsigned int uiHash;
+    void *value;
+    char *key;
+};
+
+
+/* An entry of a node. Exactly one of child, leaf is not NULL. */
+struct pentry {
+    struct pnode *child;
+    struct pleaf *leaf;
+};
+
+
+/* Struct that represents a node of the trie.
+
+uiRefs: number of versions and nodes that point to the node
+ulBitmap: bit i is set if the node has an entry for the hash chunk i. Not
+used by collision nodes, which appear below the last level and hold bindings
+whose keys have the same full hash.
+uiCount: number of entries
+entries: the entries, ordered by hash chunk. They are stored right after the
+struct. */
+struct pnode {
+    unsigned int uiRefs;
+    unsigned long ulBitmap;
+    unsigned int uiCount;
+    struct pentry *entries;
+};
+
+
+/* Struct that represents a version of a persistent table.
+uiBindings: number of bindings
+root: root node of the trie. NULL if the version is empty. */
+struct SymTablePers {
+    unsigned int uiBindings;
+    struct pnode *root;
+};
+
+
+/* Computes the full hash code for pcKey.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+static unsigned int SymTablePers_hash(const char *pcKey) {
+    size_t ui;
+    unsigned int uiHash;
+
+    uiHash = 0U;
+    for (ui = 0U; pcKey[ui] != '\0'; ui++) {
+        uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+    }
+    return uiHash & 0xFFFFFFFFU;
+}
+
+
+/* Returns the number of set bits in ulBits. */
+static unsigned int SymTablePers_popcount(unsigned long ulBits) {
+#ifdef __GNUC__
+    return __builtin_popcountl(ulBits);
+#else
+    unsigned int uiCount;
+
+    uiCount = 0U;
+    while (ulBits) {
+        ulBits &= ulBits - 1;
+        uiCount++;
+    }
+    return uiCount;
+#endif
+}
+
+
+/* Creates a new binding with a copy of pcKey.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct pleaf *SymTablePers_newLeaf(unsigned int uiHash, const char *pcKey, const void *pvValue) {
+    struct pleaf *leaf;
+
+    leaf = malloc(sizeof(struct pleaf) + strlen(pcKey) + 1);
+    assert(leaf);
+    leaf->uiRefs = 1U;
+    leaf->uiHash = uiHash;
+    leaf->value = (void *) pvValue;
+    leaf->key = (char *) (leaf + 1);
+    strcpy(leaf->key, pcKey);
+    return leaf;
+}
+
+
+/* Creates a new node with uiCount uninitialized entries.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct pnode *SymTablePers_newNode(unsigned long ulBitmap, unsigned int uiCount) {
+    struct pnode *node;
+
+    node = malloc(sizeof(struct pnode) + uiCount * sizeof(struct pentry));
+    assert(node);
+    node->uiRefs = 1U;
+    node->ulBitmap = ulBitmap;
+    node->uiCount = uiCount;
+    node->entries = (struct pentry *) (node + 1);
+    return node;
+}
+
+
+/* Increases the reference count of the node or binding of entry. */
+static void SymTablePers_retain(struct pentry *entry) {
+    if (entry->child) {
+        RETAIN(entry->child);
+    }
+    else {
+        RETAIN(entry->leaf);
+    }
+}
+
+
+/* Decreases the reference count of node. When it becomes 0, node is freed
+and the same is done for its entries. */
+static void SymTablePers_release(struct pnode *node) {
+    struct pentry *entry;
+    unsigned int ui;
+
+    if (!node || RELEASE(node)) {
+        return;
+    }
+    for (ui = 0U; ui < node->uiCount; ui++) {
+        entry = &node->entries[ui];
+        if (entry->child) {
+            SymTablePers_release(entry->child);
+        }
+        else if (!RELEASE(entry->leaf)) {
+            free(entry->leaf);
+        }
+    }
+    free(node);
+}
+
+
+/* Creates a copy of node with the entry at position uiIdx replaced by
+new_entry. The copy references every other entry of node.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct pnode *SymTablePers_replace(const struct pnode *node, unsigned int uiIdx, struct pentry new_entry) {
+    struct pnode *new_node;
+    unsigned int ui;
+
+    new_node = SymTablePers_newNode(node->ulBitmap, node->uiCount);
+    for (ui = 0U; ui < node->uiCount; ui++) {
+        if (ui == uiIdx) {
+            new_node->entries[ui] = new_entry;
+        }
+        else {
+            new_node->entries[ui] = node->entries[ui];
+            SymTablePers_retain(&new_node->entries[ui]);
+        }
+    }
+    return new_node;
+}
+
+
+/* Creates the smallest subtree at depth uiShift that holds the bindings
+leaf1 and leaf2. Both bindings are used without being retained.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct pnode *SymTablePers_merge(struct pleaf *leaf1, struct pleaf *leaf2, unsigned int uiShift) {
+    struct pnode *node;
+    unsigned int uiBit1, uiBit2;
+
+    /* same full hash: collision node */
+    if (uiShift >= HASH_BITS) {
+        node = SymTablePers_newNode(0UL, 2U);
+        node->entries[0].child = NULL;
+        node->entries[0].leaf = leaf1;
+        node->entries[1].child = NULL;
+        node->entries[1].leaf = leaf2;
+        return node;
+    }
+
+    uiBit1 = (leaf1->uiHash >> uiShift) & HAMT_MASK;
+    uiBit2 = (leaf2->uiHash >> uiShift) & HAMT_MASK;
+    if (uiBit1 == uiBit2) {
+        node = SymTablePers_newNode(1UL << uiBit1, 1U);
+        node->entries[0].child = SymTablePers_merge(leaf1, leaf2, uiShift + HAMT_BITS);
+        node->entries[0].leaf = NULL;
+        return node;
+    }
+    node = SymTablePers_newNode((1UL << uiBit1) | (1UL << uiBit2), 2U);
+    if (uiBit1 > uiBit2) {
+        node->entries[0].leaf = leaf2;
+        node->entries[1].leaf = leaf1;
+    }
+    else {
+        node->entries[0].leaf = leaf1;
+        node->entries[1].leaf = leaf2;
+    }
+    node->entries[0].child = NULL;
+    node->entries[1].child = NULL;
+    return node;
+}
+
+
+/* Finds the binding with key equal to pcKey in the subtree of node.
+
+Returns: the binding or NULL if such binding was not found. */
+static struct pleaf *SymTablePers_find(const struct pnode *node, unsigned int uiHash, const char *pcKey) {
+    const struct pentry *entry;
+    unsigned int ui, uiShift;
+    unsigned long ulBit;
+
+    for (uiShift = 0U; node; uiShift += HAMT_BITS) {
+
+        /* collision node: bindings are not ordered */
+        if (uiShift >= HASH_BITS) {
+            for (ui = 0U; ui < node->uiCount; ui++) {
+                if (!strcmp(node->entries[ui].leaf->key, pcKey)) {
+                    return node->entries[ui].leaf;
+                }
+            }
+            return NULL;
+        }
+
+        ulBit = 1UL << ((uiHash >> uiShift) & HAMT_MASK);
+        if (!(node->ulBitmap & ulBit)) {
+            return NULL;
+        }
+        entry = &node->entries[SymTablePers_popcount(node->ulBitmap & (ulBit - 1))];
+        if (entry->leaf) {
+            if (entry->leaf->uiHash == uiHash && !strcmp(entry->leaf->key, pcKey)) {
+                return entry->leaf;
+            }
+            return NULL;
+        }
+        node = entry->child;
+    }
+    return NULL;
+}
+
+
+/* Creates a copy of the subtree of node at depth uiShift that also has the
+binding leaf. The binding is used without being retained. If a binding with
+the same key exists, it is replaced and *piAdded is set to 0, otherwise it is
+set to 1.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct pnode *SymTablePers_insert(const struct pnode *node, unsigned int uiShift, struct pleaf *leaf, int *piAdded) {
+    struct pnode *new_node;
+    struct pentry new_entry, *entry;
+    unsigned int ui, uiIdx;
+    unsigned long ulBit;
+
+    new_entry.child = NULL;
+    new_entry.leaf = leaf;
+
+    /* collision node: replace the binding or add it at the end */
+    if (uiShift >= HASH_BITS) {
+        for (ui = 0U; ui < node->uiCount; ui++) {
+            if (!strcmp(node->entries[ui].leaf->key, leaf->key)) {
+                *piAdded = 0;
+                return SymTablePers_replace(node, ui, new_entry);
+            }
+        }
+        *piAdded = 1;
+        new_node = SymTablePers_newNode(0UL, node->uiCount + 1);
+        for (ui = 0U; ui < node->uiCount; ui++) {
+            new_node->entries[ui] = node->entries[ui];
+            SymTablePers_retain(&new_node->entries[ui]);
+        }
+        new_node->entries[ui] = new_entry;
+        return new_node;
+    }
+
+    ulBit = 1UL << ((leaf->uiHash >> uiShift) & HAMT_MASK);
+    uiIdx = SymTablePers_popcount(node->ulBitmap & (ulBit - 1));
+
+    /* empty slot: new node has one more entry */
+    if (!(node->ulBitmap & ulBit)) {
+        *piAdded = 1;
+        new_node = SymTablePers_newNode(node->ulBitmap | ulBit, node->uiCount + 1);
+        for (ui = 0U; ui < uiIdx; ui++) {
+            new_node->entries[ui] = node->entries[ui];
+            SymTablePers_retain(&new_node->entries[ui]);
+        }
+        new_node->entries[uiIdx] = new_entry;
+        for (ui = uiIdx; ui < node->uiCount; ui++) {
+            new_node->entries[ui + 1] = node->entries[ui];
+            SymTablePers_retain(&new_node->entries[ui + 1]);
+        }
+        return new_node;
+    }
+
+    entry = &node->entries[uiIdx];
+    if (entry->child) {
+        new_entry.child = SymTablePers_insert(entry->child, uiShift + HAMT_BITS, leaf, piAdded);
+        new_entry.leaf = NULL;
+    }
+    else if (!strcmp(entry->leaf->key, leaf->key)) {
+        *piAdded = 0;
+    }
+    else {
+        /* two different keys in the same slot: push both one level down */
+        *piAdded = 1;
+        RETAIN(entry->leaf);
+        new_entry.child = SymTablePers_merge(entry->leaf, leaf, uiShift + HAMT_BITS);
+        new_entry.leaf = NULL;
+    }
+    return SymTablePers_replace(node, uiIdx, new_entry);
+}
+
+
+/* Creates a copy of the subtree of node at depth uiShift that does not have
+the binding with key equal to pcKey. The binding must exist. A subtree that
+is left with a single binding is replaced by that binding.
+
+Asserts: if memory was allocated succesfully at runtime.
+
+Returns: the new entry that replaces the subtree. Both of its fields are
+NULL if the subtree becomes empty. */
+static struct pentry SymTablePers_delete(const struct pnode *node, unsigned int uiShift, unsigned int uiHash, const char *pcKey) {
+    struct pnode *new_node;
+    struct pentry new_entry, *entry;
+    unsigned int ui, uiIdx, uiNew;
+    unsigned long ulBit, ulBitmap;
+
+    if (uiShift >= HASH_BITS) {
+        for (uiIdx = 0U; strcmp(node->entries[uiIdx].leaf->key, pcKey); uiIdx++) {
+            ;
+        }
+        ulBitmap = 0UL;
+    }
+    else {
+        ulBit = 1UL << ((uiHash >> uiShift) & HAMT_MASK);
+        uiIdx = SymTablePers_popcount(node->ulBitmap & (ulBit - 1));
+        entry = &node->entries[uiIdx];
+
+        /* binding is deeper in the trie */
+        if (entry->child) {
+            new_entry = SymTablePers_delete(entry->child, uiShift + HAMT_BITS, uiHash, pcKey);
+            if (new_entry.child || new_entry.leaf) {
+                if (new_entry.leaf && node->uiCount == 1) {
+                    return new_entry;
+                }
+                new_node = SymTablePers_replace(node, uiIdx, new_entry);
+                new_entry.child = new_node;
+                new_entry.leaf = NULL;
+                return new_entry;
+            }
+        }
+        ulBitmap = node->ulBitmap & ~ulBit;
+    }
+
+    /* entry uiIdx is removed. A single remaining binding moves up. */
+    new_entry.child = NULL;
+    new_entry.leaf = NULL;
+    if (node->uiCount == 1) {
+        return new_entry;
+    }
+    if (node->uiCount == 2 && node->entries[1 - uiIdx].leaf) {
+        new_entry.leaf = node->entries[1 - uiIdx].leaf;
+        RETAIN(new_entry.leaf);
+        return new_entry;
+    }
+    new_node = SymTablePers_newNode(ulBitmap, node->uiCount - 1);
+    for (ui = 0U, uiNew = 0U; ui < node->uiCount; ui++) {
+        if (ui != uiIdx) {
+            new_node->entries[uiNew] = node->entries[ui];
+            SymTablePers_retain(&new_node->entries[uiNew]);
+            uiNew++;
+        }
+    }
+    new_entry.child = new_node;
+    return new_entry;
+}
+
+
+/* Applies function pfApply to every binding in the subtree of node. */
+static void SymTablePers_mapNode(const struct pnode *node,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra) {
+    unsigned int ui;
+
+    for (ui = 0U; ui < node->uiCount; ui++) {
+        if (node->entries[ui].child) {
+            SymTablePers_mapNode(node->entries[ui].child, pfApply, pvExtra);
+        }
+        else {
+            pfApply(node->entries[ui].leaf->key, node->entries[ui].leaf->value, (void *) pvExtra);
+        }
+    }
+}
+
+
+/* Creates a version with uiBindings bindings from root. root is used
+without being retained.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct SymTablePers *SymTablePers_version(struct pnode *root, unsigned int uiBindings) {
+    struct SymTablePers *symtable;
+
+    symtable = malloc(sizeof(struct SymTablePers));
+    assert(symtable);
+    symtable->root = root;
+    symtable->uiBindings = uiBindings;
+    return symtable;
+}
+
+
+/* Creates an empty SymTablePers version.
+
+Asserts: if memory was allocated succesfully at runtime. */
+SymTablePers_T SymTablePers_new(void) {
+    return (SymTablePers_T) SymTablePers_version(NULL, 0U);
+}
+
+
+/* Frees the memory used by oSymTable that is not shared with other versions.
+
+Parameters:
+* oSymTable: a SymTablePers_T type */
+void SymTablePers_free(SymTablePers_T oSymTable) {
+    struct SymTablePers *symtable;
+
+    symtable = oSymTable;
+    if (!symtable) {
+        return;
+    }
+    SymTablePers_release(symtable->root);
+    free(symtable);
+}
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type */
+unsigned int SymTablePers_getLength(SymTablePers_T oSymTable) {
+    struct SymTablePers *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    return symtable->uiBindings;
+}
+
+
+/* Creates a new version of oSymTable that has a binding from pcKey to pvValue.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value
+
+Returns: the new version */
+SymTablePers_T SymTablePers_put(SymTablePers_T oSymTable, const char *pcKey, const void *pvValue) {
+    struct SymTablePers *symtable;
+    struct pleaf *leaf;
+    struct pnode *root;
+    int iAdded;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    leaf = SymTablePers_newLeaf(SymTablePers_hash(pcKey), pcKey, pvValue);
+    if (!symtable->root) {
+        root = SymTablePers_newNode(1UL << (leaf->uiHash & HAMT_MASK), 1U);
+        root->entries[0].child = NULL;
+        root->entries[0].leaf = leaf;
+        iAdded = 1;
+    }
+    else {
+        root = SymTablePers_insert(symtable->root, 0U, leaf, &iAdded);
+    }
+    return (SymTablePers_T) SymTablePers_version(root, symtable->uiBindings + iAdded);
+}
+
+
+/* Creates a new version of oSymTable that has no binding with key equal to
+pcKey.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: the new version */
+SymTablePers_T SymTablePers_remove(SymTablePers_T oSymTable, const char *pcKey) {
+    struct SymTablePers *symtable;
+    struct pentry new_entry;
+    struct pnode *root;
+    unsigned int uiHash;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    /* binding not found: the new version shares the whole trie */
+    uiHash = SymTablePers_hash(pcKey);
+    if (!SymTablePers_find(symtable->root, uiHash, pcKey)) {
+        if (symtable->root) {
+            RETAIN(symtable->root);
+        }
+        return (SymTablePers_T) SymTablePers_version(symtable->root, symtable->uiBindings);
+    }
+
+    new_entry = SymTablePers_delete(symtable->root, 0U, uiHash, pcKey);
+
+    /* the root must be a node, a single remaining binding stays in it */
+    root = new_entry.child;
+    if (new_entry.leaf) {
+        root = SymTablePers_newNode(1UL << (new_entry.leaf->uiHash & HAMT_MASK), 1U);
+        root->entries[0] = new_entry;
+    }
+    return (SymTablePers_T) SymTablePers_version(root, symtable->uiBindings - 1);
+}
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTablePers_contains(SymTablePers_T oSymTable, const char *pcKey) {
+    struct SymTablePers *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    return SymTablePers_find(symtable->root, SymTablePers_hash(pcKey), pcKey) != NULL;
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTablePers_get(SymTablePers_T oSymTable, const char *pcKey) {
+    struct SymTablePers *symtable;
+    struct pleaf *leaf;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    leaf = SymTablePers_find(symtable->root, SymTablePers_hash(pcKey), pcKey);
+    if (!leaf) {
+        return NULL;
+    }
+    return leaf->value;
+}
+
+
+/* Applies function pfApply to every binding in oSymTable.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTablePers_map(SymTablePers_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTablePers *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pfApply);
+
+    if (symtable->root) {
+        SymTablePers_mapNode(symtable->root, pfApply, pvExtra);
+    }
+}
@@ -6,15 +6,45 @@ Hash array based implementation with linked lists for resolving conflicts */
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
 #include "symtable.h"
 
 #define HASH_MULTIPLIER 65599
 #define MAX_BUCKETS 65521
 #define MIN_BUCKETS 519
+#define BUILD_PARTITIONS 16 /* partitions per thread in SymTable_buildParallel */
+#define MAX_BUILD_THREADS 256 /* maximum number of threads of SymTable_buildParallel */
+#define SKETCH_ROWS 4       /* rows of the count-min sketch of SymTable_setSampling */
+#define SKETCH_WIDTH 1024   /* counters per row, a power of 2 */
+#define SKETCH_AGE 16384    /* samples after which all counts are halved */
+#define SAMPLE_TOP 16       /* hottest bindings kept by SymTable_setSampling */
+#define MAX_CACHE 65536     /* maximum number of entries of the cache of SymTable_setCache */
+#define HASH_AHEAD 8        /* keys prefetched ahead by SymTable_hashKeys */
+#define BATCH_KEYS 64       /* keys whose buckets are prefetched together by SymTable_getBatch */
+
+#ifdef __GNUC__
+#define PREFETCH(p) __builtin_prefetch(p)
+#else
+#define PREFETCH(p)
+#endif
 
 static unsigned const BUCKARR[] = {MIN_BUCKETS, 1021, 2053, 4093, 8191, 16381, 32771, MAX_BUCKETS};
 static unsigned int SymTable_hash(unsigned int uiBuckets, const char *pcKey);
-static void SymTable_change(SymTable_T oSymTable, unsigned int uiBuckets);
+static int SymTable_change(SymTable_T oSymTable, unsigned int uiBuckets);
+static int SymTable_insert(SymTable_T oSymTable, const char *pcKey, const void *pvValue, int iCopy);
+static size_t SymTable_bindSize(SymTable_T oSymTable, const char *pcKey);
+static unsigned int SymTable_target(SymTable_T oSymTable);
+static struct abind *SymTable_newBind(const char *pcKey, const void *pvValue, int iCopy);
+static void *SymTable_hashWorker(void *pvBuild);
+static void *SymTable_chainWorker(void *pvBuild);
+static void SymTable_runWorkers(void *(*pfWorker)(void *), void *pvBuild, unsigned int uiThreads);
+static void SymTable_sample(SymTable_T oSymTable, struct abind *pBind);
+static void SymTable_unsample(SymTable_T oSymTable, struct abind *pBind);
+static unsigned int SymTable_cacheSlot(SymTable_T oSymTable, unsigned int uiCode);
+static struct abind *SymTable_lookupCached(SymTable_T oSymTable, const char *pcKey, unsigned int uiCode);
+static void SymTable_uncache(SymTable_T oSymTable, struct abind *pBind);
+static struct abind *SymTable_detach(SymTable_T oSymTable, const char *pcKey);
+static void SymTable_noMemory(void);
 
 
 /* Struct that represents a binding in the symbol table. Each binding
@@ -22,8 +52,12 @@ has a pointer to a key, a pointer to a value and a pointer to the next
 binding.
 
 Note: A binding owns its key. That means each binding should have a copy of
-the key. On the other hand, a binding does not own its value because it has
-type (void *) */
+the key, which is stored right after the binding in the same allocation so
+that an insert allocates only once. The only exception is a key that points
+inside the blob of the table (see SymTable_newBlob), it is then referenced.
+On the other hand, a binding does not own its value because it has type
+(void *), unless the table has value callbacks (see
+SymTable_setValueCallbacks) */
 struct abind {
     char *key;
     void *value;
@@ -34,11 +68,109 @@ struct abind {
 /* Struct that represents a symbol table as a hash table.
 uiBuckets: number of buckets
 uiBindings: number of bindings
-array: a pointer to an array of pointers to bindings */
+array: a pointer to an array of pointers to bindings
+pcBlob: read-only block of keys that are referenced instead of copied. NULL if
+the table has no blob.
+uiBlobSize: size of pcBlob in bytes
+snapshot: NULL unless the table is a read-only snapshot. In that case all
+bindings are stored in this single array and all keys in pcBlob, which is
+owned by the table.
+dMinLoad, dMaxLoad, dGrowth, uiMaxBytes: resize policy, see SymTable_setPolicy
+uiBytes: number of bytes allocated by the table
+sampling: NULL unless access sampling is enabled, see SymTable_setSampling
+cache, uiCacheMask: NULL unless the lookup cache is enabled, see
+SymTable_setCache. The cache has uiCacheMask + 1 entries.
+pfRetain, pfRelease, pvCallbackExtra: value callbacks, see
+SymTable_setValueCallbacks. NULL if not used. */
 struct SymTable {
     unsigned int uiBindings;
     unsigned int uiBuckets;
     struct abind **array;
+    const char *pcBlob;
+    size_t uiBlobSize;
+    struct abind *snapshot;
+    double dMinLoad;
+    double dMaxLoad;
+    double dGrowth;
+    size_t uiMaxBytes;
+    size_t uiBytes;
+    struct sampling *sampling;
+    struct cache *cache;
+    unsigned int uiCacheMask;
+    void (*pfRetain)(void *pvValue, void *pvExtra);
+    void (*pfRelease)(void *pvValue, void *pvExtra);
+    void *pvCallbackExtra;
+};
+
+
+/* Struct that represents an entry of the lookup cache of a table: a binding
+and the full hash code of its key. bind is NULL if the entry is empty.
+Readers on several threads may replace an entry at the same time, so both
+fields are accessed atomically and may belong to different bindings: uiCode
+only filters, the key of bind decides. */
+struct cache {
+    unsigned int uiCode;
+    struct abind *bind;
+};
+
+
+/* Struct that holds the access sampling state of a table.
+uiRate: average number of successful SymTable_get calls per sample
+uiCountdown: calls left until the next sample, decremented atomically. It is
+reset to a random number with average uiRate, so that periodic access
+patterns are sampled fairly.
+ulRandom: state of the random number generator
+uiSamples: samples since the counts were last halved
+sketch: count-min sketch. The number of samples of a key is estimated by the
+smallest of its counters, one in each row.
+top: the hottest bindings seen, with their estimated number of samples in
+auiTopCounts
+uiTop: number of bindings in top
+iBusy: set while a thread counts a sample or reads top. Readers use the
+fields above, except uiRate and uiCountdown, only while it is set. */
+struct sampling {
+    unsigned int uiRate;
+    unsigned int uiCountdown;
+    unsigned long ulRandom;
+    unsigned int uiSamples;
+    unsigned int sketch[SKETCH_ROWS][SKETCH_WIDTH];
+    struct abind *top[SAMPLE_TOP];
+    unsigned int auiTopCounts[SAMPLE_TOP];
+    unsigned int uiTop;
+    int iBusy;
+};
+
+/* multipliers that select the counter of a key in each row of the sketch */
+static unsigned long const SKETCH_SEEDS[SKETCH_ROWS] = {0x9E3779B1UL, 0x85EBCA77UL, 0xC2B2AE3DUL, 0x27D4EB2FUL};
+
+
+/* Struct that holds the state shared by the threads of SymTable_buildParallel.
+ppcKeys, ppvValues, uiCount: the input bindings
+symtable: the table that is being built
+puiBucket: bucket of each input binding
+puiOrder: input positions sorted by partition, in input order within each
+partition
+puiStart: first position in puiOrder of each partition, plus a final entry
+uiPartitions: number of partitions. Each one is a range of buckets.
+uiNext: next partition that has not been claimed by a thread
+uiNextSlice: next slice of the input that has not been hashed
+uiAdded: number of bindings created
+uiBytes: number of bytes allocated for the bindings
+iFailed: set when a binding could not be allocated. The threads then stop. */
+struct build {
+    const char **ppcKeys;
+    const void **ppvValues;
+    unsigned int uiCount;
+    struct SymTable *symtable;
+    unsigned int *puiBucket;
+    unsigned int *puiOrder;
+    unsigned int *puiStart;
+    unsigned int uiPartitions;
+    unsigned int uiNext;
+    unsigned int uiNextSlice;
+    unsigned int uiAdded;
+    size_t uiBytes;
+    int iFailed;
 };
 
 
@@ -50,6 +182,17 @@ Parameters:
 * uiBuckets: number of buckets
 * pcKey: character array (key). Must be null terminated. */
 static unsigned int SymTable_hash(unsigned int uiBuckets, const char *pcKey) {
+    return SymTable_hashKey(pcKey) % uiBuckets;
+}
+
+
+/* Computes the hash code for pcKey before it is reduced to a bucket.
+
+Asserts: if pcKey is NULL at runtime.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+unsigned int SymTable_hashKey(const char *pcKey) {
     size_t ui;
     unsigned int uiHash;
 
@@ -58,23 +201,81 @@ static unsigned int SymTable_hash(unsigned int uiBuckets, const char *pcKey) {
     for (ui = 0U; pcKey[ui] != '\0'; ui++) {
         uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
     }
-    uiHash = uiHash % uiBuckets;
     return uiHash;
 }
 
 
+/* Computes the hash codes of the uiCount keys of ppcKeys into puiCodes, the
+same as SymTable_hashKey. The hash of a key is a chain of dependent
+multiplications, one per character, so hashing one character at a time
+keeps the CPU waiting for each of them. Here the length of each key is
+found first, then 4 characters are added per step with the powers of the
+multiplier: their 4 products are independent, and only one multiplication
+per step depends on the previous one.
+
+Asserts: if ppcKeys, puiCodes and each key are not NULL at runtime.
+
+Parameters:
+* ppcKeys: array of keys. Each must be null terminated.
+* uiCount: number of keys
+* puiCodes: array of uiCount hash codes */
+void SymTable_hashKeys(const char **ppcKeys, unsigned int uiCount, unsigned int *puiCodes) {
+    const unsigned int uiM2 = (unsigned int) HASH_MULTIPLIER * HASH_MULTIPLIER;
+    const unsigned int uiM3 = uiM2 * HASH_MULTIPLIER;
+    const unsigned int uiM4 = uiM3 * HASH_MULTIPLIER;
+    const char *pcKey;
+    unsigned int uiKey, uiHash;
+    size_t ui, uiLen;
+
+    assert(ppcKeys);
+    assert(puiCodes);
+    for (uiKey = 0U; uiKey < uiCount; uiKey++) {
+        if (uiKey + HASH_AHEAD < uiCount) {
+            PREFETCH(ppcKeys[uiKey + HASH_AHEAD]);
+        }
+        pcKey = ppcKeys[uiKey];
+        assert(pcKey);
+        uiLen = strlen(pcKey);
+        uiHash = 0U;
+        for (ui = 0U; ui + 4 <= uiLen; ui += 4) {
+            uiHash = uiHash * uiM4 + pcKey[ui] * uiM3 + pcKey[ui + 1] * uiM2 +
+                pcKey[ui + 2] * (unsigned int) HASH_MULTIPLIER + pcKey[ui + 3];
+        }
+        for (; ui < uiLen; ui++) {
+            uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+        }
+        puiCodes[uiKey] = uiHash;
+    }
+}
+
+
+/* Returns the number of bucket sizes a table can have and sets *ppuiSizes
+to an array with them, in increasing order.
+
+Asserts: if ppuiSizes is not NULL at runtime.
+
+Parameters:
+* ppuiSizes: pointer that is set to the array of sizes */
+unsigned int SymTable_bucketSizes(const unsigned int **ppuiSizes) {
+    assert(ppuiSizes);
+    *ppuiSizes = BUCKARR;
+    return sizeof(BUCKARR) / sizeof(BUCKARR[0]);
+}
+
+
 /* Changes the number of buckets in oSymTable to uiBuckets.
 
 uiBuckets MUST be a number in BUCKARR.
 
-Asserts:
-1) if oSymTable is NULL at runtime.
-2) if necessary memory is allocated succesfully at runtime.
+Asserts: if oSymTable is NULL at runtime.
 
 Parameters:
 * oSymTable: a SymTable_T type
-* uiBuckets: the new number of buckets */
-static void SymTable_change(SymTable_T oSymTable, unsigned int uiBuckets) {
+* uiBuckets: the new number of buckets
+
+Returns: 1 if the number of buckets was changed, 0 if memory could not be
+allocated. In that case oSymTable is not modified. */
+static int SymTable_change(SymTable_T oSymTable, unsigned int uiBuckets) {
     struct abind **bind_arr, *ptr, *ptr_next;
     struct SymTable *symtable;
     unsigned int ui, uiHash;
@@ -84,7 +285,9 @@ static void SymTable_change(SymTable_T oSymTable, unsigned int uiBuckets) {
 
     /* allocate memory for a new array of pointers to bindings */
     bind_arr = malloc(uiBuckets * sizeof(struct abind *));
-    assert(bind_arr);
+    if (!bind_arr) {
+        return 0;
+    }
     for (ui = 0U; ui < uiBuckets; ui++) {
         bind_arr[ui] = NULL;
     }
@@ -104,37 +307,161 @@ static void SymTable_change(SymTable_T oSymTable, unsigned int uiBuckets) {
 
     /* old binding array is not needed anymore */
     free(symtable->array);
+    symtable->uiBytes -= symtable->uiBuckets * sizeof(struct abind *);
+    symtable->uiBytes += uiBuckets * sizeof(struct abind *);
 
     /* assign the number of buckets and the array of pointers to bindings
     to their new values. */
     symtable->uiBuckets = uiBuckets;
     symtable->array = bind_arr;
 
-    return;
+    return 1;
 }
 
 
 /* Creates a SymTable struct with no bindings and MIN_BUCKETS number of buckets. 
 
-Asserts: if memory was allocated succesfully for oSymTable at runtime. */
+Aborts if memory could not be allocated for oSymTable. */
 SymTable_T SymTable_new(void) {
     struct SymTable *symtable;
+
+    symtable = SymTable_tryNew();
+    if (!symtable) {
+        SymTable_noMemory();
+    }
+    return (SymTable_T) symtable;
+}
+
+
+/* Creates a SymTable struct with no bindings and MIN_BUCKETS number of buckets.
+
+Returns: a SymTable_T type or NULL if memory could not be allocated */
+SymTable_T SymTable_tryNew(void) {
+    struct SymTable *symtable;
     unsigned int ui;
 
     symtable = malloc(sizeof(struct SymTable));
-    assert(symtable);
+    if (!symtable) {
+        return NULL;
+    }
     symtable->array = malloc(MIN_BUCKETS * sizeof(struct abind *));
-    assert(symtable->array);
+    if (!symtable->array) {
+        free(symtable);
+        return NULL;
+    }
     for (ui = 0U; ui < BUCKARR[0]; ui++) {
         symtable->array[ui] = NULL;
     }
     symtable->uiBindings = 0U;
     symtable->uiBuckets = MIN_BUCKETS;
+    symtable->pcBlob = NULL;
+    symtable->uiBlobSize = 0U;
+    symtable->snapshot = NULL;
+    symtable->sampling = NULL;
+    symtable->cache = NULL;
+    symtable->uiCacheMask = 0U;
+    symtable->pfRetain = NULL;
+    symtable->pfRelease = NULL;
+    symtable->pvCallbackExtra = NULL;
+    symtable->dMinLoad = 0.0;
+    symtable->dMaxLoad = 1.0;
+    symtable->dGrowth = 1.0;
+    symtable->uiMaxBytes = 0U;
+    symtable->uiBytes = sizeof(struct SymTable) + MIN_BUCKETS * sizeof(struct abind *);
     return (SymTable_T) symtable;
 }
 
 
-/* Frees all memory used by oSymTable.
+/* Creates a SymTable struct with no bindings and MIN_BUCKETS number of buckets.
+Keys inserted with SymTable_putBlob are pointers inside pcBlob and are never
+copied. pcBlob must not change and must outlive the table.
+
+Asserts: if pcBlob is not NULL at runtime.
+
+Aborts if memory could not be allocated for oSymTable.
+
+Parameters:
+* pcBlob: read-only block of null terminated keys (e.g. a mmap'd file)
+* uiSize: size of pcBlob in bytes */
+SymTable_T SymTable_newBlob(const char *pcBlob, size_t uiSize) {
+    struct SymTable *symtable;
+
+    assert(pcBlob);
+    symtable = SymTable_new();
+    symtable->pcBlob = pcBlob;
+    symtable->uiBlobSize = uiSize;
+    return (SymTable_T) symtable;
+}
+
+
+/* Returns the number of bytes allocated for a binding of oSymTable with key
+pcKey, including the key unless it points inside the blob of oSymTable.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pcKey: the key of a binding */
+static size_t SymTable_bindSize(SymTable_T oSymTable, const char *pcKey) {
+    struct SymTable *symtable;
+
+    symtable = oSymTable;
+    if (pcKey >= symtable->pcBlob && pcKey < symtable->pcBlob + symtable->uiBlobSize) {
+        return sizeof(struct abind);
+    }
+    return sizeof(struct abind) + strlen(pcKey) + 1;
+}
+
+
+/* Returns the number of buckets that oSymTable should have according to
+its resize policy:
+
+1) When the load factor reaches dMaxLoad, the smallest number in BUCKARR
+that is at least dGrowth times the current number and keeps the load factor
+below dMaxLoad. If the larger bucket array would exceed uiMaxBytes, the
+largest number in between that fits, or else the current number.
+2) When the load factor drops below dMinLoad, the smallest number in BUCKARR
+that keeps the load factor below the middle of dMinLoad and dMaxLoad.
+3) Otherwise the current number.
+
+Parameters:
+* oSymTable: a SymTable_T type */
+static unsigned int SymTable_target(SymTable_T oSymTable) {
+    struct SymTable *symtable;
+    unsigned int uiBuckets, uiBindings;
+    int idx;
+
+    symtable = oSymTable;
+    uiBuckets = symtable->uiBuckets;
+    uiBindings = symtable->uiBindings;
+
+    if (uiBindings >= uiBuckets * symtable->dMaxLoad) {
+        for (idx = 0; BUCKARR[idx] != MAX_BUCKETS; idx++) {
+            if (BUCKARR[idx] > uiBuckets && BUCKARR[idx] >= uiBuckets * symtable->dGrowth &&
+                    uiBindings < BUCKARR[idx] * symtable->dMaxLoad) {
+                break;
+            }
+        }
+        if (symtable->uiMaxBytes) {
+            while (BUCKARR[idx] > uiBuckets && symtable->uiBytes +
+                    (BUCKARR[idx] - uiBuckets) * sizeof(struct abind *) > symtable->uiMaxBytes) {
+                idx--;
+            }
+        }
+        return BUCKARR[idx] > uiBuckets ? BUCKARR[idx] : uiBuckets;
+    }
+
+    if (uiBindings < uiBuckets * symtable->dMinLoad) {
+        for (idx = 0; BUCKARR[idx] < uiBuckets; idx++) {
+            if (uiBindings < BUCKARR[idx] * (symtable->dMinLoad + symtable->dMaxLoad) / 2) {
+                return BUCKARR[idx];
+            }
+        }
+    }
+    return uiBuckets;
+}
+
+
+/* Frees all memory used by oSymTable. Every value is released if oSymTable
+has a release callback.
 
 Parameters:
 * oSymTable: a SymTable_T type */
@@ -147,15 +474,31 @@ void SymTable_free(SymTable_T oSymTable) {
     if (!symtable) {
         return;
     }
+    if (symtable->snapshot) {
+        if (symtable->pfRelease) {
+            for (ui = 0U; ui < symtable->uiBindings; ui++) {
+                (*symtable->pfRelease)(symtable->snapshot[ui].value, symtable->pvCallbackExtra);
+            }
+        }
+        free((char *) symtable->pcBlob);
+        free(symtable->snapshot);
+        free(symtable->array);
+        free(symtable);
+        return;
+    }
     for (ui = 0U; ui < (symtable->uiBuckets); ui++) {
         ptr = symtable->array[ui]; /* first binding of the bucket */
         while (ptr) {
             ptr_next = ptr->next;
-            free(ptr->key); 
+            if (symtable->pfRelease) {
+                (*symtable->pfRelease)(ptr->value, symtable->pvCallbackExtra);
+            }
             free(ptr);
             ptr = ptr_next;
         }
     }
+    free(symtable->sampling);
+    free(symtable->cache);
     free(symtable->array);
     free(symtable);
     return;
@@ -210,25 +553,61 @@ int SymTable_contains(SymTable_T oSymTable, const char *pcKey) {
 }
 
 
+/* Allocates and initializes a binding that is not part of any bucket.
+A copy of pcKey is stored after the binding, so a single free releases both.
+
+Parameters:
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value
+* iCopy: 1 if the binding gets a copy of pcKey, 0 if it references pcKey
+
+Returns: the binding or NULL if memory could not be allocated */
+static struct abind *SymTable_newBind(const char *pcKey, const void *pvValue, int iCopy) {
+    struct abind *new_bind;
+
+    new_bind = malloc(sizeof(struct abind) + (iCopy ? strlen(pcKey) + 1 : 0));
+    if (!new_bind) {
+        return NULL;
+    }
+    if (iCopy) {
+        new_bind->key = (char *) (new_bind + 1);
+        strcpy(new_bind->key, pcKey);
+    }
+    else {
+        new_bind->key = (char *) pcKey;
+    }
+    new_bind->value = (void *) pvValue;
+    new_bind->next = NULL;
+    return new_bind;
+}
+
+
 /* Creates a new binding for oSymTable from a given pcKey and pvValue.
+If a binding with key equal to pcKey exists, only its value is updated: the
+new value is retained before the old one is released, so putting the same
+value again keeps it alive. Without a retain function the table owns its
+values, and putting the value it already holds releases nothing. If the
+bucket array cannot grow, the binding is added to the current one.
 
-Asserts: 
-1) if oSymTable and pcKey are not NULL at runtime.
-2) if necessary memory was allocated succesfully at runtime.
+Asserts: if oSymTable and pcKey are not NULL at runtime.
 
 Parameters:
 * oSymTable: a SymTable_T type
 * pcKey: a character array (key). Must be null terminated.
-* pvValue: pointer to any value */
-void SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue) {
+* pvValue: pointer to any value
+* iCopy: 1 if the new binding gets a copy of pcKey, 0 if it references pcKey
+
+Returns: 1 on success, 0 if memory for the binding could not be allocated.
+In that case oSymTable is not modified. */
+static int SymTable_insert(SymTable_T oSymTable, const char *pcKey, const void *pvValue, int iCopy) {
     struct abind *new_bind, *ptr;
     struct SymTable *symtable;
-    char *new_key;
     unsigned int uiHash, uiBuckets;
-    int idx = 0;
+    void *pvOld;
     
     symtable = oSymTable;
     assert(symtable);
+    assert(!symtable->snapshot);
     assert(pcKey);
 
     /* search only the bucket that corresponds to the pcKey hash code */
@@ -237,31 +616,32 @@ void SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue)
 
     while (ptr) {
         if (!strcmp(ptr->key, pcKey)) {
+            pvOld = ptr->value;
             ptr->value = (void *) pvValue;
-            return;
+            if (symtable->pfRetain) {
+                (*symtable->pfRetain)(ptr->value, symtable->pvCallbackExtra);
+            }
+            if (symtable->pfRelease && (symtable->pfRetain || pvOld != pvValue)) {
+                (*symtable->pfRelease)(pvOld, symtable->pvCallbackExtra);
+            }
+            return 1;
         }
         ptr = ptr->next;
     }
 
-    /* find if #buckets need to increase, if so, call Symtable_change */
-    uiBuckets = symtable->uiBuckets;
-    while (((symtable->uiBindings) >= uiBuckets) && (uiBuckets != MAX_BUCKETS)) {
-        uiBuckets = BUCKARR[++idx];
-    }
-    if (uiBuckets != symtable->uiBuckets) {
-        SymTable_change(symtable, uiBuckets);
-    }
+    /* find if #buckets need to change, if so, call Symtable_change */
+    uiBuckets = SymTable_target(symtable);
 
-    /* allocate memory for a new binding */
-    new_bind = malloc(sizeof(struct abind));
-    assert(new_bind);
-    new_key = malloc((strlen(pcKey) + 1) * sizeof(char));
-    assert(new_key);
+    /* keep the current buckets and longer chains if the new array cannot
+    be allocated */
+    if (uiBuckets != symtable->uiBuckets && !SymTable_change(symtable, uiBuckets)) {
+        uiBuckets = symtable->uiBuckets;
+    }
 
-    /* initialize binding */
-    strcpy(new_key, pcKey);
-    new_bind->key = new_key;
-    new_bind->value = (void *) pvValue;
+    new_bind = SymTable_newBind(pcKey, pvValue, iCopy);
+    if (!new_bind) {
+        return 0;
+    }
 
     /* binding is inserted in the bucket indicated by the hash of its key 
     and before every other binding */
@@ -270,6 +650,84 @@ void SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue)
     symtable->array[uiHash] = new_bind;
 
     symtable->uiBindings += 1;
+    symtable->uiBytes += SymTable_bindSize(symtable, new_bind->key);
+    if (symtable->pfRetain) {
+        (*symtable->pfRetain)(new_bind->value, symtable->pvCallbackExtra);
+    }
+    return 1;
+}
+
+
+/* Reports that memory could not be allocated and aborts. Used by the
+functions that have no way to return the failure, so that it does not
+depend on assert, which is removed by NDEBUG. */
+static void SymTable_noMemory(void) {
+    fprintf(stderr, "SymTable: out of memory\n");
+    abort();
+}
+
+
+/* Creates a new binding for oSymTable from a given pcKey and pvValue.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Aborts if necessary memory could not be allocated, see SymTable_tryPut.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value */
+void SymTable_put(SymTable_T oSymTable, const char *pcKey, const void *pvValue) {
+    if (!SymTable_insert(oSymTable, pcKey, pvValue, 1)) {
+        SymTable_noMemory();
+    }
+}
+
+
+/* Creates a new binding for oSymTable from a given pcKey and pvValue.
+Same as SymTable_put, except that failing to allocate memory is reported
+instead of aborting.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value
+
+Returns: 1 on success, 0 if memory could not be allocated. In that case
+oSymTable is not modified. */
+int SymTable_tryPut(SymTable_T oSymTable, const char *pcKey, const void *pvValue) {
+    return SymTable_insert(oSymTable, pcKey, pvValue, 1);
+}
+
+
+/* Creates a new binding for oSymTable whose key is the null terminated string
+that starts at offset uiOffset of the table blob. The key is not copied.
+
+Asserts:
+1) if oSymTable is not NULL and has a blob at runtime.
+2) if the key at uiOffset is null terminated inside the blob at runtime.
+
+Aborts if necessary memory could not be allocated.
+
+Parameters:
+* oSymTable: a SymTable_T type created by SymTable_newBlob
+* uiOffset: offset of the key in the blob
+* pvValue: pointer to any value */
+void SymTable_putBlob(SymTable_T oSymTable, size_t uiOffset, const void *pvValue) {
+    struct SymTable *symtable;
+    const char *pcKey;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(symtable->pcBlob);
+    assert(uiOffset < symtable->uiBlobSize);
+    pcKey = symtable->pcBlob + uiOffset;
+    assert(memchr(pcKey, '\0', symtable->uiBlobSize - uiOffset));
+    if (!SymTable_insert(symtable, pcKey, pvValue, 0)) {
+        SymTable_noMemory();
+    }
 }
 
 
@@ -318,37 +776,251 @@ void* SymTable_get(SymTable_T oSymTable, const char *pcKey) {
     assert(symtable);
     assert(pcKey);
 
-    /* search only the bucket that corresponds to the pcKey hash code */
-    uiHash = SymTable_hash(symtable->uiBuckets, pcKey);
-    ptr = symtable->array[uiHash]; /* first binding of the bucket */
+    if (symtable->cache) {
+        ptr = SymTable_lookupCached(symtable, pcKey, SymTable_hashKey(pcKey));
+    }
+    else {
+        /* search only the bucket that corresponds to the pcKey hash code */
+        uiHash = SymTable_hash(symtable->uiBuckets, pcKey);
+        ptr = symtable->array[uiHash]; /* first binding of the bucket */
 
-    while (ptr) {
+        while (ptr && strcmp(ptr->key, pcKey)) {
+            ptr = ptr->next;
+        }
+    }
+    if (!ptr) {
+        return NULL;
+    }
+    if (symtable->sampling && !__atomic_sub_fetch(&symtable->sampling->uiCountdown, 1U, __ATOMIC_RELAXED)) {
+        SymTable_sample(symtable, ptr);
+    }
+    return ptr->value;
+}
+
+
+/* Finds in oSymTable the values of the uiCount keys of ppcKeys, like
+SymTable_get for each key. Keys are processed BATCH_KEYS at a time: their
+hash codes are computed together by SymTable_hashKeys, then the bucket
+array entries and the first bindings of all their buckets are prefetched
+before any chain is walked, so that the cache misses of different keys
+overlap instead of being paid one after the other.
+
+Asserts: if oSymTable, ppcKeys, ppvValues and each key are not NULL at
+runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* ppcKeys: array of keys. Each must be null terminated.
+* uiCount: number of keys
+* ppvValues: array of uiCount values, set to the value of each key or NULL
+if it was not found */
+void SymTable_getBatch(SymTable_T oSymTable, const char **ppcKeys, unsigned int uiCount, void **ppvValues) {
+    struct abind *ptr;
+    struct SymTable *symtable;
+    unsigned int auiCodes[BATCH_KEYS];
+    unsigned int ui, uiKey, uiKeys;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(ppcKeys);
+    assert(ppvValues);
+
+    for (uiKey = 0U; uiKey < uiCount; uiKey += uiKeys) {
+        uiKeys = uiCount - uiKey < BATCH_KEYS ? uiCount - uiKey : BATCH_KEYS;
+        SymTable_hashKeys(ppcKeys + uiKey, uiKeys, auiCodes);
+        for (ui = 0U; ui < uiKeys; ui++) {
+            PREFETCH(&symtable->array[auiCodes[ui] % symtable->uiBuckets]);
+        }
+        for (ui = 0U; ui < uiKeys; ui++) {
+            PREFETCH(symtable->array[auiCodes[ui] % symtable->uiBuckets]);
+        }
+
+        for (ui = 0U; ui < uiKeys; ui++) {
+            if (symtable->cache) {
+                ptr = SymTable_lookupCached(symtable, ppcKeys[uiKey + ui], auiCodes[ui]);
+            }
+            else {
+                ptr = symtable->array[auiCodes[ui] % symtable->uiBuckets];
+                while (ptr && strcmp(ptr->key, ppcKeys[uiKey + ui])) {
+                    ptr = ptr->next;
+                }
+            }
+            if (!ptr) {
+                ppvValues[uiKey + ui] = NULL;
+                continue;
+            }
+            if (symtable->sampling && !__atomic_sub_fetch(&symtable->sampling->uiCountdown, 1U, __ATOMIC_RELAXED)) {
+                SymTable_sample(symtable, ptr);
+            }
+            ppvValues[uiKey + ui] = ptr->value;
+        }
+    }
+}
+
+
+/* Returns the entry of the lookup cache of oSymTable for a key with hash
+code uiCode. The entry is chosen by other bits of the code than the bucket,
+so keys of the same bucket are spread over the cache.
+
+Parameters:
+* oSymTable: a SymTable_T type with the cache enabled
+* uiCode: the full hash code of a key, see SymTable_hashKey */
+static unsigned int SymTable_cacheSlot(SymTable_T oSymTable, unsigned int uiCode) {
+    return (unsigned int) ((((uiCode * 0x9E3779B1UL) & 0xFFFFFFFFUL) >> 16) &
+        ((struct SymTable *) oSymTable)->uiCacheMask);
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey, first in the lookup
+cache and then in the bucket of pcKey. A binding found in the bucket
+replaces the cache entry of pcKey. Safe to call from several threads at
+once, see struct cache.
+
+Parameters:
+* oSymTable: a SymTable_T type with the cache enabled
+* pcKey: a character array (key). Must be null terminated.
+* uiCode: the hash code of pcKey
+
+Returns: the binding or NULL if such binding was not found. */
+static struct abind *SymTable_lookupCached(SymTable_T oSymTable, const char *pcKey, unsigned int uiCode) {
+    struct SymTable *symtable;
+    struct cache *entry;
+    struct abind *ptr;
+
+    symtable = oSymTable;
+    entry = &symtable->cache[SymTable_cacheSlot(symtable, uiCode)];
+    ptr = __atomic_load_n(&entry->bind, __ATOMIC_RELAXED);
+    if (ptr && __atomic_load_n(&entry->uiCode, __ATOMIC_RELAXED) == uiCode && !strcmp(ptr->key, pcKey)) {
+        return ptr;
+    }
+
+    for (ptr = symtable->array[uiCode % symtable->uiBuckets]; ptr; ptr = ptr->next) {
         if (!strcmp(ptr->key, pcKey)) {
-            return ptr->value;
+            __atomic_store_n(&entry->uiCode, uiCode, __ATOMIC_RELAXED);
+            __atomic_store_n(&entry->bind, ptr, __ATOMIC_RELAXED);
+            return ptr;
         }
-        ptr = ptr->next;
     }
     return NULL;
 }
 
 
-/* Removes a binding with key equal to pcKey.
+/* Removes pBind, a binding of oSymTable that is being freed, from the lookup
+cache.
 
-Asserts: if oSymTable and pcKey are not NULL at runtime.
+Parameters:
+* oSymTable: a SymTable_T type with the cache enabled
+* pBind: the binding */
+static void SymTable_uncache(SymTable_T oSymTable, struct abind *pBind) {
+    struct SymTable *symtable;
+    struct cache *entry;
+
+    symtable = oSymTable;
+    entry = &symtable->cache[SymTable_cacheSlot(symtable, SymTable_hashKey(pBind->key))];
+    if (entry->bind == pBind) {
+        entry->bind = NULL;
+    }
+}
+
+
+/* Enables a direct-mapped cache of uiEntries bindings that SymTable_get
+looks up before the bucket array, or disables it if uiEntries is 0. The
+number of entries is rounded up to a power of 2, at most MAX_CACHE. Each
+entry holds the binding last found by SymTable_get among the keys that map
+to it, so the hottest keys are found without walking their chains.
+
+Bindings never move when the bucket array is resized, so the cache stays
+valid. Removed bindings are cleared from it. Like the bucket array, the
+cache may be read by SymTable_get and SymTable_getBatch on several threads
+at once, even though a lookup may replace an entry (see struct cache).
+
+Asserts: if oSymTable is not NULL and not a snapshot at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* uiEntries: number of entries, 0 to disable the cache
+
+Returns: 1 on success, 0 if memory could not be allocated. In that case
+oSymTable keeps its previous cache, if any. */
+int SymTable_setCache(SymTable_T oSymTable, unsigned int uiEntries) {
+    struct SymTable *symtable;
+    struct cache *cache;
+    unsigned int uiSize;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(!symtable->snapshot);
+
+    cache = NULL;
+    uiSize = 0U;
+    if (uiEntries) {
+        for (uiSize = 1U; uiSize < uiEntries && uiSize < MAX_CACHE; uiSize *= 2) {
+        }
+        cache = calloc(uiSize, sizeof(struct cache));
+        if (!cache) {
+            return 0;
+        }
+    }
+    if (symtable->cache) {
+        free(symtable->cache);
+        symtable->uiBytes -= (symtable->uiCacheMask + 1) * sizeof(struct cache);
+    }
+    symtable->cache = cache;
+    symtable->uiCacheMask = uiSize ? uiSize - 1 : 0U;
+    symtable->uiBytes += uiSize * sizeof(struct cache);
+    return 1;
+}
+
+
+/* Sets the functions that oSymTable calls when it starts and stops holding a
+value. pfRetain is called with each value that is put in oSymTable.
+pfRelease is called with each value that leaves it: when SymTable_put
+replaces it, when its binding is removed and when oSymTable is freed. A
+table with only pfRelease takes ownership of its values, e.g. with free as
+release function. It then keeps a value that is put again for the same key
+without releasing it. Values already in oSymTable are released like the
+others.
+
+The callbacks must not modify oSymTable. A release callback called by
+SymTable_remove may read it.
+
+Asserts: if oSymTable is not NULL and not a snapshot at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pfRetain: function called with a value and pvExtra, or NULL
+* pfRelease: function called with a value and pvExtra, or NULL
+* pvExtra: a pointer to any value. Used by pfRetain and pfRelease. */
+void SymTable_setValueCallbacks(SymTable_T oSymTable,
+        void (*pfRetain)(void *pvValue, void *pvExtra),
+        void (*pfRelease)(void *pvValue, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTable *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(!symtable->snapshot);
+    symtable->pfRetain = pfRetain;
+    symtable->pfRelease = pfRelease;
+    symtable->pvCallbackExtra = (void *) pvExtra;
+}
+
+
+/* Unlinks a binding with key equal to pcKey from oSymTable and updates the
+table as if the binding was freed, except that the binding, its key and its
+value are left to the caller. The table may shrink.
 
 Parameters:
 * oSymTable: a SymTable_T type
 * pcKey: a character array (key). Must be null terminated.
 
-Returns: 1 if removal was successful, 0 if such binding was not found */
-int SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+Returns: the binding or NULL if such binding was not found */
+static struct abind *SymTable_detach(SymTable_T oSymTable, const char *pcKey) {
     struct abind *ptr, *ptr_prev;
     struct SymTable *symtable;
-    unsigned int uiHash;
+    unsigned int uiHash, uiBuckets;
 
     symtable = oSymTable;
-    assert(symtable);
-    assert(pcKey);
 
     /* search only the bucket that corresponds to the pcKey hash code */
     uiHash = SymTable_hash(symtable->uiBuckets, pcKey);
@@ -373,13 +1045,729 @@ int SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
         }
         
         symtable->uiBindings -= 1;
-        free(ptr->key);
+        symtable->uiBytes -= SymTable_bindSize(symtable, ptr->key);
+        if (symtable->sampling) {
+            SymTable_unsample(symtable, ptr);
+        }
+        if (symtable->cache) {
+            SymTable_uncache(symtable, ptr);
+        }
+
+        /* a failed shrink leaves the table as it is */
+        uiBuckets = SymTable_target(symtable);
+        if (uiBuckets != symtable->uiBuckets) {
+            SymTable_change(symtable, uiBuckets);
+        }
+        return ptr;
+    }
+    return NULL;
+}
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTable_remove(SymTable_T oSymTable, const char *pcKey) {
+    struct abind *ptr;
+    struct SymTable *symtable;
+    void *pvValue;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(!symtable->snapshot);
+    assert(pcKey);
+
+    ptr = SymTable_detach(symtable, pcKey);
+    if (!ptr) {
+        return 0;
+    }
+    pvValue = ptr->value;
+    free(ptr);
+
+    /* the table is consistent again, so the callback may use it */
+    if (symtable->pfRelease) {
+        (*symtable->pfRelease)(pvValue, symtable->pvCallbackExtra);
+    }
+    return 1;
+}
+
+
+/* Removes a binding with key equal to pcKey and gives its value, and
+optionally its key, to the caller. The key is found only once, unlike with
+SymTable_get followed by SymTable_remove. The value is not released: the
+reference that oSymTable held passes to the caller.
+
+A key copied by the table is moved to the start of the memory block of its
+binding, which is then returned instead of being freed. A key that may point
+inside the blob of oSymTable is copied from pcKey before the binding is
+removed, so that a failed allocation leaves oSymTable unchanged. Either way
+the caller frees the key.
+
+Asserts:
+1) if oSymTable is not NULL and not a snapshot at runtime.
+2) if pcKey is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pcKey: a character array (key). Must be null terminated.
+* ppvValue: set to the value of the binding. Can be NULL.
+* ppcKey: set to the key of the binding, to be freed with free. Can be NULL.
+
+Returns: 1 if the binding was found and removed, 0 if it was not found, -1
+if memory could not be allocated for the key. Unless 1 is returned,
+oSymTable, *ppvValue and *ppcKey are not modified. */
+int SymTable_take(SymTable_T oSymTable, const char *pcKey, void **ppvValue, char **ppcKey) {
+    struct abind *ptr;
+    struct SymTable *symtable;
+    char *pcCopy;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(!symtable->snapshot);
+    assert(pcKey);
+
+    /* only tables with a blob have keys that are not in their binding */
+    pcCopy = NULL;
+    if (ppcKey && symtable->pcBlob) {
+        pcCopy = malloc(strlen(pcKey) + 1);
+        if (!pcCopy) {
+            return -1;
+        }
+        strcpy(pcCopy, pcKey);
+    }
+
+    ptr = SymTable_detach(symtable, pcKey);
+    if (!ptr) {
+        free(pcCopy);
+        return 0;
+    }
+    if (ppvValue) {
+        *ppvValue = ptr->value;
+    }
+    if (!ppcKey) {
         free(ptr);
         return 1;
     }
-    return 0;
+    if (ptr->key == (char *) (ptr + 1)) {
+        free(pcCopy);
+        pcCopy = memmove(ptr, ptr->key, strlen(ptr->key) + 1);
+    }
+    else {
+        free(ptr);
+    }
+    *ppcKey = pcCopy;
+    return 1;
+}
+
+/* Sets the resize policy of oSymTable. The load factor is the number of
+bindings divided by the number of buckets.
+
+1) When the load factor reaches dMaxLoad, the number of buckets is multiplied
+by at least dGrowth, using the next sizes of BUCKARR.
+2) When the load factor drops below dMinLoad, the number of buckets is
+reduced. 0 disables shrinking.
+3) The bucket array never grows beyond what keeps the total memory of the
+table within uiMaxBytes, the table then uses longer chains. Bindings are
+always added. 0 means no limit.
+
+The default policy is dMinLoad = 0, dMaxLoad = 1, dGrowth = 1 and
+uiMaxBytes = 0. The new policy applies from the next SymTable_put or
+SymTable_remove.
+
+Asserts:
+1) if oSymTable is not NULL at runtime.
+2) if 0 <= dMinLoad < dMaxLoad and dGrowth >= 1 at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* dMinLoad: minimum load factor
+* dMaxLoad: maximum load factor
+* dGrowth: minimum growth factor of the number of buckets
+* uiMaxBytes: maximum number of bytes allocated by the table */
+void SymTable_setPolicy(SymTable_T oSymTable, double dMinLoad, double dMaxLoad, double dGrowth, size_t uiMaxBytes) {
+    struct SymTable *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(dMinLoad >= 0.0 && dMinLoad < dMaxLoad);
+    assert(dGrowth >= 1.0);
+
+    symtable->dMinLoad = dMinLoad;
+    symtable->dMaxLoad = dMaxLoad;
+    symtable->dGrowth = dGrowth;
+    symtable->uiMaxBytes = uiMaxBytes;
+}
+
+
+/* Returns the number of bytes allocated by oSymTable, including its bucket
+array, its bindings and the keys it owns.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type */
+size_t SymTable_getBytes(SymTable_T oSymTable) {
+    struct SymTable *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    return symtable->uiBytes;
+}
+
+
+/* Fills *pMemory with the bytes allocated by oSymTable for each of its parts.
+The sum is SymTable_getBytes(oSymTable).
+
+Asserts: if oSymTable and pMemory are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* pMemory: the result */
+void SymTable_getMemory(SymTable_T oSymTable, struct SymTable_memory *pMemory) {
+    struct SymTable *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pMemory);
+
+    pMemory->uiTable = sizeof(struct SymTable);
+    pMemory->uiBuckets = symtable->uiBuckets * sizeof(struct abind *);
+    pMemory->uiBindings = symtable->uiBindings * sizeof(struct abind);
+    if (symtable->snapshot) {
+        pMemory->uiBindings += sizeof(struct abind);
+    }
+    pMemory->uiSampling = symtable->sampling ? sizeof(struct sampling) : 0U;
+    pMemory->uiCache = symtable->cache ? (symtable->uiCacheMask + 1) * sizeof(struct cache) : 0U;
+    pMemory->uiKeys = symtable->uiBytes - pMemory->uiTable - pMemory->uiBuckets - pMemory->uiBindings -
+        pMemory->uiSampling - pMemory->uiCache;
+}
+
+
+/* Enables sampling of the successful SymTable_get calls of oSymTable, on
+average 1 in uiRate calls, or disables it if uiRate is 0. Sampled keys are
+counted in a count-min sketch that also tracks the SAMPLE_TOP hottest
+bindings, see SymTable_topKeys. Counts are halved every SKETCH_AGE samples,
+so they follow changes of the access pattern. Changing the rate of an
+enabled table keeps its counts.
+
+Readers on several threads may sample at the same time: the countdown is
+decremented atomically and one reader at a time counts a sample, the others
+skip theirs. SymTable_topKeys waits for the reader that is counting.
+
+Asserts: if oSymTable is not NULL and not a snapshot at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* uiRate: average number of calls per sample, 0 to disable sampling
+
+Returns: 1 on success, 0 if memory could not be allocated. In that case
+sampling stays disabled. */
+int SymTable_setSampling(SymTable_T oSymTable, unsigned int uiRate) {
+    struct SymTable *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(!symtable->snapshot);
+
+    if (!uiRate) {
+        if (symtable->sampling) {
+            free(symtable->sampling);
+            symtable->sampling = NULL;
+            symtable->uiBytes -= sizeof(struct sampling);
+        }
+        return 1;
+    }
+    if (!symtable->sampling) {
+        symtable->sampling = calloc(1, sizeof(struct sampling));
+        if (!symtable->sampling) {
+            return 0;
+        }
+        symtable->sampling->ulRandom = 2463534242UL;
+        symtable->uiBytes += sizeof(struct sampling);
+    }
+    symtable->sampling->uiRate = uiRate;
+    symtable->sampling->uiCountdown = uiRate;
+    return 1;
+}
+
+
+/* Counts one sample of pBind, a binding of oSymTable, and sets the number of
+calls until the next sample.
+
+Parameters:
+* oSymTable: a SymTable_T type with sampling enabled
+* pBind: the binding that was accessed */
+static void SymTable_sample(SymTable_T oSymTable, struct abind *pBind) {
+    struct sampling *sampling;
+    unsigned long ulHash, ulRandom;
+    unsigned int *counters[SKETCH_ROWS], uiMin, ui, uiLeast;
+    int row, col;
+
+    sampling = ((struct SymTable *) oSymTable)->sampling;
+
+    /* readers on other threads may sample at the same time. The sample of
+    a reader that finds the counts busy is skipped */
+    if (__atomic_exchange_n(&sampling->iBusy, 1, __ATOMIC_ACQUIRE)) {
+        __atomic_store_n(&sampling->uiCountdown, sampling->uiRate, __ATOMIC_RELAXED);
+        return;
+    }
+
+    /* xorshift, next sample after 1 to 2 * uiRate - 1 calls */
+    ulRandom = sampling->ulRandom;
+    ulRandom ^= (ulRandom << 13) & 0xFFFFFFFFUL;
+    ulRandom ^= ulRandom >> 17;
+    ulRandom ^= (ulRandom << 5) & 0xFFFFFFFFUL;
+    sampling->ulRandom = ulRandom;
+    __atomic_store_n(&sampling->uiCountdown, 1 + ulRandom % (2UL * sampling->uiRate - 1), __ATOMIC_RELAXED);
+
+    /* halve all counts so that old accesses fade out */
+    if (++sampling->uiSamples == SKETCH_AGE) {
+        sampling->uiSamples = 0U;
+        for (row = 0; row < SKETCH_ROWS; row++) {
+            for (col = 0; col < SKETCH_WIDTH; col++) {
+                sampling->sketch[row][col] >>= 1;
+            }
+        }
+        for (ui = 0U; ui < sampling->uiTop; ui++) {
+            sampling->auiTopCounts[ui] >>= 1;
+        }
+    }
+
+    /* conservative update: only the smallest counters of the key are
+    incremented, which keeps the overestimate of the other counters low */
+    ulHash = SymTable_hashKey(pBind->key);
+    ulHash ^= ulHash >> 16;
+    uiMin = (unsigned int) -1;
+    for (row = 0; row < SKETCH_ROWS; row++) {
+        col = (int) ((((ulHash * SKETCH_SEEDS[row]) & 0xFFFFFFFFUL) >> 16) & (SKETCH_WIDTH - 1));
+        counters[row] = &sampling->sketch[row][col];
+        if (*counters[row] < uiMin) {
+            uiMin = *counters[row];
+        }
+    }
+    for (row = 0; row < SKETCH_ROWS; row++) {
+        if (*counters[row] == uiMin) {
+            (*counters[row])++;
+        }
+    }
+    uiMin++;
+
+    /* update the binding if it is in top, otherwise replace the coldest
+    binding of top if pBind is hotter */
+    uiLeast = 0U;
+    for (ui = 0U; ui < sampling->uiTop && sampling->top[ui] != pBind; ui++) {
+        if (sampling->auiTopCounts[ui] < sampling->auiTopCounts[uiLeast]) {
+            uiLeast = ui;
+        }
+    }
+    if (ui < sampling->uiTop) {
+        sampling->auiTopCounts[ui] = uiMin;
+    }
+    else if (sampling->uiTop < SAMPLE_TOP) {
+        sampling->top[sampling->uiTop] = pBind;
+        sampling->auiTopCounts[sampling->uiTop++] = uiMin;
+    }
+    else if (sampling->auiTopCounts[uiLeast] < uiMin) {
+        sampling->top[uiLeast] = pBind;
+        sampling->auiTopCounts[uiLeast] = uiMin;
+    }
+    __atomic_store_n(&sampling->iBusy, 0, __ATOMIC_RELEASE);
+}
+
+
+/* Removes pBind, a binding of oSymTable that is being freed, from the
+hottest bindings.
+
+Parameters:
+* oSymTable: a SymTable_T type with sampling enabled
+* pBind: the binding */
+static void SymTable_unsample(SymTable_T oSymTable, struct abind *pBind) {
+    struct sampling *sampling;
+    unsigned int ui;
+
+    sampling = ((struct SymTable *) oSymTable)->sampling;
+    for (ui = 0U; ui < sampling->uiTop; ui++) {
+        if (sampling->top[ui] == pBind) {
+            sampling->uiTop--;
+            sampling->top[ui] = sampling->top[sampling->uiTop];
+            sampling->auiTopCounts[ui] = sampling->auiTopCounts[sampling->uiTop];
+            return;
+        }
+    }
 }
 
+
+/* Fills ppcKeys with the keys of up to uiMax of the hottest bindings of
+oSymTable, hottest first, and pulCounts with their estimated number of
+SymTable_get calls since sampling was enabled, with older calls weighing
+less. The keys remain valid until their bindings are removed.
+
+Asserts: if oSymTable, ppcKeys and pulCounts are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+* ppcKeys: array of at least uiMax keys
+* pulCounts: array of at least uiMax counts
+* uiMax: maximum number of keys
+
+Returns: the number of keys, at most SAMPLE_TOP. 0 if sampling is disabled. */
+unsigned int SymTable_topKeys(SymTable_T oSymTable, const char **ppcKeys, unsigned long *pulCounts,
+        unsigned int uiMax) {
+    struct SymTable *symtable;
+    struct sampling *sampling;
+    unsigned int auiOrder[SAMPLE_TOP], ui, uj, uiTmp;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(ppcKeys);
+    assert(pulCounts);
+
+    sampling = symtable->sampling;
+    if (!sampling) {
+        return 0U;
+    }
+
+    /* wait for a reader that is counting a sample */
+    while (__atomic_exchange_n(&sampling->iBusy, 1, __ATOMIC_ACQUIRE)) {
+    }
+
+    /* insertion sort of the positions of top by decreasing count */
+    for (ui = 0U; ui < sampling->uiTop; ui++) {
+        uiTmp = ui;
+        for (uj = ui; uj > 0U && sampling->auiTopCounts[auiOrder[uj - 1]] < sampling->auiTopCounts[uiTmp]; uj--) {
+            auiOrder[uj] = auiOrder[uj - 1];
+        }
+        auiOrder[uj] = uiTmp;
+    }
+    for (ui = 0U; ui < uiMax && ui < sampling->uiTop; ui++) {
+        ppcKeys[ui] = sampling->top[auiOrder[ui]]->key;
+        pulCounts[ui] = (unsigned long) sampling->auiTopCounts[auiOrder[ui]] * sampling->uiRate;
+    }
+    __atomic_store_n(&sampling->iBusy, 0, __ATOMIC_RELEASE);
+    return ui;
+}
+
+
+/* Creates a read-only snapshot of oSymTable. The snapshot has the same
+bindings and buckets as oSymTable at the time of the call and does not share
+any memory with it, therefore it can be read (SymTable_get, SymTable_contains,
+SymTable_map, ...) while oSymTable keeps changing. Values are shared because
+bindings do not own them. The snapshot gets the value callbacks of oSymTable
+and retains every value, which it releases when it is freed. If oSymTable
+has no retain function, the snapshot gets no callbacks at all, since it
+could not release values it did not retain. The snapshot must be freed with
+SymTable_free.
+
+Bindings and keys are copied into two contiguous arrays, so a writer only
+needs to block for the duration of the copy instead of a full scan.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTable_T type
+
+Returns: a SymTable_T type that cannot be modified, or NULL if memory could
+not be allocated */
+SymTable_T SymTable_snapshot(SymTable_T oSymTable) {
+    struct abind *ptr, *snap_bind, **snap_next;
+    struct SymTable *symtable, *snap;
+    char *snap_keys;
+    size_t uiKeysSize, uiKeyLen;
+    unsigned int ui;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    /* total size of the keys */
+    uiKeysSize = 0U;
+    for (ui = 0U; ui < symtable->uiBuckets; ui++) {
+        for (ptr = symtable->array[ui]; ptr; ptr = ptr->next) {
+            uiKeysSize += strlen(ptr->key) + 1;
+        }
+    }
+
+    snap = malloc(sizeof(struct SymTable));
+    if (!snap) {
+        return NULL;
+    }
+    snap->array = malloc(symtable->uiBuckets * sizeof(struct abind *));
+
+    /* allocate at least one byte so that an empty snapshot is not mistaken
+    for a regular table */
+    snap->snapshot = malloc((symtable->uiBindings + 1) * sizeof(struct abind));
+    snap_keys = malloc(uiKeysSize + 1);
+    if (!snap->array || !snap->snapshot || !snap_keys) {
+        free(snap_keys);
+        free(snap->snapshot);
+        free(snap->array);
+        free(snap);
+        return NULL;
+    }
+    snap->sampling = NULL;
+    snap->cache = NULL;
+    snap->uiCacheMask = 0U;
+    snap->pfRetain = symtable->pfRetain;
+    snap->pfRelease = symtable->pfRetain ? symtable->pfRelease : NULL;
+    snap->pvCallbackExtra = symtable->pvCallbackExtra;
+
+    snap->uiBindings = symtable->uiBindings;
+    snap->uiBuckets = symtable->uiBuckets;
+    snap->pcBlob = snap_keys;
+    snap->uiBlobSize = uiKeysSize + 1;
+    snap->dMinLoad = symtable->dMinLoad;
+    snap->dMaxLoad = symtable->dMaxLoad;
+    snap->dGrowth = symtable->dGrowth;
+    snap->uiMaxBytes = symtable->uiMaxBytes;
+    snap->uiBytes = sizeof(struct SymTable) + snap->uiBuckets * sizeof(struct abind *) +
+        (snap->uiBindings + 1) * sizeof(struct abind) + snap->uiBlobSize;
+
+    /* copy each bucket, keeping the order of its bindings */
+    snap_bind = snap->snapshot;
+    for (ui = 0U; ui < symtable->uiBuckets; ui++) {
+        snap_next = &snap->array[ui];
+        for (ptr = symtable->array[ui]; ptr; ptr = ptr->next) {
+            uiKeyLen = strlen(ptr->key) + 1;
+            memcpy(snap_keys, ptr->key, uiKeyLen);
+            snap_bind->key = snap_keys;
+            snap_bind->value = ptr->value;
+            if (snap->pfRetain) {
+                (*snap->pfRetain)(snap_bind->value, snap->pvCallbackExtra);
+            }
+            *snap_next = snap_bind;
+            snap_next = &snap_bind->next;
+            snap_keys += uiKeyLen;
+            snap_bind++;
+        }
+        *snap_next = NULL;
+    }
+
+    return (SymTable_T) snap;
+}
+
+
+/* Thread function of SymTable_buildParallel that computes the bucket of
+every input binding. Slices of the input are claimed one at a time.
+
+Parameters:
+* pvBuild: pointer to the struct build of the table */
+static void *SymTable_hashWorker(void *pvBuild) {
+    struct build *build;
+    unsigned int ui, uiSlice, uiEnd, uiSliceSize;
+
+    build = pvBuild;
+    uiSliceSize = build->uiCount / build->uiPartitions + 1;
+    for (;;) {
+        uiSlice = __atomic_fetch_add(&build->uiNextSlice, 1U, __ATOMIC_RELAXED);
+        if (uiSlice >= build->uiPartitions) {
+            return NULL;
+        }
+        uiEnd = (uiSlice + 1) * uiSliceSize;
+        if (uiEnd > build->uiCount) {
+            uiEnd = build->uiCount;
+        }
+        for (ui = uiSlice * uiSliceSize; ui < uiEnd; ui++) {
+            build->puiBucket[ui] = SymTable_hash(build->symtable->uiBuckets, build->ppcKeys[ui]);
+        }
+    }
+}
+
+
+/* Thread function of SymTable_buildParallel that creates the chains of the
+buckets. Partitions are claimed one at a time, so threads that finish early
+take over the remaining partitions of slower ones. A bucket belongs to
+exactly one partition, therefore chains are never shared between threads.
+
+Parameters:
+* pvBuild: pointer to the struct build of the table */
+static void *SymTable_chainWorker(void *pvBuild) {
+    struct build *build;
+    struct abind **array, *ptr;
+    unsigned int ui, uiIdx, uiPart, uiAdded;
+    size_t uiBytes;
+    const char *pcKey;
+
+    build = pvBuild;
+    array = build->symtable->array;
+    uiAdded = 0U;
+    uiBytes = 0U;
+    for (;;) {
+        uiPart = __atomic_fetch_add(&build->uiNext, 1U, __ATOMIC_RELAXED);
+        if (uiPart >= build->uiPartitions || __atomic_load_n(&build->iFailed, __ATOMIC_RELAXED)) {
+            break;
+        }
+        for (ui = build->puiStart[uiPart]; ui < build->puiStart[uiPart + 1]; ui++) {
+            uiIdx = build->puiOrder[ui];
+            pcKey = build->ppcKeys[uiIdx];
+
+            /* a repeated key updates the value, like SymTable_put */
+            for (ptr = array[build->puiBucket[uiIdx]]; ptr; ptr = ptr->next) {
+                if (!strcmp(ptr->key, pcKey)) {
+                    ptr->value = (void *) build->ppvValues[uiIdx];
+                    break;
+                }
+            }
+            if (!ptr) {
+                ptr = SymTable_newBind(pcKey, build->ppvValues[uiIdx], 1);
+                if (!ptr) {
+                    __atomic_store_n(&build->iFailed, 1, __ATOMIC_RELAXED);
+                    break;
+                }
+                ptr->next = array[build->puiBucket[uiIdx]];
+                array[build->puiBucket[uiIdx]] = ptr;
+                uiBytes += SymTable_bindSize(build->symtable, ptr->key);
+                uiAdded++;
+            }
+        }
+    }
+    __atomic_fetch_add(&build->uiAdded, uiAdded, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&build->uiBytes, uiBytes, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+
+/* Runs pfWorker on uiThreads threads, the calling thread being one of them,
+and waits for all of them. Threads that cannot be created are skipped, the
+remaining ones then do their work, or only the calling thread if there is
+no memory for the thread handles.
+
+Parameters:
+* pfWorker: thread function
+* pvBuild: argument of pfWorker
+* uiThreads: number of threads */
+static void SymTable_runWorkers(void *(*pfWorker)(void *), void *pvBuild, unsigned int uiThreads) {
+    pthread_t *threads;
+    unsigned int ui, uiCreated;
+
+    threads = malloc(uiThreads * sizeof(pthread_t));
+    uiCreated = 0U;
+    for (ui = 1U; threads && ui < uiThreads; ui++) {
+        if (!pthread_create(&threads[uiCreated], NULL, pfWorker, pvBuild)) {
+            uiCreated++;
+        }
+    }
+    pfWorker(pvBuild);
+    for (ui = 0U; ui < uiCreated; ui++) {
+        pthread_join(threads[ui], NULL);
+    }
+    free(threads);
+}
+
+
+/* Creates a SymTable struct with the bindings (ppcKeys[i], ppvValues[i]),
+using uiThreads threads. The result is the same as calling SymTable_put for
+each binding in order on a new table, a key that appears more than once is
+bound to its last value.
+
+The input is partitioned by bucket range. Threads first compute the buckets
+of all keys, then claim partitions one at a time and create the chains of
+their buckets directly in the bucket array of the table.
+
+Asserts: if ppcKeys and ppvValues are not NULL at runtime.
+
+Parameters:
+* ppcKeys: array of uiCount keys. Each must be null terminated.
+* ppvValues: array of uiCount pointers to any value
+* uiCount: number of bindings
+* uiThreads: number of threads. 0 is the same as 1. At most uiCount and
+MAX_BUILD_THREADS threads are used.
+
+Returns: a SymTable_T type or NULL if memory could not be allocated */
+SymTable_T SymTable_buildParallel(const char **ppcKeys, const void **ppvValues, unsigned int uiCount, unsigned int uiThreads) {
+    struct SymTable *symtable;
+    struct build build;
+    unsigned int ui, uiPart, uiBuckets;
+    int idx = 0;
+
+    assert(ppcKeys);
+    assert(ppvValues);
+    if (uiThreads > uiCount) {
+        uiThreads = uiCount;
+    }
+    if (uiThreads > MAX_BUILD_THREADS) {
+        uiThreads = MAX_BUILD_THREADS;
+    }
+    if (!uiThreads) {
+        uiThreads = 1U;
+    }
+
+    /* the number of buckets SymTable_put would reach for uiCount keys */
+    symtable = SymTable_tryNew();
+    if (!symtable) {
+        return NULL;
+    }
+    uiBuckets = BUCKARR[0];
+    while (uiCount > uiBuckets && uiBuckets != MAX_BUCKETS) {
+        uiBuckets = BUCKARR[++idx];
+    }
+    if (uiBuckets != symtable->uiBuckets && !SymTable_change(symtable, uiBuckets)) {
+        SymTable_free(symtable);
+        return NULL;
+    }
+
+    build.ppcKeys = ppcKeys;
+    build.ppvValues = ppvValues;
+    build.uiCount = uiCount;
+    build.symtable = symtable;
+    build.uiPartitions = uiThreads * BUILD_PARTITIONS;
+    if (build.uiPartitions > uiBuckets) {
+        build.uiPartitions = uiBuckets;
+    }
+    build.uiNext = 0U;
+    build.uiNextSlice = 0U;
+    build.uiAdded = 0U;
+    build.uiBytes = 0U;
+    build.iFailed = 0;
+    build.puiBucket = malloc((uiCount + 1) * sizeof(unsigned int));
+    build.puiOrder = malloc((uiCount + 1) * sizeof(unsigned int));
+    build.puiStart = calloc(build.uiPartitions + 1, sizeof(unsigned int));
+    if (!build.puiBucket || !build.puiOrder || !build.puiStart) {
+        build.iFailed = 1;
+    }
+    else {
+        SymTable_runWorkers(SymTable_hashWorker, &build, uiThreads);
+
+        /* counting sort of the input positions by partition */
+        for (ui = 0U; ui < uiCount; ui++) {
+            uiPart = (unsigned long) build.puiBucket[ui] * build.uiPartitions / uiBuckets;
+            build.puiStart[uiPart + 1]++;
+        }
+        for (ui = 0U; ui < build.uiPartitions; ui++) {
+            build.puiStart[ui + 1] += build.puiStart[ui];
+        }
+        for (ui = 0U; ui < uiCount; ui++) {
+            uiPart = (unsigned long) build.puiBucket[ui] * build.uiPartitions / uiBuckets;
+            build.puiOrder[build.puiStart[uiPart]++] = ui;
+        }
+        for (ui = build.uiPartitions; ui > 0U; ui--) {
+            build.puiStart[ui] = build.puiStart[ui - 1];
+        }
+        build.puiStart[0] = 0U;
+
+        SymTable_runWorkers(SymTable_chainWorker, &build, uiThreads);
+    }
+    free(build.puiBucket);
+    free(build.puiOrder);
+    free(build.puiStart);
+
+    /* the bindings created so far are in their chains, so they are freed
+    with the table */
+    symtable->uiBindings = build.uiAdded;
+    symtable->uiBytes += build.uiBytes;
+    if (build.iFailed) {
+        SymTable_free(symtable);
+        return NULL;
+    }
+    return (SymTable_T) symtable;
+}
+
+
 /* Prints basic information about the hashtable:
 1) Max bindings in a bucket.
 2) Min binding in a bucket.
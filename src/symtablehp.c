@@ -0,0 +1,638 @@
+/* Library for creating and using thread-safe Symbol tables.
+
+Hash array based implementation with linked lists for resolving conflicts.
+Writers are serialized by a mutex. Readers never lock: they protect the
+bucket array and the bindings they visit with hazard pointers, and memory
+that writers unlink is freed only when no reader protects it.
+
+A resize builds a new bucket array with copies of the bindings while
+readers keep using the old one, then publishes it atomically. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include "symtableconc.h"
+
+#define HASH_MULTIPLIER 65599
+#define MAX_BUCKETS 65521
+#define MIN_BUCKETS 519
+#define HAZARDS 3       /* hazard pointers per reader: array, 2 bindings */
+#define RETIRE_MIN 64   /* retired pointers before a reclamation pass */
+
+#define LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST)
+
+static unsigned const BUCKARR[] = {MIN_BUCKETS, 1021, 2053, 4093, 8191, 16381, 32771, MAX_BUCKETS};
+
+
+/* Struct that represents a binding. The key is stored right after the
+struct. iRemoved is set before the binding is unlinked, so that readers
+standing on it know that its next pointer is no longer reliable. */
+struct cbind {
+    char *key;
+    void *value;
+    struct cbind *next;
+    int iRemoved;
+};
+
+
+/* Struct that represents a bucket array. The buckets are stored right after
+the struct. */
+struct carray {
+    unsigned int uiBuckets;
+    struct cbind **buckets;
+};
+
+
+/* Struct that represents the hazard pointers of a reader. A record is used
+by one reader at a time and is never freed before the table. */
+struct hazard {
+    void *hp[HAZARDS];
+    int iActive;
+    struct hazard *next;
+};
+
+
+/* Struct that represents a thread-safe symbol table.
+lock: serializes the writers
+current: the bucket array used by new operations
+uiBindings: number of bindings
+hazards: list of hazard pointer records
+retired: pointers that were unlinked but may still be read
+uiRetired: number of retired pointers
+uiRetiredMax: capacity of retired */
+struct SymTableConc {
+    pthread_mutex_t lock;
+    struct carray *current;
+    unsigned int uiBindings;
+    struct hazard *hazards;
+    void **retired;
+    unsigned int uiRetired;
+    unsigned int uiRetiredMax;
+};
+
+
+/* Computes the hash code for pcKey, an unsigned int in [0 : uiBuckets-1]
+
+Parameters:
+* uiBuckets: number of buckets
+* pcKey: character array (key). Must be null terminated. */
+static unsigned int SymTableConc_hash(unsigned int uiBuckets, const char *pcKey) {
+    size_t ui;
+    unsigned int uiHash;
+
+    uiHash = 0U;
+    for (ui = 0U; pcKey[ui] != '\0'; ui++) {
+        uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+    }
+    return uiHash % uiBuckets;
+}
+
+
+/* Creates an empty bucket array with uiBuckets buckets.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct carray *SymTableConc_newArray(unsigned int uiBuckets) {
+    struct carray *arr;
+    unsigned int ui;
+
+    arr = malloc(sizeof(struct carray) + uiBuckets * sizeof(struct cbind *));
+    assert(arr);
+    arr->uiBuckets = uiBuckets;
+    arr->buckets = (struct cbind **) (arr + 1);
+    for (ui = 0U; ui < uiBuckets; ui++) {
+        arr->buckets[ui] = NULL;
+    }
+    return arr;
+}
+
+
+/* Creates a binding with a copy of pcKey.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct cbind *SymTableConc_newBind(const char *pcKey, const void *pvValue) {
+    struct cbind *bind;
+
+    bind = malloc(sizeof(struct cbind) + strlen(pcKey) + 1);
+    assert(bind);
+    bind->key = (char *) (bind + 1);
+    strcpy(bind->key, pcKey);
+    bind->value = (void *) pvValue;
+    bind->next = NULL;
+    bind->iRemoved = 0;
+    return bind;
+}
+
+
+/* Returns a hazard pointer record that is not used by any other reader.
+A new record is added to the table if all of them are used.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct hazard *SymTableConc_acquire(struct SymTableConc *symtable) {
+    struct hazard *rec, *head;
+    int iFree;
+
+    for (rec = LOAD(&symtable->hazards); rec; rec = rec->next) {
+        iFree = 0;
+        if (!LOAD(&rec->iActive) &&
+                __atomic_compare_exchange_n(&rec->iActive, &iFree, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            return rec;
+        }
+    }
+
+    rec = calloc(1, sizeof(struct hazard));
+    assert(rec);
+    rec->iActive = 1;
+    head = LOAD(&symtable->hazards);
+    do {
+        rec->next = head;
+    } while (!__atomic_compare_exchange_n(&symtable->hazards, &head, rec, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+    return rec;
+}
+
+
+/* Clears the hazard pointers of rec and makes it available to other readers. */
+static void SymTableConc_release(struct hazard *rec) {
+    int i;
+
+    for (i = 0; i < HAZARDS; i++) {
+        STORE(&rec->hp[i], NULL);
+    }
+    STORE(&rec->iActive, 0);
+}
+
+
+/* Frees every retired pointer that is not protected by a hazard pointer.
+Must be called by a writer. */
+static void SymTableConc_reclaim(struct SymTableConc *symtable) {
+    struct hazard *rec;
+    unsigned int ui, uiKept;
+    int i, iProtected;
+
+    uiKept = 0U;
+    for (ui = 0U; ui < symtable->uiRetired; ui++) {
+        iProtected = 0;
+        for (rec = LOAD(&symtable->hazards); rec && !iProtected; rec = rec->next) {
+            for (i = 0; i < HAZARDS; i++) {
+                if (LOAD(&rec->hp[i]) == symtable->retired[ui]) {
+                    iProtected = 1;
+                    break;
+                }
+            }
+        }
+        if (iProtected) {
+            symtable->retired[uiKept++] = symtable->retired[ui];
+        }
+        else {
+            free(symtable->retired[ui]);
+        }
+    }
+    symtable->uiRetired = uiKept;
+}
+
+
+/* Adds pvPtr to the retired pointers of symtable. It is freed by a later
+reclamation pass. Must be called by a writer.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static void SymTableConc_retire(struct SymTableConc *symtable, void *pvPtr) {
+    if (symtable->uiRetired == symtable->uiRetiredMax) {
+        SymTableConc_reclaim(symtable);
+    }
+    if (symtable->uiRetired == symtable->uiRetiredMax) {
+        symtable->uiRetiredMax *= 2;
+        symtable->retired = realloc(symtable->retired, symtable->uiRetiredMax * sizeof(void *));
+        assert(symtable->retired);
+    }
+    symtable->retired[symtable->uiRetired++] = pvPtr;
+}
+
+
+/* Replaces the bucket array of symtable with a new one that has uiBuckets
+buckets and copies of all bindings. Readers can keep using the old array
+until they notice the change. Must be called by a writer.
+
+Asserts: if necessary memory was allocated succesfully at runtime. */
+static void SymTableConc_change(struct SymTableConc *symtable, unsigned int uiBuckets) {
+    struct carray *old_arr, *new_arr;
+    struct cbind *ptr, *ptr_next, *new_bind;
+    unsigned int ui, uiHash;
+
+    old_arr = symtable->current;
+    new_arr = SymTableConc_newArray(uiBuckets);
+    for (ui = 0U; ui < old_arr->uiBuckets; ui++) {
+        for (ptr = old_arr->buckets[ui]; ptr; ptr = ptr->next) {
+            new_bind = SymTableConc_newBind(ptr->key, LOAD(&ptr->value));
+            uiHash = SymTableConc_hash(uiBuckets, new_bind->key);
+            new_bind->next = new_arr->buckets[uiHash];
+            new_arr->buckets[uiHash] = new_bind;
+        }
+    }
+    STORE(&symtable->current, new_arr);
+
+    /* readers that are still on the old bindings must restart */
+    for (ui = 0U; ui < old_arr->uiBuckets; ui++) {
+        for (ptr = old_arr->buckets[ui]; ptr; ptr = ptr->next) {
+            STORE(&ptr->iRemoved, 1);
+        }
+    }
+    for (ui = 0U; ui < old_arr->uiBuckets; ui++) {
+        for (ptr = old_arr->buckets[ui]; ptr; ptr = ptr_next) {
+            ptr_next = ptr->next;
+            SymTableConc_retire(symtable, ptr);
+        }
+    }
+    SymTableConc_retire(symtable, old_arr);
+}
+
+
+/* Finds in symtable a binding with key equal to pcKey without locking.
+rec must be a hazard pointer record acquired by the caller. The binding
+stays protected until rec is released.
+
+Returns: the binding or NULL if such binding was not found. */
+static struct cbind *SymTableConc_find(struct SymTableConc *symtable, struct hazard *rec, const char *pcKey) {
+    struct carray *arr;
+    struct cbind *ptr, *ptr_next;
+    unsigned int uiHash;
+    int iSlot;
+
+    for (;;) {
+        /* protect the bucket array and the first binding of the bucket */
+        arr = LOAD(&symtable->current);
+        STORE(&rec->hp[0], arr);
+        if (LOAD(&symtable->current) != arr) {
+            continue;
+        }
+        uiHash = SymTableConc_hash(arr->uiBuckets, pcKey);
+        ptr = LOAD(&arr->buckets[uiHash]);
+        STORE(&rec->hp[1], ptr);
+        if (LOAD(&arr->buckets[uiHash]) != ptr || LOAD(&symtable->current) != arr) {
+            continue;
+        }
+
+        /* each step protects the next binding in the slot not used by the
+        current one, then checks that it is still reachable */
+        iSlot = 1;
+        while (ptr) {
+            if (!strcmp(ptr->key, pcKey)) {
+                return ptr;
+            }
+            ptr_next = LOAD(&ptr->next);
+            iSlot = 3 - iSlot;
+            STORE(&rec->hp[iSlot], ptr_next);
+            if (LOAD(&ptr->next) != ptr_next || LOAD(&ptr->iRemoved)) {
+                break;
+            }
+            ptr = ptr_next;
+        }
+        if (!ptr) {
+            return NULL;
+        }
+    }
+}
+
+
+/* Finds in symtable a binding with key equal to pcKey. Must be called by a
+writer.
+
+Returns: the binding or NULL if such binding was not found. */
+static struct cbind *SymTableConc_lookup(struct SymTableConc *symtable, const char *pcKey) {
+    struct cbind *ptr;
+
+    ptr = symtable->current->buckets[SymTableConc_hash(symtable->current->uiBuckets, pcKey)];
+    for (; ptr; ptr = ptr->next) {
+        if (!strcmp(ptr->key, pcKey)) {
+            return ptr;
+        }
+    }
+    return NULL;
+}
+
+
+/* Inserts a new binding for a key that does not exist in symtable, growing
+the bucket array first if the table is full. Must be called by a writer.
+
+Asserts: if necessary memory was allocated succesfully at runtime. */
+static void SymTableConc_insert(struct SymTableConc *symtable, const char *pcKey, const void *pvValue) {
+    struct cbind *new_bind;
+    struct carray *arr;
+    unsigned int uiHash, uiBuckets;
+    int idx = 0;
+
+    /* find if #buckets need to increase, if so, call SymTableConc_change */
+    arr = symtable->current;
+    uiBuckets = arr->uiBuckets;
+    while ((symtable->uiBindings >= uiBuckets) && (uiBuckets != MAX_BUCKETS)) {
+        uiBuckets = BUCKARR[++idx];
+    }
+    if (uiBuckets != arr->uiBuckets) {
+        SymTableConc_change(symtable, uiBuckets);
+        arr = symtable->current;
+    }
+
+    /* the binding is complete before it becomes visible to readers */
+    new_bind = SymTableConc_newBind(pcKey, pvValue);
+    uiHash = SymTableConc_hash(arr->uiBuckets, pcKey);
+    new_bind->next = arr->buckets[uiHash];
+    STORE(&arr->buckets[uiHash], new_bind);
+    STORE(&symtable->uiBindings, symtable->uiBindings + 1);
+}
+
+
+/* Creates a SymTableConc struct with no bindings and MIN_BUCKETS number of
+buckets.
+
+Asserts: if memory was allocated succesfully at runtime. */
+SymTableConc_T SymTableConc_new(void) {
+    struct SymTableConc *symtable;
+
+    symtable = malloc(sizeof(struct SymTableConc));
+    assert(symtable);
+    pthread_mutex_init(&symtable->lock, NULL);
+    symtable->current = SymTableConc_newArray(MIN_BUCKETS);
+    symtable->uiBindings = 0U;
+    symtable->hazards = NULL;
+    symtable->uiRetired = 0U;
+    symtable->uiRetiredMax = RETIRE_MIN;
+    symtable->retired = malloc(RETIRE_MIN * sizeof(void *));
+    assert(symtable->retired);
+    return (SymTableConc_T) symtable;
+}
+
+
+/* Frees all memory used by oSymTable.
+
+Parameters:
+* oSymTable: a SymTableConc_T type */
+void SymTableConc_free(SymTableConc_T oSymTable) {
+    struct SymTableConc *symtable;
+    struct cbind *ptr, *ptr_next;
+    struct hazard *rec, *rec_next;
+    unsigned int ui;
+
+    symtable = oSymTable;
+    if (!symtable) {
+        return;
+    }
+    for (ui = 0U; ui < symtable->current->uiBuckets; ui++) {
+        for (ptr = symtable->current->buckets[ui]; ptr; ptr = ptr_next) {
+            ptr_next = ptr->next;
+            free(ptr);
+        }
+    }
+    free(symtable->current);
+    for (ui = 0U; ui < symtable->uiRetired; ui++) {
+        free(symtable->retired[ui]);
+    }
+    free(symtable->retired);
+    for (rec = symtable->hazards; rec; rec = rec_next) {
+        rec_next = rec->next;
+        free(rec);
+    }
+    pthread_mutex_destroy(&symtable->lock);
+    free(symtable);
+}
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type */
+unsigned int SymTableConc_getLength(SymTableConc_T oSymTable) {
+    struct SymTableConc *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    return LOAD(&symtable->uiBindings);
+}
+
+
+/* Creates a new binding for oSymTable from a given pcKey and pvValue.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value */
+void SymTableConc_put(SymTableConc_T oSymTable, const char *pcKey, const void *pvValue) {
+    struct SymTableConc *symtable;
+    struct cbind *ptr;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    pthread_mutex_lock(&symtable->lock);
+    ptr = SymTableConc_lookup(symtable, pcKey);
+    if (ptr) {
+        STORE(&ptr->value, (void *) pvValue);
+    }
+    else {
+        SymTableConc_insert(symtable, pcKey, pvValue);
+    }
+    pthread_mutex_unlock(&symtable->lock);
+}
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTableConc_remove(SymTableConc_T oSymTable, const char *pcKey) {
+    struct SymTableConc *symtable;
+    struct cbind *ptr, **link;
+    struct carray *arr;
+    unsigned int uiHash;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    pthread_mutex_lock(&symtable->lock);
+    arr = symtable->current;
+    uiHash = SymTableConc_hash(arr->uiBuckets, pcKey);
+    for (link = &arr->buckets[uiHash]; (ptr = *link); link = &ptr->next) {
+        if (!strcmp(ptr->key, pcKey)) {
+
+            /* mark before unlinking, see SymTableConc_find */
+            STORE(&ptr->iRemoved, 1);
+            STORE(link, ptr->next);
+            STORE(&symtable->uiBindings, symtable->uiBindings - 1);
+            SymTableConc_retire(symtable, ptr);
+            pthread_mutex_unlock(&symtable->lock);
+            return 1;
+        }
+    }
+    pthread_mutex_unlock(&symtable->lock);
+    return 0;
+}
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableConc_contains(SymTableConc_T oSymTable, const char *pcKey) {
+    struct SymTableConc *symtable;
+    struct hazard *rec;
+    int iFound;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    rec = SymTableConc_acquire(symtable);
+    iFound = SymTableConc_find(symtable, rec, pcKey) != NULL;
+    SymTableConc_release(rec);
+    return iFound;
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTableConc_get(SymTableConc_T oSymTable, const char *pcKey) {
+    struct SymTableConc *symtable;
+    struct hazard *rec;
+    struct cbind *ptr;
+    void *pvValue;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    rec = SymTableConc_acquire(symtable);
+    ptr = SymTableConc_find(symtable, rec, pcKey);
+    pvValue = ptr ? LOAD(&ptr->value) : NULL;
+    SymTableConc_release(rec);
+    return pvValue;
+}
+
+
+/* Adds lDelta to the value of the binding with key equal to pcKey, as one
+atomic step. The value is used as a counter. If pcKey does not exist, a
+binding with count lDelta is created.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* lDelta: number to add, can be negative
+
+Returns: the count after the addition */
+long SymTableConc_atomicAdd(SymTableConc_T oSymTable, const char *pcKey, long lDelta) {
+    struct SymTableConc *symtable;
+    struct cbind *ptr;
+    long lCount;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    /* a resize copies the values of the bindings, so the value is written
+    only by the writer */
+    pthread_mutex_lock(&symtable->lock);
+    ptr = SymTableConc_lookup(symtable, pcKey);
+    if (ptr) {
+        lCount = (long) (size_t) ptr->value + lDelta;
+        STORE(&ptr->value, (void *) (size_t) lCount);
+    }
+    else {
+        lCount = lDelta;
+        SymTableConc_insert(symtable, pcKey, (void *) (size_t) lCount);
+    }
+    pthread_mutex_unlock(&symtable->lock);
+    return lCount;
+}
+
+
+/* Sets the value of the binding with key equal to pcKey to pvValue, only if
+its value is pvExpected, as one atomic step.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvExpected: the value the binding must have
+* pvValue: the new value
+
+Returns: 1 if the value was replaced, 0 if such binding was not found or
+its value was not pvExpected */
+int SymTableConc_compareAndSwap(SymTableConc_T oSymTable, const char *pcKey,
+        const void *pvExpected, const void *pvValue) {
+    struct SymTableConc *symtable;
+    struct cbind *ptr;
+    int iSwapped;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    pthread_mutex_lock(&symtable->lock);
+    ptr = SymTableConc_lookup(symtable, pcKey);
+    iSwapped = 0;
+    if (ptr && ptr->value == pvExpected) {
+        STORE(&ptr->value, (void *) pvValue);
+        iSwapped = 1;
+    }
+    pthread_mutex_unlock(&symtable->lock);
+    return iSwapped;
+}
+
+
+/* Applies function pfApply to every binding in oSymTable.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableConc_map(SymTableConc_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTableConc *symtable;
+    struct cbind *ptr;
+    unsigned int ui;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pfApply);
+
+    pthread_mutex_lock(&symtable->lock);
+    for (ui = 0U; ui < symtable->current->uiBuckets; ui++) {
+        for (ptr = symtable->current->buckets[ui]; ptr; ptr = ptr->next) {
+            pfApply(ptr->key, ptr->value, (void *) pvExtra);
+        }
+    }
+    pthread_mutex_unlock(&symtable->lock);
+}
@@ -0,0 +1,111 @@
+/* Library for creating and using persistent (immutable) Symbol tables.
+
+Every modification returns a new version of the table and leaves the
+original one unchanged. Versions share most of their memory.
+
+Different versions can be used, modified and freed by different threads at
+the same time, even when one was derived from the other. A single version
+can be read by many threads at the same time, but must not be freed while
+another thread uses it. */
+
+#ifndef SYMTABLEPERS_INCLUDE
+#define SYMTABLEPERS_INCLUDE
+
+#include <stdio.h>
+
+typedef void* SymTablePers_T;
+
+
+/* Creates an empty SymTablePers version.
+
+Asserts: if memory was allocated succesfully at runtime. */
+SymTablePers_T SymTablePers_new(void);
+
+
+/* Frees the memory used by oSymTable that is not shared with other versions.
+Other versions are not affected.
+
+Parameters:
+* oSymTable: a SymTablePers_T type */
+void SymTablePers_free(SymTablePers_T oSymTable);
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type */
+unsigned int SymTablePers_getLength(SymTablePers_T oSymTable);
+
+
+/* Creates a new version of oSymTable that has a binding from pcKey to pvValue.
+If pcKey exists, the new version has its value updated. oSymTable is not
+modified and must still be freed with SymTablePers_free.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value
+
+Returns: the new version */
+SymTablePers_T SymTablePers_put(SymTablePers_T oSymTable, const char *pcKey, const void *pvValue);
+
+
+/* Creates a new version of oSymTable that has no binding with key equal to
+pcKey. oSymTable is not modified and must still be freed with
+SymTablePers_free.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: the new version */
+SymTablePers_T SymTablePers_remove(SymTablePers_T oSymTable, const char *pcKey);
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTablePers_contains(SymTablePers_T oSymTable, const char *pcKey);
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTablePers_get(SymTablePers_T oSymTable, const char *pcKey);
+
+
+/* Applies function pfApply to every binding in oSymTable.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTablePers_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTablePers_map(SymTablePers_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra);
+
+#endif
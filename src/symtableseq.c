@@ -0,0 +1,700 @@
+/* Library for creating and using thread-safe Symbol tables.
+
+Hash array based implementation with linked lists for resolving conflicts.
+The buckets are divided in groups of GROUP_BUCKETS, and each group has a
+sequence counter and a spinlock. Writers lock the group of their bucket and
+make the counter odd while they change it, so writers of different groups
+run in parallel. Readers never write shared memory: they read the counter,
+walk the chain and return only if the counter has not changed, otherwise
+they walk it again.
+
+A reader may therefore stand on a binding that is being removed. Bindings
+are never freed before the table: a removed binding is kept in a free list
+of its size class and reused by a later insert, so whatever a reader
+follows is still a binding of the table. The key of a binding has a
+capacity that depends on its size class and the last byte of that capacity
+is always '\0', so comparing a key that is being overwritten never reads
+past the binding. Such a comparison may give any result, but the counter of
+the group has changed, so it is discarded.
+
+A resize locks all groups, moves the bindings to a new bucket array and
+publishes it. The counters of the old groups stay odd, which sends readers
+and writers still using the old array to the new one. Old arrays are kept
+until the table is freed, together they are smaller than the current one. */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include "symtableconc.h"
+
+#define HASH_MULTIPLIER 65599
+#define MAX_BUCKETS 65521
+#define MIN_BUCKETS 519
+#define GROUP_BUCKETS 64    /* buckets per sequence counter and spinlock */
+#define CACHE_LINE 64       /* size of a group, so that groups do not share cache lines */
+#define SPINS 64            /* failed attempts before a spinning thread yields */
+#define KEY_MIN 16          /* key capacity of the smallest size class */
+#define NUM_CLASSES 24      /* size classes, each doubles the key capacity */
+
+#define LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST)
+
+static unsigned const BUCKARR[] = {MIN_BUCKETS, 1021, 2053, 4093, 8191, 16381, 32771, MAX_BUCKETS};
+
+
+/* Struct that represents a binding. The key is stored right after the
+struct, in KEY_MIN << uiClass bytes.
+uiCode: full hash code of the key, so that a resize does not hash again */
+struct sbind {
+    char *key;
+    void *value;
+    struct sbind *next;
+    unsigned int uiCode;
+    unsigned int uiClass;
+};
+
+
+/* Struct that represents a group of buckets.
+uiSeq: sequence counter, odd while a writer changes the group and forever
+once the bucket array is replaced
+iLock: spinlock of the writers, 1 if taken */
+struct group {
+    unsigned int uiSeq;
+    int iLock;
+    char acPad[CACHE_LINE - sizeof(unsigned int) - sizeof(int)];
+};
+
+
+/* Struct that represents a bucket array. The groups and the buckets are
+stored right after the struct.
+older: the previous bucket array, kept until the table is freed */
+struct sarray {
+    unsigned int uiBuckets;
+    unsigned int uiGroups;
+    struct group *groups;
+    struct sbind **buckets;
+    struct sarray *older;
+};
+
+
+/* Struct that represents a thread-safe symbol table.
+current: the bucket array used by new operations
+uiBindings: number of bindings
+resize_lock: serializes resizes and SymTableConc_map
+pool_lock: protects pool
+pool: free list of removed bindings of each size class */
+struct SymTableConc {
+    struct sarray *current;
+    unsigned int uiBindings;
+    pthread_mutex_t resize_lock;
+    pthread_mutex_t pool_lock;
+    struct sbind *pool[NUM_CLASSES];
+};
+
+
+/* Computes the full hash code for pcKey.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+static unsigned int SymTableConc_hash(const char *pcKey) {
+    size_t ui;
+    unsigned int uiHash;
+
+    uiHash = 0U;
+    for (ui = 0U; pcKey[ui] != '\0'; ui++) {
+        uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+    }
+    return uiHash;
+}
+
+
+/* Creates an empty bucket array with uiBuckets buckets.
+
+Asserts: if memory was allocated succesfully at runtime. */
+static struct sarray *SymTableConc_newArray(unsigned int uiBuckets) {
+    struct sarray *arr;
+    unsigned int ui, uiGroups;
+
+    /* the groups come first, so they stay aligned */
+    uiGroups = (uiBuckets + GROUP_BUCKETS - 1) / GROUP_BUCKETS;
+    arr = malloc(sizeof(struct sarray) + CACHE_LINE + uiGroups * sizeof(struct group) +
+        uiBuckets * sizeof(struct sbind *));
+    assert(arr);
+    arr->uiBuckets = uiBuckets;
+    arr->uiGroups = uiGroups;
+    arr->groups = (struct group *) ((char *) arr +
+        (sizeof(struct sarray) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE);
+    arr->buckets = (struct sbind **) (arr->groups + uiGroups);
+    arr->older = NULL;
+    for (ui = 0U; ui < uiGroups; ui++) {
+        arr->groups[ui].uiSeq = 0U;
+        arr->groups[ui].iLock = 0;
+    }
+    for (ui = 0U; ui < uiBuckets; ui++) {
+        arr->buckets[ui] = NULL;
+    }
+    return arr;
+}
+
+
+/* Creates a binding with a copy of pcKey, reusing a removed binding of the
+same size class if there is one.
+
+Asserts:
+1) if pcKey fits in the largest size class at runtime.
+2) if memory was allocated succesfully at runtime. */
+static struct sbind *SymTableConc_newBind(struct SymTableConc *symtable, const char *pcKey,
+        unsigned int uiCode, const void *pvValue) {
+    struct sbind *bind;
+    size_t uiLen;
+    unsigned int uiClass;
+
+    uiLen = strlen(pcKey) + 1;
+    for (uiClass = 0U; uiClass < NUM_CLASSES && ((size_t) KEY_MIN << uiClass) < uiLen; uiClass++) {
+    }
+    assert(uiClass < NUM_CLASSES);
+
+    pthread_mutex_lock(&symtable->pool_lock);
+    bind = symtable->pool[uiClass];
+    if (bind) {
+        symtable->pool[uiClass] = bind->next;
+    }
+    pthread_mutex_unlock(&symtable->pool_lock);
+
+    if (!bind) {
+        bind = malloc(sizeof(struct sbind) + ((size_t) KEY_MIN << uiClass));
+        assert(bind);
+        bind->key = (char *) (bind + 1);
+        bind->uiClass = uiClass;
+        bind->key[((size_t) KEY_MIN << uiClass) - 1] = '\0';
+    }
+    memcpy(bind->key, pcKey, uiLen);
+    bind->uiCode = uiCode;
+    STORE(&bind->value, (void *) pvValue);
+    bind->next = NULL;
+    return bind;
+}
+
+
+/* Adds a binding that was unlinked from symtable to the free list of its
+size class. Readers may still read it. */
+static void SymTableConc_freeBind(struct SymTableConc *symtable, struct sbind *bind) {
+    pthread_mutex_lock(&symtable->pool_lock);
+    STORE(&bind->next, symtable->pool[bind->uiClass]);
+    symtable->pool[bind->uiClass] = bind;
+    pthread_mutex_unlock(&symtable->pool_lock);
+}
+
+
+/* Spins until the lock of group is taken by the caller, yielding the CPU
+now and then so that a preempted holder can finish.
+
+Parameters:
+* symtable: the table
+* arr: the bucket array of group
+* group: the group
+
+Returns: 1 if the lock was taken, 0 if arr was replaced by a resize */
+static int SymTableConc_lock(struct SymTableConc *symtable, struct sarray *arr, struct group *group) {
+    int iFree, iSpins;
+
+    for (iSpins = 0; ; iSpins++) {
+        iFree = 0;
+        if (!LOAD(&group->iLock) &&
+                __atomic_compare_exchange_n(&group->iLock, &iFree, 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            break;
+        }
+        if (LOAD(&symtable->current) != arr) {
+            return 0;
+        }
+        if (iSpins == SPINS) {
+            sched_yield();
+            iSpins = 0;
+        }
+    }
+
+    /* a resize takes every lock before it replaces the array */
+    if (LOAD(&symtable->current) != arr) {
+        STORE(&group->iLock, 0);
+        return 0;
+    }
+    return 1;
+}
+
+
+/* Replaces the bucket array arr of symtable with one that has uiBuckets
+buckets, unless another thread already replaced it. The bindings are
+moved, not copied. */
+static void SymTableConc_change(struct SymTableConc *symtable, struct sarray *arr, unsigned int uiBuckets) {
+    struct sarray *new_arr;
+    struct sbind *ptr, *ptr_next;
+    unsigned int ui, uiHash;
+    int iFree, iSpins;
+
+    pthread_mutex_lock(&symtable->resize_lock);
+    if (LOAD(&symtable->current) != arr) {
+        pthread_mutex_unlock(&symtable->resize_lock);
+        return;
+    }
+
+    /* wait for the writers of every group, and keep them out for good */
+    for (ui = 0U; ui < arr->uiGroups; ui++) {
+        for (iSpins = 0; ; iSpins++) {
+            iFree = 0;
+            if (__atomic_compare_exchange_n(&arr->groups[ui].iLock, &iFree, 1, 0,
+                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+                break;
+            }
+            if (iSpins == SPINS) {
+                sched_yield();
+                iSpins = 0;
+            }
+        }
+        STORE(&arr->groups[ui].uiSeq, arr->groups[ui].uiSeq + 1);
+    }
+
+    new_arr = SymTableConc_newArray(uiBuckets);
+    for (ui = 0U; ui < arr->uiBuckets; ui++) {
+        for (ptr = arr->buckets[ui]; ptr; ptr = ptr_next) {
+            ptr_next = ptr->next;
+            uiHash = ptr->uiCode % uiBuckets;
+            STORE(&ptr->next, new_arr->buckets[uiHash]);
+            new_arr->buckets[uiHash] = ptr;
+        }
+    }
+    new_arr->older = arr;
+    STORE(&symtable->current, new_arr);
+    pthread_mutex_unlock(&symtable->resize_lock);
+}
+
+
+/* Finds in symtable the value of a binding with key equal to pcKey without
+writing shared memory.
+
+Parameters:
+* symtable: the table
+* pcKey: a character array (key). Must be null terminated.
+* piFound: set to 1 if the binding was found, 0 otherwise
+
+Returns: the value or NULL if such binding was not found. */
+static void *SymTableConc_find(struct SymTableConc *symtable, const char *pcKey, int *piFound) {
+    struct sarray *arr;
+    struct group *group;
+    struct sbind *ptr;
+    unsigned int uiCode, uiHash, uiSeq;
+    void *pvValue;
+    int iSpins;
+
+    uiCode = SymTableConc_hash(pcKey);
+    for (iSpins = 0; ; iSpins++) {
+        if (iSpins == SPINS) {
+            sched_yield();
+            iSpins = 0;
+        }
+        arr = LOAD(&symtable->current);
+        uiHash = uiCode % arr->uiBuckets;
+        group = &arr->groups[uiHash / GROUP_BUCKETS];
+        uiSeq = LOAD(&group->uiSeq);
+        if (uiSeq & 1U) {
+            continue;
+        }
+
+        /* the counter is checked at every step, so that a chain that is
+        being changed cannot keep the reader walking */
+        pvValue = NULL;
+        *piFound = 0;
+        for (ptr = LOAD(&arr->buckets[uiHash]); ptr; ptr = LOAD(&ptr->next)) {
+            if (ptr->uiCode == uiCode && !strcmp(ptr->key, pcKey)) {
+                pvValue = LOAD(&ptr->value);
+                *piFound = 1;
+                break;
+            }
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (LOAD(&group->uiSeq) != uiSeq) {
+                break;
+            }
+        }
+
+        /* the reads of the chain must be done before the last check */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (LOAD(&group->uiSeq) == uiSeq) {
+            return pvValue;
+        }
+    }
+}
+
+
+/* Locks the group of the bucket of a key in the current bucket array of
+symtable, growing the array first if iGrow is not 0 and the table is full.
+
+Parameters:
+* symtable: the table
+* uiCode: full hash code of the key
+* iGrow: 1 if a binding may be inserted, 0 otherwise
+* parr: set to the bucket array of the group
+
+Returns: the locked group */
+static struct group *SymTableConc_lockBucket(struct SymTableConc *symtable, unsigned int uiCode,
+        int iGrow, struct sarray **parr) {
+    struct sarray *arr;
+    struct group *group;
+    unsigned int uiBuckets;
+    int idx;
+
+    for (;;) {
+        arr = LOAD(&symtable->current);
+
+        /* find if #buckets need to increase, if so, call SymTableConc_change */
+        uiBuckets = arr->uiBuckets;
+        for (idx = 0; BUCKARR[idx] != uiBuckets; idx++) {
+        }
+        while (iGrow && LOAD(&symtable->uiBindings) >= uiBuckets && uiBuckets != MAX_BUCKETS) {
+            uiBuckets = BUCKARR[++idx];
+        }
+        if (uiBuckets != arr->uiBuckets) {
+            SymTableConc_change(symtable, arr, uiBuckets);
+            continue;
+        }
+
+        group = &arr->groups[uiCode % arr->uiBuckets / GROUP_BUCKETS];
+        if (SymTableConc_lock(symtable, arr, group)) {
+            *parr = arr;
+            return group;
+        }
+    }
+}
+
+
+/* Inserts a new binding at the head of bucket uiHash of arr and unlocks
+its group, which must be locked by the caller. */
+static void SymTableConc_insert(struct SymTableConc *symtable, struct sarray *arr, struct group *group,
+        unsigned int uiHash, const char *pcKey, unsigned int uiCode, const void *pvValue) {
+    struct sbind *new_bind;
+
+    new_bind = SymTableConc_newBind(symtable, pcKey, uiCode, pvValue);
+    new_bind->next = arr->buckets[uiHash];
+    STORE(&group->uiSeq, group->uiSeq + 1);
+    STORE(&arr->buckets[uiHash], new_bind);
+    STORE(&group->uiSeq, group->uiSeq + 1);
+    STORE(&group->iLock, 0);
+    __atomic_add_fetch(&symtable->uiBindings, 1, __ATOMIC_SEQ_CST);
+}
+
+
+/* Creates a SymTableConc struct with no bindings and MIN_BUCKETS number of
+buckets.
+
+Asserts: if memory was allocated succesfully at runtime. */
+SymTableConc_T SymTableConc_new(void) {
+    struct SymTableConc *symtable;
+    unsigned int ui;
+
+    symtable = malloc(sizeof(struct SymTableConc));
+    assert(symtable);
+    symtable->current = SymTableConc_newArray(MIN_BUCKETS);
+    symtable->uiBindings = 0U;
+    pthread_mutex_init(&symtable->resize_lock, NULL);
+    pthread_mutex_init(&symtable->pool_lock, NULL);
+    for (ui = 0U; ui < NUM_CLASSES; ui++) {
+        symtable->pool[ui] = NULL;
+    }
+    return (SymTableConc_T) symtable;
+}
+
+
+/* Frees all memory used by oSymTable.
+
+Parameters:
+* oSymTable: a SymTableConc_T type */
+void SymTableConc_free(SymTableConc_T oSymTable) {
+    struct SymTableConc *symtable;
+    struct sarray *arr, *arr_older;
+    struct sbind *ptr, *ptr_next;
+    unsigned int ui;
+
+    symtable = oSymTable;
+    if (!symtable) {
+        return;
+    }
+    for (ui = 0U; ui < symtable->current->uiBuckets; ui++) {
+        for (ptr = symtable->current->buckets[ui]; ptr; ptr = ptr_next) {
+            ptr_next = ptr->next;
+            free(ptr);
+        }
+    }
+    for (ui = 0U; ui < NUM_CLASSES; ui++) {
+        for (ptr = symtable->pool[ui]; ptr; ptr = ptr_next) {
+            ptr_next = ptr->next;
+            free(ptr);
+        }
+    }
+    for (arr = symtable->current; arr; arr = arr_older) {
+        arr_older = arr->older;
+        free(arr);
+    }
+    pthread_mutex_destroy(&symtable->resize_lock);
+    pthread_mutex_destroy(&symtable->pool_lock);
+    free(symtable);
+}
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type */
+unsigned int SymTableConc_getLength(SymTableConc_T oSymTable) {
+    struct SymTableConc *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    return LOAD(&symtable->uiBindings);
+}
+
+
+/* Creates a new binding for oSymTable from a given pcKey and pvValue.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: pointer to any value */
+void SymTableConc_put(SymTableConc_T oSymTable, const char *pcKey, const void *pvValue) {
+    struct SymTableConc *symtable;
+    struct sarray *arr;
+    struct group *group;
+    struct sbind *ptr;
+    unsigned int uiCode, uiHash;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    uiCode = SymTableConc_hash(pcKey);
+    group = SymTableConc_lockBucket(symtable, uiCode, 1, &arr);
+    uiHash = uiCode % arr->uiBuckets;
+
+    /* only this thread writes the group now. updating a value needs no new
+    sequence, readers see the old or the new one */
+    for (ptr = arr->buckets[uiHash]; ptr; ptr = ptr->next) {
+        if (ptr->uiCode == uiCode && !strcmp(ptr->key, pcKey)) {
+            STORE(&ptr->value, (void *) pvValue);
+            STORE(&group->iLock, 0);
+            return;
+        }
+    }
+    SymTableConc_insert(symtable, arr, group, uiHash, pcKey, uiCode, pvValue);
+}
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTableConc_remove(SymTableConc_T oSymTable, const char *pcKey) {
+    struct SymTableConc *symtable;
+    struct sarray *arr;
+    struct group *group;
+    struct sbind *ptr, **link;
+    unsigned int uiCode, uiHash;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    uiCode = SymTableConc_hash(pcKey);
+    group = SymTableConc_lockBucket(symtable, uiCode, 0, &arr);
+    uiHash = uiCode % arr->uiBuckets;
+
+    for (link = &arr->buckets[uiHash]; (ptr = *link); link = &ptr->next) {
+        if (ptr->uiCode == uiCode && !strcmp(ptr->key, pcKey)) {
+            STORE(&group->uiSeq, group->uiSeq + 1);
+            STORE(link, ptr->next);
+            STORE(&group->uiSeq, group->uiSeq + 1);
+            STORE(&group->iLock, 0);
+            __atomic_sub_fetch(&symtable->uiBindings, 1, __ATOMIC_SEQ_CST);
+            SymTableConc_freeBind(symtable, ptr);
+            return 1;
+        }
+    }
+    STORE(&group->iLock, 0);
+    return 0;
+}
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableConc_contains(SymTableConc_T oSymTable, const char *pcKey) {
+    int iFound;
+
+    assert(oSymTable);
+    assert(pcKey);
+    SymTableConc_find(oSymTable, pcKey, &iFound);
+    return iFound;
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: a pointer to the value or NULL if such binding was not found. */
+void* SymTableConc_get(SymTableConc_T oSymTable, const char *pcKey) {
+    int iFound;
+
+    assert(oSymTable);
+    assert(pcKey);
+    return SymTableConc_find(oSymTable, pcKey, &iFound);
+}
+
+
+/* Adds lDelta to the value of the binding with key equal to pcKey, as one
+atomic step. The value is used as a counter. If pcKey does not exist, a
+binding with count lDelta is created.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if necessary memory was allocated succesfully at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* lDelta: number to add, can be negative
+
+Returns: the count after the addition */
+long SymTableConc_atomicAdd(SymTableConc_T oSymTable, const char *pcKey, long lDelta) {
+    struct SymTableConc *symtable;
+    struct sarray *arr;
+    struct group *group;
+    struct sbind *ptr;
+    unsigned int uiCode, uiHash;
+    long lCount;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    /* the value is written only by holders of the group lock, so that a
+    binding that is removed and reused cannot receive the addition */
+    uiCode = SymTableConc_hash(pcKey);
+    group = SymTableConc_lockBucket(symtable, uiCode, 1, &arr);
+    uiHash = uiCode % arr->uiBuckets;
+    for (ptr = arr->buckets[uiHash]; ptr; ptr = ptr->next) {
+        if (ptr->uiCode == uiCode && !strcmp(ptr->key, pcKey)) {
+            lCount = (long) (size_t) ptr->value + lDelta;
+            STORE(&ptr->value, (void *) (size_t) lCount);
+            STORE(&group->iLock, 0);
+            return lCount;
+        }
+    }
+    SymTableConc_insert(symtable, arr, group, uiHash, pcKey, uiCode, (void *) (size_t) lDelta);
+    return lDelta;
+}
+
+
+/* Sets the value of the binding with key equal to pcKey to pvValue, only if
+its value is pvExpected, as one atomic step.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvExpected: the value the binding must have
+* pvValue: the new value
+
+Returns: 1 if the value was replaced, 0 if such binding was not found or
+its value was not pvExpected */
+int SymTableConc_compareAndSwap(SymTableConc_T oSymTable, const char *pcKey,
+        const void *pvExpected, const void *pvValue) {
+    struct SymTableConc *symtable;
+    struct sarray *arr;
+    struct group *group;
+    struct sbind *ptr;
+    unsigned int uiCode, uiHash;
+    int iSwapped;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    uiCode = SymTableConc_hash(pcKey);
+    group = SymTableConc_lockBucket(symtable, uiCode, 0, &arr);
+    uiHash = uiCode % arr->uiBuckets;
+    iSwapped = 0;
+    for (ptr = arr->buckets[uiHash]; ptr; ptr = ptr->next) {
+        if (ptr->uiCode == uiCode && !strcmp(ptr->key, pcKey)) {
+            if (ptr->value == pvExpected) {
+                STORE(&ptr->value, (void *) pvValue);
+                iSwapped = 1;
+            }
+            break;
+        }
+    }
+    STORE(&group->iLock, 0);
+    return iSwapped;
+}
+
+
+/* Applies function pfApply to every binding in oSymTable. All groups are
+locked, so that writers wait until pfApply has been applied to every
+binding. Readers are not blocked.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableConc_T type
+* pfApply: function to apply
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableConc_map(SymTableConc_T oSymTable,
+        void (*pfApply)(const char *pcKey, void *pvValue, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTableConc *symtable;
+    struct sarray *arr;
+    struct sbind *ptr;
+    unsigned int ui;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pfApply);
+
+    /* no resize can replace the array while the resize lock is held */
+    pthread_mutex_lock(&symtable->resize_lock);
+    arr = symtable->current;
+    for (ui = 0U; ui < arr->uiGroups; ui++) {
+        SymTableConc_lock(symtable, arr, &arr->groups[ui]);
+    }
+    for (ui = 0U; ui < arr->uiBuckets; ui++) {
+        for (ptr = arr->buckets[ui]; ptr; ptr = ptr->next) {
+            pfApply(ptr->key, LOAD(&ptr->value), (void *) pvExtra);
+        }
+    }
+    for (ui = 0U; ui < arr->uiGroups; ui++) {
+        STORE(&arr->groups[ui].iLock, 0);
+    }
+    pthread_mutex_unlock(&symtable->resize_lock);
+}
@@ -0,0 +1,596 @@
+/* Library for creating and using Symbol tables in POSIX shared memory.
+
+The segment starts with a header, followed by the bucket arrays of the
+partitions and then the records of the bindings, each one a struct srecord,
+the key padded to 8 bytes and the value. Each process maps the segment at a
+different address, so the segment holds no pointers: records and buckets
+refer to each other by their offset from the start of the segment, and
+offset 0, where the header is, means none.
+
+Keys are spread over PARTITIONS partitions by their hash code. Each
+partition has a bucket array with linked lists for resolving conflicts and
+a process-shared mutex for its writers, so writers of different partitions
+run in parallel. Records are taken from the segment by a bump allocator and
+are never modified once they are linked, except for their next offset, nor
+reused: a replaced value gets a new record and a removed record is only
+unlinked. A reader that walks a list while a writer changes it therefore
+reads only complete records and needs no lock. The bucket arrays have a
+fixed size, since they could not be replaced while readers use them.
+
+The mutexes are robust: if a process dies while it holds one, the next
+writer takes it over. A record is linked by a single store, so the lists
+are still consistent, but the counts of the header may be off. */
+
+#define _XOPEN_SOURCE 700
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include "symtableshm.h"
+
+#define HASH_MULTIPLIER 65599
+#define MAX_BUCKETS 16777213
+#define MIN_BUCKETS 519
+#define PARTITIONS 64           /* partitions, each with its own writer lock */
+#define ALIGN 8                 /* alignment of records, keys and values */
+#define MAGIC 0x53484d54U       /* marks a segment whose table is ready */
+
+#define LOAD(ptr) __atomic_load_n(ptr, __ATOMIC_SEQ_CST)
+#define STORE(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_SEQ_CST)
+
+/* buckets of one partition */
+static unsigned const BUCKARR[] = {MIN_BUCKETS, 1021, 2053, 4093, 8191, 16381, 32771, 65521,
+    131071, 262139, 524287, 1048573, 2097143, 4194301, 8388593, MAX_BUCKETS};
+
+
+/* Struct that represents a binding in the segment. The key and the value
+are stored right after the struct.
+next: offset of the next record of the bucket
+uiValueSize: size of the value
+uiCode: hash code of the key
+uiKeySize: size of the key, including its '\0' and the padding */
+struct srecord {
+    size_t next;
+    size_t uiValueSize;
+    unsigned int uiCode;
+    unsigned int uiKeySize;
+};
+
+
+/* Struct that represents a partition.
+lock: serializes the writers of the partition, in any process
+buckets: offset of the bucket array, uiBuckets offsets of records */
+struct partition {
+    pthread_mutex_t lock;
+    size_t buckets;
+};
+
+
+/* Struct that represents the header of the segment.
+uiMagic: MAGIC once the table is ready
+uiBuckets: buckets of each partition
+uiSize: size of the segment
+uiTop: offset of the first free byte
+uiGarbage: bytes of records that were unlinked
+uiBindings: number of bindings */
+struct shmheader {
+    unsigned int uiMagic;
+    unsigned int uiBuckets;
+    size_t uiSize;
+    size_t uiTop;
+    size_t uiGarbage;
+    unsigned int uiBindings;
+    struct partition parts[PARTITIONS];
+};
+
+
+/* Struct that represents a table mapped in this process.
+base: address of the segment
+header: the header, at base */
+struct SymTableShm {
+    char *base;
+    struct shmheader *header;
+};
+
+
+/* Computes the hash code for pcKey.
+
+Parameters:
+* pcKey: character array (key). Must be null terminated. */
+static unsigned int SymTableShm_hash(const char *pcKey) {
+    size_t ui;
+    unsigned int uiHash;
+
+    uiHash = 0U;
+    for (ui = 0U; pcKey[ui] != '\0'; ui++) {
+        uiHash = uiHash * HASH_MULTIPLIER + pcKey[ui];
+    }
+    return uiHash;
+}
+
+
+/* Rounds uiSize up to a multiple of ALIGN. */
+static size_t SymTableShm_align(size_t uiSize) {
+    return (uiSize + ALIGN - 1) / ALIGN * ALIGN;
+}
+
+
+/* Takes uiSize bytes from the free space of the segment. Can be called by
+writers of different partitions at the same time.
+
+Returns: the offset of the bytes or 0 if the segment is full */
+static size_t SymTableShm_alloc(struct shmheader *header, size_t uiSize) {
+    size_t uiTop;
+
+    uiSize = SymTableShm_align(uiSize);
+    uiTop = LOAD(&header->uiTop);
+    do {
+        if (uiSize > header->uiSize - uiTop) {
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&header->uiTop, &uiTop, uiTop + uiSize, 0,
+            __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+    return uiTop;
+}
+
+
+/* Returns the address of the bucket of a key with hash code uiCode, and
+sets *ppPart to its partition. */
+static size_t *SymTableShm_bucket(struct SymTableShm *symtable, unsigned int uiCode,
+        struct partition **ppPart) {
+    struct partition *part;
+
+    part = &symtable->header->parts[uiCode % PARTITIONS];
+    *ppPart = part;
+    return (size_t *) (symtable->base + part->buckets) + uiCode / PARTITIONS % symtable->header->uiBuckets;
+}
+
+
+/* Locks the writers of part out, taking the lock over if its holder died. */
+static void SymTableShm_lock(struct partition *part) {
+    if (pthread_mutex_lock(&part->lock) == EOWNERDEAD) {
+        pthread_mutex_consistent(&part->lock);
+    }
+}
+
+
+/* Finds in the bucket at pBucket a record with key equal to pcKey without
+locking.
+
+Returns: the record or NULL if such binding was not found. */
+static struct srecord *SymTableShm_find(struct SymTableShm *symtable, size_t *pBucket,
+        const char *pcKey, unsigned int uiCode) {
+    struct srecord *rec;
+    size_t off;
+
+    for (off = LOAD(pBucket); off; off = LOAD(&rec->next)) {
+        rec = (struct srecord *) (symtable->base + off);
+        if (rec->uiCode == uiCode && !strcmp((char *) (rec + 1), pcKey)) {
+            return rec;
+        }
+    }
+    return NULL;
+}
+
+
+/* Maps the segment of iFd, of uiSize bytes, and creates a handle for it.
+
+Asserts: if memory was allocated succesfully at runtime.
+
+Returns: the handle or NULL if the segment could not be mapped */
+static struct SymTableShm *SymTableShm_attach(int iFd, size_t uiSize) {
+    struct SymTableShm *symtable;
+    void *pvBase;
+
+    pvBase = mmap(NULL, uiSize, PROT_READ | PROT_WRITE, MAP_SHARED, iFd, 0);
+    if (pvBase == MAP_FAILED) {
+        return NULL;
+    }
+    symtable = malloc(sizeof(struct SymTableShm));
+    assert(symtable);
+    symtable->base = pvBase;
+    symtable->header = pvBase;
+    return symtable;
+}
+
+
+/* Creates a shared memory segment named pcName of uiSize bytes with an empty
+table, and maps it.
+
+Asserts:
+1) if pcName is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* pcName: name of the segment, see shm_open(3). Starts with '/'.
+* uiSize: size of the segment in bytes
+* uiExpected: number of keys the table is expected to hold
+
+Returns: a SymTableShm_T type or NULL if the segment could not be created,
+uiSize is too small for the buckets or the locks could not be initialized.
+No segment is then left behind. */
+SymTableShm_T SymTableShm_create(const char *pcName, size_t uiSize, unsigned int uiExpected) {
+    struct SymTableShm *symtable;
+    struct shmheader *header;
+    pthread_mutexattr_t attr;
+    size_t uiArray;
+    unsigned int ui;
+    int iFd, idx;
+
+    assert(pcName);
+
+    /* the number of buckets of all partitions together is close to
+    uiExpected, as in a SymTable that has grown to hold it */
+    for (idx = 0; BUCKARR[idx] != MAX_BUCKETS && (unsigned long) BUCKARR[idx] * PARTITIONS < uiExpected; idx++) {
+    }
+    uiArray = SymTableShm_align(sizeof(struct shmheader)) + (size_t) PARTITIONS * BUCKARR[idx] * sizeof(size_t);
+    if (uiSize < uiArray) {
+        return NULL;
+    }
+
+    iFd = shm_open(pcName, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (iFd < 0) {
+        return NULL;
+    }
+
+    /* a new segment is filled with zeros, so the buckets are empty */
+    if (ftruncate(iFd, (off_t) uiSize) != 0 || !(symtable = SymTableShm_attach(iFd, uiSize))) {
+        close(iFd);
+        shm_unlink(pcName);
+        return NULL;
+    }
+    close(iFd);
+
+    header = symtable->header;
+    header->uiBuckets = BUCKARR[idx];
+    header->uiSize = uiSize;
+    header->uiTop = SymTableShm_align(sizeof(struct shmheader));
+    header->uiGarbage = 0;
+    header->uiBindings = 0U;
+
+    /* without process shared, robust locks the table cannot be used, so the
+    segment is removed */
+    if (pthread_mutexattr_init(&attr) != 0) {
+        SymTableShm_close(symtable);
+        shm_unlink(pcName);
+        return NULL;
+    }
+    ui = 0U;
+    if (pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED) == 0 &&
+            pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST) == 0) {
+        for (; ui < PARTITIONS && pthread_mutex_init(&header->parts[ui].lock, &attr) == 0; ui++) {
+            header->parts[ui].buckets = SymTableShm_alloc(header, header->uiBuckets * sizeof(size_t));
+        }
+    }
+    pthread_mutexattr_destroy(&attr);
+    if (ui < PARTITIONS) {
+        while (ui > 0U) {
+            pthread_mutex_destroy(&header->parts[--ui].lock);
+        }
+        SymTableShm_close(symtable);
+        shm_unlink(pcName);
+        return NULL;
+    }
+
+    /* other processes use the table only after they see MAGIC */
+    STORE(&header->uiMagic, MAGIC);
+    return (SymTableShm_T) symtable;
+}
+
+
+/* Maps the table in the shared memory segment named pcName.
+
+Asserts:
+1) if pcName is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* pcName: name of the segment
+
+Returns: a SymTableShm_T type or NULL if the segment could not be opened or
+does not hold a table */
+SymTableShm_T SymTableShm_open(const char *pcName) {
+    struct SymTableShm *symtable;
+    struct stat st;
+    int iFd;
+
+    assert(pcName);
+
+    iFd = shm_open(pcName, O_RDWR, 0);
+    if (iFd < 0) {
+        return NULL;
+    }
+    if (fstat(iFd, &st) != 0 || (size_t) st.st_size < sizeof(struct shmheader) ||
+            !(symtable = SymTableShm_attach(iFd, (size_t) st.st_size))) {
+        close(iFd);
+        return NULL;
+    }
+    close(iFd);
+
+    if (LOAD(&symtable->header->uiMagic) != MAGIC || symtable->header->uiSize != (size_t) st.st_size) {
+        SymTableShm_close(symtable);
+        return NULL;
+    }
+    return (SymTableShm_T) symtable;
+}
+
+
+/* Unmaps oSymTable from this process and frees the memory used by the
+handle.
+
+Parameters:
+* oSymTable: a SymTableShm_T type */
+void SymTableShm_close(SymTableShm_T oSymTable) {
+    struct SymTableShm *symtable;
+
+    symtable = oSymTable;
+    if (!symtable) {
+        return;
+    }
+    munmap(symtable->base, symtable->header->uiSize);
+    free(symtable);
+}
+
+
+/* Removes the name of the segment pcName.
+
+Asserts: if pcName is not NULL at runtime.
+
+Parameters:
+* pcName: name of the segment
+
+Returns: 1 on success, 0 if there is no such segment */
+int SymTableShm_unlink(const char *pcName) {
+    assert(pcName);
+
+    return shm_unlink(pcName) == 0;
+}
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type */
+unsigned int SymTableShm_getLength(SymTableShm_T oSymTable) {
+    struct SymTableShm *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    return LOAD(&symtable->header->uiBindings);
+}
+
+
+/* Creates a new binding for oSymTable from a given pcKey and a copy of the
+uiSize bytes at pvValue. If pcKey exists, its value is replaced.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if pvValue is not NULL when uiSize is not 0 at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: the value
+* uiSize: size of the value in bytes
+
+Returns: 1 on success, 0 if the segment is full */
+int SymTableShm_put(SymTableShm_T oSymTable, const char *pcKey, const void *pvValue, size_t uiSize) {
+    struct SymTableShm *symtable;
+    struct partition *part;
+    struct srecord *rec, *old_rec;
+    size_t *pBucket, *pLink;
+    size_t off, uiKeySize;
+    unsigned int uiCode;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+    assert(pvValue || !uiSize);
+
+    uiCode = SymTableShm_hash(pcKey);
+    pBucket = SymTableShm_bucket(symtable, uiCode, &part);
+    uiKeySize = SymTableShm_align(strlen(pcKey) + 1);
+
+    /* the record is complete before it is linked */
+    off = SymTableShm_alloc(symtable->header, sizeof(struct srecord) + uiKeySize + uiSize);
+    if (!off) {
+        return 0;
+    }
+    rec = (struct srecord *) (symtable->base + off);
+    rec->uiValueSize = uiSize;
+    rec->uiCode = uiCode;
+    rec->uiKeySize = (unsigned int) uiKeySize;
+    strcpy((char *) (rec + 1), pcKey);
+    memcpy((char *) (rec + 1) + uiKeySize, pvValue, uiSize);
+
+    SymTableShm_lock(part);
+    for (pLink = pBucket; *pLink; pLink = &old_rec->next) {
+        old_rec = (struct srecord *) (symtable->base + *pLink);
+        if (old_rec->uiCode == uiCode && !strcmp((char *) (old_rec + 1), pcKey)) {
+
+            /* the new record takes the place of the old one, readers see
+            one or the other */
+            rec->next = old_rec->next;
+            STORE(pLink, off);
+            __atomic_add_fetch(&symtable->header->uiGarbage,
+                SymTableShm_align(sizeof(struct srecord) + old_rec->uiKeySize + old_rec->uiValueSize),
+                __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&part->lock);
+            return 1;
+        }
+    }
+    rec->next = *pBucket;
+    STORE(pBucket, off);
+    __atomic_add_fetch(&symtable->header->uiBindings, 1, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock(&part->lock);
+    return 1;
+}
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTableShm_remove(SymTableShm_T oSymTable, const char *pcKey) {
+    struct SymTableShm *symtable;
+    struct partition *part;
+    struct srecord *rec;
+    size_t *pBucket, *pLink;
+    unsigned int uiCode;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    uiCode = SymTableShm_hash(pcKey);
+    pBucket = SymTableShm_bucket(symtable, uiCode, &part);
+    SymTableShm_lock(part);
+    for (pLink = pBucket; *pLink; pLink = &rec->next) {
+        rec = (struct srecord *) (symtable->base + *pLink);
+        if (rec->uiCode == uiCode && !strcmp((char *) (rec + 1), pcKey)) {
+
+            /* a reader standing on rec still finds the rest of the list */
+            STORE(pLink, rec->next);
+            __atomic_add_fetch(&symtable->header->uiGarbage,
+                SymTableShm_align(sizeof(struct srecord) + rec->uiKeySize + rec->uiValueSize),
+                __ATOMIC_SEQ_CST);
+            __atomic_sub_fetch(&symtable->header->uiBindings, 1, __ATOMIC_SEQ_CST);
+            pthread_mutex_unlock(&part->lock);
+            return 1;
+        }
+    }
+    pthread_mutex_unlock(&part->lock);
+    return 0;
+}
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableShm_contains(SymTableShm_T oSymTable, const char *pcKey) {
+    struct SymTableShm *symtable;
+    struct partition *part;
+    unsigned int uiCode;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    uiCode = SymTableShm_hash(pcKey);
+    return SymTableShm_find(symtable, SymTableShm_bucket(symtable, uiCode, &part), pcKey, uiCode) != NULL;
+}
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pcKey: a character array (key). Must be null terminated.
+* puiSize: set to the size of the value in bytes. Can be NULL.
+
+Returns: a pointer to the value in the segment or NULL if such binding was
+not found. */
+const void* SymTableShm_get(SymTableShm_T oSymTable, const char *pcKey, size_t *puiSize) {
+    struct SymTableShm *symtable;
+    struct partition *part;
+    struct srecord *rec;
+    unsigned int uiCode;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pcKey);
+
+    uiCode = SymTableShm_hash(pcKey);
+    rec = SymTableShm_find(symtable, SymTableShm_bucket(symtable, uiCode, &part), pcKey, uiCode);
+    if (!rec) {
+        return NULL;
+    }
+    if (puiSize) {
+        *puiSize = rec->uiValueSize;
+    }
+    return (char *) (rec + 1) + rec->uiKeySize;
+}
+
+
+/* Applies function pfApply to every binding in oSymTable, one partition
+after the other.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pfApply: function to apply. It gets the key, the value and its size.
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableShm_map(SymTableShm_T oSymTable,
+        void (*pfApply)(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra),
+        const void *pvExtra) {
+    struct SymTableShm *symtable;
+    struct partition *part;
+    struct srecord *rec;
+    size_t *buckets;
+    size_t off;
+    unsigned int ui, uiPart;
+
+    symtable = oSymTable;
+    assert(symtable);
+    assert(pfApply);
+
+    for (uiPart = 0U; uiPart < PARTITIONS; uiPart++) {
+        part = &symtable->header->parts[uiPart];
+        buckets = (size_t *) (symtable->base + part->buckets);
+        SymTableShm_lock(part);
+        for (ui = 0U; ui < symtable->header->uiBuckets; ui++) {
+            for (off = buckets[ui]; off; off = rec->next) {
+                rec = (struct srecord *) (symtable->base + off);
+                pfApply((char *) (rec + 1), (char *) (rec + 1) + rec->uiKeySize, rec->uiValueSize,
+                    (void *) pvExtra);
+            }
+        }
+        pthread_mutex_unlock(&part->lock);
+    }
+}
+
+
+/* Returns the number of bytes of the segment of oSymTable that are used.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* puiGarbage: set to the bytes of removed or replaced bindings. Can be
+NULL. */
+size_t SymTableShm_getBytes(SymTableShm_T oSymTable, size_t *puiGarbage) {
+    struct SymTableShm *symtable;
+
+    symtable = oSymTable;
+    assert(symtable);
+
+    if (puiGarbage) {
+        *puiGarbage = LOAD(&symtable->header->uiGarbage);
+    }
+    return LOAD(&symtable->header->uiTop);
+}
@@ -0,0 +1,170 @@
+/* Library for creating and using Symbol tables in POSIX shared memory, so
+that several processes can use the same table.
+
+A table is a named shared memory segment of a fixed size, which each process
+maps at its own address. Keys and values are copied into the segment, so
+values are given as bytes with their size. Lookups never lock and can run in
+any number of processes at the same time. Modifications lock one of the
+partitions of the table, chosen by the hash of the key.
+
+Space of removed or replaced bindings is never reused, which is what keeps
+lookups safe without locks: the table is meant to be filled once and then
+read mostly. */
+
+#ifndef SYMTABLESHM_INCLUDE
+#define SYMTABLESHM_INCLUDE
+
+#include <stdio.h>
+
+typedef void* SymTableShm_T;
+
+
+/* Creates a shared memory segment named pcName of uiSize bytes with an empty
+table, and maps it. Fails if a segment named pcName already exists. The
+segment stays until SymTableShm_unlink is called, even when no process
+uses it.
+
+Asserts:
+1) if pcName is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* pcName: name of the segment, see shm_open(3). Starts with '/'.
+* uiSize: size of the segment in bytes. Bindings can be added until it is
+full. Pages that are never written take no memory.
+* uiExpected: number of keys the table is expected to hold, used to choose
+the number of buckets. It cannot change later.
+
+Returns: a SymTableShm_T type or NULL if the segment could not be created,
+uiSize is too small for the buckets or the locks could not be initialized.
+No segment is then left behind. */
+SymTableShm_T SymTableShm_create(const char *pcName, size_t uiSize, unsigned int uiExpected);
+
+
+/* Maps the table in the shared memory segment named pcName, created by
+SymTableShm_create in this or another process.
+
+Asserts:
+1) if pcName is not NULL at runtime.
+2) if memory was allocated succesfully at runtime.
+
+Parameters:
+* pcName: name of the segment
+
+Returns: a SymTableShm_T type or NULL if the segment could not be opened or
+does not hold a table */
+SymTableShm_T SymTableShm_open(const char *pcName);
+
+
+/* Unmaps oSymTable from this process and frees the memory used by the
+handle. The table itself is not modified.
+
+Parameters:
+* oSymTable: a SymTableShm_T type */
+void SymTableShm_close(SymTableShm_T oSymTable);
+
+
+/* Removes the name of the segment pcName. The segment is freed once every
+process has closed its table.
+
+Asserts: if pcName is not NULL at runtime.
+
+Parameters:
+* pcName: name of the segment
+
+Returns: 1 on success, 0 if there is no such segment */
+int SymTableShm_unlink(const char *pcName);
+
+
+/* Returns the number of bindings in oSymTable.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type */
+unsigned int SymTableShm_getLength(SymTableShm_T oSymTable);
+
+
+/* Creates a new binding for oSymTable from a given pcKey and a copy of the
+uiSize bytes at pvValue. If pcKey exists, its value is replaced.
+
+Asserts:
+1) if oSymTable and pcKey are not NULL at runtime.
+2) if pvValue is not NULL when uiSize is not 0 at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pcKey: a character array (key). Must be null terminated.
+* pvValue: the value
+* uiSize: size of the value in bytes
+
+Returns: 1 on success, 0 if the segment is full. In that case oSymTable is
+not modified. */
+int SymTableShm_put(SymTableShm_T oSymTable, const char *pcKey, const void *pvValue, size_t uiSize);
+
+
+/* Removes a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pcKey: a character array (key). Must be null terminated.
+
+Returns: 1 if removal was successful, 0 if such binding was not found */
+int SymTableShm_remove(SymTableShm_T oSymTable, const char *pcKey);
+
+
+/* Checks whether a binding with key equal to pcKey is present in oSymTable.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type.
+* pcKey: character array (key). Must be null terminated.
+
+Returns: 1 if pcKey is found, 0 otherwise */
+int SymTableShm_contains(SymTableShm_T oSymTable, const char *pcKey);
+
+
+/* Finds in oSymTable a binding with key equal to pcKey.
+
+Asserts: if oSymTable and pcKey are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pcKey: a character array (key). Must be null terminated.
+* puiSize: set to the size of the value in bytes. Can be NULL.
+
+Returns: a pointer to the value in the segment, aligned to 8 bytes, or NULL
+if such binding was not found. The value is never modified and stays valid
+until oSymTable is closed, even if the binding is removed or replaced. */
+const void* SymTableShm_get(SymTableShm_T oSymTable, const char *pcKey, size_t *puiSize);
+
+
+/* Applies function pfApply to every binding in oSymTable, one partition
+after the other. Modifications of a partition wait until pfApply has been
+applied to its bindings, therefore pfApply must not modify oSymTable.
+
+Asserts: if oSymTable and pfApply are not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* pfApply: function to apply. It gets the key, the value and its size.
+* pvExtra: a pointer to any value. Used by pfApply. */
+void SymTableShm_map(SymTableShm_T oSymTable,
+        void (*pfApply)(const char *pcKey, const void *pvValue, size_t uiSize, void *pvExtra),
+        const void *pvExtra);
+
+
+/* Returns the number of bytes of the segment of oSymTable that are used.
+
+Asserts: if oSymTable is not NULL at runtime.
+
+Parameters:
+* oSymTable: a SymTableShm_T type
+* puiGarbage: set to the bytes of removed or replaced bindings, which are
+never reused. Can be NULL. */
+size_t SymTableShm_getBytes(SymTableShm_T oSymTable, size_t *puiGarbage);
+
+#endif
@@ -0,0 +1,46 @@
+/* Helpers shared by the test and benchmark programs of the Symbol table
+libraries. */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <time.h>
+#include "symtabutil.h"
+
+
+/* next_random
+
+Returns the next number of a xorshift random number generator. The sequence
+depends only on the initial state, so runs are reproducible on every
+platform.
+
+Parameters:
+state: the state of the generator. A state of 0 is taken as 1.
+
+Returns: a random number in [0 : 2^32-1] */
+unsigned long next_random(unsigned long *state) {
+    unsigned long x;
+
+    x = *state & 0xFFFFFFFFUL;
+    if (!x) {
+        x = 1UL;
+    }
+    x ^= (x << 13) & 0xFFFFFFFFUL;
+    x ^= x >> 17;
+    x ^= (x << 5) & 0xFFFFFFFFUL;
+    *state = x;
+    return x;
+}
+
+
+/* elapsed
+
+Parameters:
+start: a time taken with CLOCK_MONOTONIC
+
+Returns: the seconds since start */
+double elapsed(const struct timespec *start) {
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
@@ -0,0 +1,27 @@
+/* Helpers shared by the test and benchmark programs of the Symbol table
+libraries. */
+
+#ifndef SYMTABUTIL_INCLUDE
+#define SYMTABUTIL_INCLUDE
+
+struct timespec;
+
+
+/* Returns the next number of a xorshift random number generator. The sequence
+depends only on the initial state, so runs are reproducible on every
+platform.
+
+Parameters:
+* state: the state of the generator. A state of 0 is taken as 1.
+
+Returns: a random number in [0 : 2^32-1] */
+unsigned long next_random(unsigned long *state);
+
+
+/* Returns the seconds of CLOCK_MONOTONIC since start.
+
+Parameters:
+* start: a time given by clock_gettime(CLOCK_MONOTONIC, ...) */
+double elapsed(const struct timespec *start);
+
+#endif
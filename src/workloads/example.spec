@@ -0,0 +1,65 @@
+# Example workloads for symtabbench. Run with: ./bench workloads/example.spec
+#
+# Options before the first [section] apply to every workload:
+#   keys      number of random keys
+#   key_len   key length, N or MIN-MAX (uniform)
+#   alphabet  characters of the keys
+#   key_dist  uniform or zipf: how operations select keys
+#   ops       number of operations after the table is filled
+#   mix       PUT/GET/REMOVE relative frequencies
+#   threads   threads used to fill the table (SymTable_buildParallel if > 1)
+#   seed      seed of the random number generator
+#   min_load, max_load, growth, max_bytes   resize policy (SymTable_setPolicy)
+#   cache     entries of the lookup cache (SymTable_setCache), 0 for none
+#   batch     keys per SymTable_getBatch call for consecutive gets, 0 for SymTable_get
+#   repeat    runs per workload, median times are reported
+
+seed = 42
+repeat = 3
+
+[read-mostly]
+keys = 50000
+key_len = 4-16
+ops = 500000
+mix = 5/90/5
+
+[write-heavy]
+keys = 50000
+key_len = 4-16
+ops = 500000
+mix = 45/10/45
+
+[zipf-lookups]
+keys = 50000
+key_len = 8-24
+key_dist = zipf
+ops = 500000
+mix = 0/100/0
+
+[zipf-lookups-cached]
+keys = 50000
+key_len = 8-24
+key_dist = zipf
+ops = 500000
+mix = 0/100/0
+cache = 1024
+
+[large-lookups]
+keys = 500000
+key_len = 8-24
+ops = 2000000
+mix = 0/100/0
+
+[large-lookups-batched]
+keys = 500000
+key_len = 8-24
+ops = 2000000
+mix = 0/100/0
+batch = 64
+
+[parallel-fill]
+keys = 200000
+key_len = 8
+threads = 4
+ops = 100000
+mix = 0/100/0
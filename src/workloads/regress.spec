@@ -0,0 +1,52 @@
+# Fixed workloads of the performance regression suite (make regress).
+# Results are compared with workloads/baseline.csv, which is regenerated
+# with 'make baseline'. Changing a workload requires a new baseline.
+
+seed = 12345
+repeat = 5
+tolerance = 0.25
+mem_tolerance = 0.01
+
+[lookup-small]
+keys = 5000
+key_len = 4-12
+ops = 1000000
+mix = 0/100/0
+
+[lookup-large]
+keys = 200000
+key_len = 8-24
+ops = 1000000
+mix = 0/100/0
+
+[lookup-zipf]
+keys = 100000
+key_len = 8-24
+key_dist = zipf
+ops = 1000000
+mix = 0/100/0
+
+[mixed]
+keys = 100000
+key_len = 4-16
+ops = 1000000
+mix = 20/70/10
+
+[churn]
+keys = 100000
+key_len = 4-16
+ops = 1000000
+mix = 45/10/45
+min_load = 0.25
+
+[long-keys]
+keys = 50000
+key_len = 64-128
+ops = 500000
+mix = 10/90/0
+
+[parallel-fill]
+keys = 500000
+key_len = 8-16
+threads = 4
+ops = 0